@@ -0,0 +1,121 @@
+// 流式聚合基准
+//
+// 生成一个临时日志文件（时间戳逐行递增，覆盖约一小时，64 个节点标签），依次测量：
+//   parse：m3log_parse_view 逐行解析，不做统计（聚合的下限）
+//   agg_add_buffer：单线程 m3log_agg_add_buffer，按分钟 × 标签 × 级别计数
+//   agg_file：m3log_agg_file 以 1、2、4 ... 个线程聚合整个文件（含并行合并）
+//   g++ -std=c++20 -O2 -pthread -Ic/include bench/agg_bench.cc -x c c/src/m3log_agg.c c/src/m3log_bulk.c c/src/m3log_index.c c/src/m3log_view.c c/src/m3log_simd.c c/src/m3log.c -o agg_bench
+//   ./agg_bench [MB] [path]
+
+#include "m3log_agg.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string makeCorpus(size_t bytes) {
+    static const char* const levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    std::string corpus;
+    char time[32];
+    for (size_t i = 0; corpus.size() < bytes; ++i) {
+        // 每秒约 1000 行
+        size_t ms = i;
+        std::snprintf(time, sizeof(time), "2023-04-01T%02zu:%02zu:%02zu.%03zuZ", 15 + ms / 3600000 % 9,
+                      ms / 60000 % 60, ms / 1000 % 60, ms % 1000);
+        corpus += '@';
+        corpus += time;
+        corpus += " [user auth node" + std::to_string(i % 64) + "] #" + levels[i % 4] + ": request " +
+                  std::to_string(i) + " completed in " + std::to_string(i % 997) + "ms\n";
+    }
+    return corpus;
+}
+
+double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+m3log_agg_t* createAgg() {
+    m3log_agg_options_t options = {};
+    options.buckets = 600;
+    m3log_agg_t* agg = nullptr;
+    if (m3log_agg_create(&options, &agg) != M3LOG_SUCCESS) {
+        std::fprintf(stderr, "m3log_agg_create failed\n");
+        std::exit(1);
+    }
+    return agg;
+}
+
+void report(const char* name, size_t lines, size_t bytes, double elapsed) {
+    std::printf("%-24s %10.2f Mlines/s %9.1f MB/s\n", name, lines / elapsed / 1e6, bytes / elapsed / (1 << 20));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 128;
+    std::string path = argc > 2 ? argv[2] : "/tmp/m3log_agg_bench.log";
+    std::string corpus = makeCorpus(megabytes << 20);
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file || std::fwrite(corpus.data(), 1, corpus.size(), file) != corpus.size()) {
+        std::perror("write corpus");
+        return 1;
+    }
+    std::fclose(file);
+
+    size_t lines = 0;
+    for (char c : corpus) {
+        lines += c == '\n';
+    }
+    std::printf("corpus: %zu MB, %zu lines, %u cores\n\n", megabytes, lines, std::thread::hardware_concurrency());
+
+    // 只解析
+    {
+        std::vector<char> scratch(4096);
+        m3log_arena_t arena;
+        size_t parsed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t begin = 0; begin < corpus.size();) {
+            size_t end = corpus.find('\n', begin);
+            m3log_arena_init(&arena, scratch.data(), scratch.size());
+            m3log_view_t view;
+            parsed += m3log_parse_view(corpus.data() + begin, end - begin, &view, &arena) == M3LOG_SUCCESS;
+            begin = end + 1;
+        }
+        report("parse", parsed, corpus.size(), seconds(start));
+    }
+
+    uint64_t expected = 0;
+    {
+        m3log_agg_t* agg = createAgg();
+        auto start = std::chrono::steady_clock::now();
+        m3log_agg_add_buffer(agg, corpus.data(), corpus.size());
+        report("agg_add_buffer", lines, corpus.size(), seconds(start));
+        expected = m3log_agg_count(agg, "node7", 0, INT64_MIN, INT64_MAX);
+        m3log_agg_destroy(agg);
+    }
+
+    for (size_t threads = 1; threads <= std::thread::hardware_concurrency(); threads *= 2) {
+        m3log_agg_t* agg = createAgg();
+        m3log_bulk_options_t options = {};
+        options.threads = threads;
+        auto start = std::chrono::steady_clock::now();
+        if (m3log_agg_file(agg, path.c_str(), &options) != M3LOG_SUCCESS) {
+            std::fprintf(stderr, "m3log_agg_file failed\n");
+            return 1;
+        }
+        double elapsed = seconds(start);
+        if (m3log_agg_count(agg, "node7", 0, INT64_MIN, INT64_MAX) != expected) {
+            std::fprintf(stderr, "agg_file: count mismatch\n");
+            return 1;
+        }
+        std::string name = "agg_file x" + std::to_string(threads);
+        report(name.c_str(), lines, corpus.size(), elapsed);
+        m3log_agg_destroy(agg);
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+// 批量解析的线程扩展性基准
+//
+// 生成一个临时日志文件，分别以 1、2、4 ... 个线程调用 m3log_bulk_parse_file：
+//   g++ -std=c++20 -O2 -pthread -Ic/include bench/bulk_bench.cc -x c c/src/m3log_bulk.c c/src/m3log_view.c c/src/m3log_simd.c -o bulk_bench
+//   ./bulk_bench [MB] [path]
+// 第二次及之后的运行数据位于页缓存中，结果反映的是解析吞吐而非磁盘带宽。
+
+#include "m3log_bulk.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<size_t> g_tags{0};
+
+int countTags(const m3log_bulk_batch_t* batch, void*) {
+    size_t tags = 0;
+    for (size_t i = 0; i < batch->count; ++i) {
+        tags += batch->views[i].tag_count;
+    }
+    g_tags.fetch_add(tags, std::memory_order_relaxed);
+    return 0;
+}
+
+// 保序模式下检查块按顺序到达
+int checkOrder(const m3log_bulk_batch_t* batch, void* userData) {
+    size_t& expected = *static_cast<size_t*>(userData);
+    if (batch->chunk_index != expected) {
+        std::fprintf(stderr, "out of order: got chunk %zu, expected %zu\n", batch->chunk_index, expected);
+        std::abort();
+    }
+    ++expected;
+    return 0;
+}
+
+void writeCorpus(const char* path, size_t megabytes) {
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::perror("fopen");
+        std::exit(1);
+    }
+
+    static const char* const levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    std::string line;
+    size_t written = 0;
+    for (size_t i = 0; written < megabytes << 20; ++i) {
+        line = "@2023-04-01T15:30:45.123Z [user auth node" + std::to_string(i % 64) + "] #" + levels[i % 4] +
+               ": request " + std::to_string(i) + " completed";
+        line.append(i % 7 * 24, 'x');
+        line.push_back('\n');
+        std::fwrite(line.data(), 1, line.size(), file);
+        written += line.size();
+    }
+    std::fclose(file);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::string path = argc > 2 ? argv[2] : "/tmp/m3log_bulk_bench.log";
+    writeCorpus(path.c_str(), megabytes);
+
+    size_t cores = std::thread::hardware_concurrency();
+    std::printf("corpus: %zu MB, %zu cores\n\n", megabytes, cores);
+    std::printf("%8s %12s %10s %9s\n", "threads", "entries", "MB/s", "scaling");
+
+    double baseline = 0;
+    for (size_t threads = 1; threads <= cores; threads *= 2) {
+        m3log_bulk_options_t options = {};
+        options.threads = threads;
+
+        m3log_bulk_stats_t stats;
+        auto start = std::chrono::steady_clock::now();
+        m3log_error_t err = m3log_bulk_parse_file(path.c_str(), &options, countTags, nullptr, &stats);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (err != M3LOG_SUCCESS) {
+            std::fprintf(stderr, "m3log_bulk_parse_file failed: %d\n", err);
+            return 1;
+        }
+
+        double rate = stats.bytes / seconds / 1e6;
+        if (threads == 1) {
+            baseline = rate;
+        }
+        std::printf("%8zu %12zu %10.1f %8.2fx\n", stats.threads, stats.entries, rate, rate / baseline);
+    }
+
+    m3log_bulk_options_t ordered = {};
+    ordered.preserve_order = 1;
+    ordered.chunk_size = 1 << 20;
+    size_t expected = 0;
+    m3log_bulk_stats_t stats;
+    auto start = std::chrono::steady_clock::now();
+    m3log_bulk_parse_file(path.c_str(), &ordered, checkOrder, &expected, &stats);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("\npreserve_order (%zu threads): %.1f MB/s, %zu chunks in order\n", stats.threads,
+                stats.bytes / seconds / 1e6, expected);
+
+    unlink(path.c_str());
+    return 0;
+}
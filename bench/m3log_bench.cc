@@ -0,0 +1,559 @@
+// m3log 综合基准：format / log / parse 三组，结果可写为 JSON 以便跟踪回归
+//
+//   cmake -S . -B build && cmake --build build --target m3log_bench
+//   ./build/bench/m3log_bench                                   # 全部，输出表格
+//   ./build/bench/m3log_bench --suite log --threads 1,4,16 --json log.json
+//   ./build/bench/m3log_bench --quick --json -                  # 缩小规模，JSON 输出到标准输出
+//
+// format：单线程 Logger::format / formatTo 的 ns/op，扫描标签数与消息长度
+// log：1~64 个生产者线程调用 log() 的吞吐与单次调用延迟分位数（p50/p99/p99.9），
+//      输出目标为 /dev/null、tmpfs（默认 /dev/shm）与普通文件，同步与异步模式各测一次；
+//      延迟包含两次 steady_clock 读取的开销，lines_per_sec 计入最后 flush 的时间
+// parse：m3log_parse 与 m3log_parse_view 在合成语料上的 MB/s
+
+#include "m3log.h"
+#include "m3log.hh"
+#include "m3log_simd.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ---- 结果与输出 ----
+
+struct Result {
+    std::string suite;
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+void appendJsonString(std::string& out, std::string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        switch (c) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out.append(escaped);
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+std::string toJson(const std::vector<Result>& results, const std::vector<std::pair<std::string, std::string>>& meta) {
+    std::string out = "{\n  \"meta\": {";
+    for (size_t i = 0; i < meta.size(); ++i) {
+        out.append(i ? ", " : "");
+        appendJsonString(out, meta[i].first);
+        out.append(": ");
+        appendJsonString(out, meta[i].second);
+    }
+    out.append("},\n  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out.append("    {\"suite\": ");
+        appendJsonString(out, r.suite);
+        out.append(", \"name\": ");
+        appendJsonString(out, r.name);
+        out.append(", \"params\": {");
+        for (size_t j = 0; j < r.params.size(); ++j) {
+            out.append(j ? ", " : "");
+            appendJsonString(out, r.params[j].first);
+            out.append(": ");
+            appendJsonString(out, r.params[j].second);
+        }
+        out.append("}, \"metrics\": {");
+        for (size_t j = 0; j < r.metrics.size(); ++j) {
+            char number[64];
+            std::snprintf(number, sizeof(number), "%.6g", r.metrics[j].second);
+            out.append(j ? ", " : "");
+            appendJsonString(out, r.metrics[j].first);
+            out.append(": ");
+            out.append(number);
+        }
+        out.append(i + 1 < results.size() ? "}},\n" : "}}\n");
+    }
+    out.append("  ]\n}\n");
+    return out;
+}
+
+void printResult(const Result& r) {
+    std::string params;
+    for (const auto& [key, value] : r.params) {
+        params += key + "=" + value + " ";
+    }
+    std::string metrics;
+    for (const auto& [key, value] : r.metrics) {
+        char text[96];
+        std::snprintf(text, sizeof(text), "%s=%.4g ", key.c_str(), value);
+        metrics += text;
+    }
+    std::fprintf(stderr, "%-7s %-12s %-44s %s\n", r.suite.c_str(), r.name.c_str(), params.c_str(), metrics.c_str());
+}
+
+// ---- 参数 ----
+
+struct Options {
+    std::vector<std::string> suites{"format", "log", "parse"};
+    std::vector<unsigned> threads{1, 2, 4, 8, 16, 32, 64};
+    std::vector<std::string> targets{"devnull", "tmpfs", "file"};
+    std::vector<std::string> modes{"sync", "async"};
+    std::string tmpfsDir = "/dev/shm";
+    std::string fileDir = ".";
+    std::string jsonPath;
+    size_t lines = 400000;        // 每个 log 用例的总行数
+    size_t messageSize = 128;     // log 用例的消息长度
+    size_t corpusBytes = 32 << 20;  // 每种解析语料的大小
+    double minSeconds = 0.2;      // format 用例的最短测量时间
+};
+
+std::vector<std::string> splitList(const char* text) {
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* p = text;; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            item.clear();
+            if (*p == '\0') {
+                break;
+            }
+        } else {
+            item.push_back(*p);
+        }
+    }
+    return items;
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: m3log_bench [--suite format,log,parse] [--threads 1,2,4,...] [--targets devnull,tmpfs,file]\n"
+                 "                   [--modes sync,async] [--lines N] [--message-size N] [--corpus-mb N]\n"
+                 "                   [--tmpfs-dir DIR] [--file-dir DIR] [--json PATH|-] [--quick]\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto next = [&]() {
+            ++i;
+            return value;
+        };
+        if (arg == "--quick") {
+            options.threads = {1, 4, 16};
+            options.lines = 50000;
+            options.corpusBytes = 4 << 20;
+            options.minSeconds = 0.02;
+        } else if (!value) {
+            usage();
+            return false;
+        } else if (arg == "--suite") {
+            options.suites = splitList(next());
+        } else if (arg == "--threads") {
+            options.threads.clear();
+            for (const std::string& item : splitList(next())) {
+                options.threads.push_back(static_cast<unsigned>(std::max(1, std::atoi(item.c_str()))));
+            }
+        } else if (arg == "--targets") {
+            options.targets = splitList(next());
+        } else if (arg == "--modes") {
+            options.modes = splitList(next());
+        } else if (arg == "--lines") {
+            options.lines = std::strtoull(next(), nullptr, 10);
+        } else if (arg == "--message-size") {
+            options.messageSize = std::strtoull(next(), nullptr, 10);
+        } else if (arg == "--corpus-mb") {
+            options.corpusBytes = std::strtoull(next(), nullptr, 10) << 20;
+        } else if (arg == "--tmpfs-dir") {
+            options.tmpfsDir = next();
+        } else if (arg == "--file-dir") {
+            options.fileDir = next();
+        } else if (arg == "--json") {
+            options.jsonPath = next();
+        } else {
+            usage();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool wants(const std::vector<std::string>& list, std::string_view item) {
+    return std::find(list.begin(), list.end(), item) != list.end();
+}
+
+// 防止编译器优化掉结果
+volatile size_t g_sink;
+
+std::string makeMessage(size_t length) {
+    std::string message;
+    message.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        message.push_back(i % 12 == 11 ? ' ' : static_cast<char>('a' + i % 26));
+    }
+    return message;
+}
+
+std::vector<std::string> makeTags(size_t count) {
+    std::vector<std::string> tags;
+    for (size_t i = 0; i < count; ++i) {
+        tags.push_back("tag" + std::to_string(i));
+    }
+    return tags;
+}
+
+// 至少运行 minSeconds，按需倍增迭代次数，返回 ns/op
+template <typename F>
+double measureNsPerOp(double minSeconds, F&& body) {
+    for (size_t iterations = 64;; iterations *= 2) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            body();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= minSeconds || iterations >= (size_t(1) << 32)) {
+            return seconds * 1e9 / static_cast<double>(iterations);
+        }
+    }
+}
+
+// ---- format ----
+
+void benchFormat(const Options& options, std::vector<Result>& results) {
+    m3log::Logger& logger = m3log::Logger::instance();
+    const size_t tagCounts[] = {0, 1, 4, 8};
+    const size_t messageSizes[] = {16, 128, 1024, 8192};
+
+    for (size_t tagCount : tagCounts) {
+        std::vector<std::string> tags = makeTags(tagCount);
+        m3log::TagSet tagSet = logger.internTags(tags);
+        for (size_t size : messageSizes) {
+            std::string message = makeMessage(size);
+            std::vector<std::pair<std::string, std::string>> params = {
+                {"tags", std::to_string(tagCount)}, {"message_bytes", std::to_string(size)}};
+
+            double formatNs = measureNsPerOp(options.minSeconds, [&] {
+                g_sink = logger.format(m3log::LogLevel::INFO, tags, message).size();
+            });
+            results.push_back({"format", "format", params, {{"ns_per_op", formatNs}}});
+            printResult(results.back());
+
+            std::string out;
+            double formatToNs = measureNsPerOp(options.minSeconds, [&] {
+                logger.formatTo(out, m3log::LogLevel::INFO, tagSet, message);
+                g_sink = out.size();
+            });
+            results.push_back({"format", "formatTo", params, {{"ns_per_op", formatToNs}}});
+            printResult(results.back());
+        }
+    }
+}
+
+// ---- log ----
+
+double percentile(std::vector<uint32_t>& samples, double p) {
+    if (samples.empty()) {
+        return 0;
+    }
+    size_t index = std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(index), samples.end());
+    return samples[index];
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void benchLog(const Options& options, std::vector<Result>& results) {
+    m3log::Logger& logger = m3log::Logger::instance();
+    logger.setConsoleOutput(false);
+    m3log::TagSet tags = logger.internTags({"bench", "log"});
+    std::string message = makeMessage(options.messageSize);
+
+    for (const std::string& target : options.targets) {
+        std::string path;
+        if (target == "devnull") {
+            path = "/dev/null";
+        } else if (target == "tmpfs") {
+            if (!isDirectory(options.tmpfsDir)) {
+                std::fprintf(stderr, "skip tmpfs: %s not found\n", options.tmpfsDir.c_str());
+                continue;
+            }
+            path = options.tmpfsDir + "/m3log_bench.log";
+        } else if (target == "file") {
+            path = options.fileDir + "/m3log_bench.log";
+        } else {
+            std::fprintf(stderr, "unknown target: %s\n", target.c_str());
+            continue;
+        }
+
+        for (const std::string& mode : options.modes) {
+            for (unsigned threads : options.threads) {
+                if (path != "/dev/null") {
+                    unlink(path.c_str());
+                }
+                logger.setAsyncMode(mode == "async", 65536, m3log::OverflowPolicy::Block);
+                logger.setOutputFile(path);
+
+                uint64_t droppedBefore = logger.droppedCount();
+                size_t perThread = std::max<size_t>(1, options.lines / threads);
+                std::vector<std::vector<uint32_t>> latencies(threads);
+                std::atomic<unsigned> ready{0};
+                std::atomic<bool> go{false};
+                std::vector<std::thread> producers;
+
+                for (unsigned t = 0; t < threads; ++t) {
+                    producers.emplace_back([&, t] {
+                        std::vector<uint32_t>& samples = latencies[t];
+                        samples.reserve(perThread);
+                        ready.fetch_add(1);
+                        while (!go.load(std::memory_order_acquire)) {
+                            std::this_thread::yield();
+                        }
+                        for (size_t i = 0; i < perThread; ++i) {
+                            auto start = Clock::now();
+                            logger.log(m3log::LogLevel::INFO, tags, message);
+                            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                            samples.push_back(static_cast<uint32_t>(std::min<int64_t>(ns, UINT32_MAX)));
+                        }
+                    });
+                }
+                while (ready.load() < threads) {
+                    std::this_thread::yield();
+                }
+
+                auto start = Clock::now();
+                go.store(true, std::memory_order_release);
+                for (std::thread& producer : producers) {
+                    producer.join();
+                }
+                double produceSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+                logger.flush();
+                double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+                std::vector<uint32_t> merged;
+                merged.reserve(perThread * threads);
+                for (const auto& samples : latencies) {
+                    merged.insert(merged.end(), samples.begin(), samples.end());
+                }
+                double total = static_cast<double>(merged.size());
+
+                Result result{"log", "log", {{"target", target}, {"mode", mode}, {"threads", std::to_string(threads)},
+                                             {"message_bytes", std::to_string(options.messageSize)}}, {}};
+                result.metrics = {
+                    {"lines_per_sec", total / totalSeconds},
+                    {"producer_lines_per_sec", total / produceSeconds},
+                    {"p50_ns", percentile(merged, 0.50)},
+                    {"p99_ns", percentile(merged, 0.99)},
+                    {"p999_ns", percentile(merged, 0.999)},
+                    {"max_ns", static_cast<double>(*std::max_element(merged.begin(), merged.end()))},
+                    {"dropped", static_cast<double>(logger.droppedCount() - droppedBefore)},
+                };
+                results.push_back(std::move(result));
+                printResult(results.back());
+
+                logger.closeOutputFile();
+                if (path != "/dev/null") {
+                    unlink(path.c_str());
+                }
+            }
+        }
+    }
+    logger.setAsyncMode(false);
+}
+
+// ---- parse ----
+
+struct Corpus {
+    std::string name;
+    std::string data;            // 各行以 '\0' 分隔，m3log_parse 需要以 '\0' 结尾的字符串
+    std::vector<size_t> starts;  // 每行起始偏移
+    size_t textBytes = 0;        // 不含分隔符的字节数
+};
+
+Corpus makeCorpus(const std::string& name, size_t bytes) {
+    Corpus corpus;
+    corpus.name = name;
+    corpus.data.reserve(bytes + 4096);
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+    auto random = [&state] {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    const char* levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+    while (corpus.textBytes < bytes) {
+        std::string line = "@2026-10-16T12:34:56.789Z ";
+        size_t tagCount = name == "tags" ? 6 : 1 + random() % 2;
+        line.push_back('[');
+        for (size_t i = 0; i < tagCount; ++i) {
+            line.append(i ? " " : "");
+            line.append("mod" + std::to_string(random() % 50));
+        }
+        line.append("] #");
+        line.append(levels[random() % 4]);
+        line.append(": ");
+
+        size_t length = name == "short" ? 20 + random() % 40 : name == "long" ? 1500 + random() % 1000 : 80 + random() % 80;
+        for (size_t i = 0; i < length; ++i) {
+            if (name == "escaped" && i % 40 == 39) {
+                line.append("\\n");
+            } else {
+                line.push_back(i % 9 == 8 ? ' ' : static_cast<char>('a' + random() % 26));
+            }
+        }
+
+        corpus.starts.push_back(corpus.data.size());
+        corpus.data.append(line);
+        corpus.data.push_back('\0');
+        corpus.textBytes += line.size() + 1;  // 按带换行的文件大小计算
+    }
+    return corpus;
+}
+
+void freeEntryFields(m3log_entry_t& entry) {
+    free(entry.time);
+    for (size_t i = 0; i < entry.tags.count; ++i) {
+        free(entry.tags.tags[i]);
+    }
+    free(entry.tags.tags);
+    free(entry.content);
+}
+
+void benchParse(const Options& options, std::vector<Result>& results) {
+    for (const char* name : {"short", "tags", "long", "escaped"}) {
+        Corpus corpus = makeCorpus(name, options.corpusBytes);
+        double megabytes = static_cast<double>(corpus.textBytes) / (1 << 20);
+        double lines = static_cast<double>(corpus.starts.size());
+        char size[32];
+        std::snprintf(size, sizeof(size), "%.1f", megabytes);
+        std::vector<std::pair<std::string, std::string>> params = {
+            {"corpus", name}, {"lines", std::to_string(corpus.starts.size())}, {"mb", size}};
+
+        // m3log_parse：每行分配并释放字段
+        auto start = Clock::now();
+        size_t invalid = 0;
+        for (size_t offset : corpus.starts) {
+            m3log_entry_t entry;
+            if (m3log_parse(corpus.data.data() + offset, &entry) == M3LOG_SUCCESS) {
+                g_sink = entry.tags.count;
+                freeEntryFields(entry);
+            } else {
+                ++invalid;
+            }
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        results.push_back({"parse", "m3log_parse", params,
+                           {{"mb_per_sec", megabytes / seconds}, {"ns_per_line", seconds * 1e9 / lines},
+                            {"invalid", static_cast<double>(invalid)}}});
+        printResult(results.back());
+
+        // m3log_parse_view：零拷贝，不分配
+        char arenaBuffer[4096];
+        m3log_arena_t arena;
+        m3log_arena_init(&arena, arenaBuffer, sizeof(arenaBuffer));
+        start = Clock::now();
+        invalid = 0;
+        for (size_t i = 0; i < corpus.starts.size(); ++i) {
+            size_t offset = corpus.starts[i];
+            size_t end = i + 1 < corpus.starts.size() ? corpus.starts[i + 1] - 1 : corpus.data.size() - 1;
+            m3log_view_t view;
+            m3log_arena_reset(&arena);
+            if (m3log_parse_view(corpus.data.data() + offset, end - offset, &view, &arena) == M3LOG_SUCCESS) {
+                g_sink = view.content.len;
+            } else {
+                ++invalid;
+            }
+        }
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        results.push_back({"parse", "m3log_parse_view", params,
+                           {{"mb_per_sec", megabytes / seconds}, {"ns_per_line", seconds * 1e9 / lines},
+                            {"invalid", static_cast<double>(invalid)}}});
+        printResult(results.back());
+    }
+}
+
+std::string isoNow() {
+    std::time_t now = std::time(nullptr);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    m3log::Logger::instance().setConsoleOutput(false);
+
+    std::vector<Result> results;
+    if (wants(options.suites, "format")) {
+        benchFormat(options, results);
+    }
+    if (wants(options.suites, "log")) {
+        benchLog(options, results);
+    }
+    if (wants(options.suites, "parse")) {
+        benchParse(options, results);
+    }
+
+    if (!options.jsonPath.empty()) {
+        std::vector<std::pair<std::string, std::string>> meta = {
+            {"date", isoNow()},
+            {"compiler", __VERSION__},
+#if defined(NDEBUG)
+            {"assertions", "off"},
+#else
+            {"assertions", "on"},
+#endif
+            {"hardware_threads", std::to_string(std::thread::hardware_concurrency())},
+            {"simd", m3log_simd_name()},
+        };
+        std::string json = toJson(results, meta);
+        if (options.jsonPath == "-") {
+            std::fwrite(json.data(), 1, json.size(), stdout);
+        } else {
+            FILE* file = std::fopen(options.jsonPath.c_str(), "w");
+            if (!file) {
+                std::fprintf(stderr, "cannot write %s\n", options.jsonPath.c_str());
+                return 1;
+            }
+            std::fwrite(json.data(), 1, json.size(), file);
+            std::fclose(file);
+        }
+    }
+    return 0;
+}
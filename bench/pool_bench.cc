@@ -0,0 +1,153 @@
+// 池化条目与逐字段 malloc 条目的对比基准
+//
+// 每个线程循环执行 解析/创建 -> 短暂持有一批 -> 归还，模拟常驻采集进程：
+//   g++ -std=c++20 -O2 -pthread -Ic/include bench/pool_bench.cc -x c c/src/m3log_pool.c c/src/m3log.c c/src/m3log_view.c c/src/m3log_simd.c -o pool_bench
+//   ./pool_bench [threads]
+// 另一组在生产线程中取得、在消费线程中归还，覆盖线程缓存溢出到共享链表的路径。
+
+#include "m3log_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kBatch = 256;
+
+std::vector<std::string> makeCorpus() {
+    static const char* const levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < 1024; ++i) {
+        std::string line = "@2023-04-01T15:30:45.123Z [user auth node" + std::to_string(i % 64) + "] #" +
+                           levels[i % 4] + ": request " + std::to_string(i) + " completed ";
+        line.append(i % 9 * 40, 'x');
+        corpus.push_back(std::move(line));
+    }
+    return corpus;
+}
+
+void freeFields(m3log_entry_t& entry) {
+    free(entry.time);
+    for (size_t i = 0; i < entry.tags.count; ++i) {
+        free(entry.tags.tags[i]);
+    }
+    free(entry.tags.tags);
+    free(entry.content);
+}
+
+template <typename F>
+double run(size_t threads, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back(body, t);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    if (threads == 0) {
+        threads = 1;
+    }
+    const std::vector<std::string> corpus = makeCorpus();
+    const size_t rounds = 400;
+    const double operations = static_cast<double>(threads * rounds * corpus.size());
+
+    std::printf("%-34s %12s\n", "case", "ns/entry");
+
+    // 解析：m3log_parse + 逐字段 free 对比 m3log_pool_parse + m3log_pool_release
+    double seconds = run(threads, [&](size_t) {
+        std::vector<m3log_entry_t> held(kBatch);
+        for (size_t r = 0; r < rounds; ++r) {
+            for (size_t i = 0; i < corpus.size(); i += kBatch) {
+                for (size_t j = 0; j < kBatch; ++j) {
+                    m3log_parse(corpus[i + j].c_str(), &held[j]);
+                }
+                for (size_t j = 0; j < kBatch; ++j) {
+                    freeFields(held[j]);
+                }
+            }
+        }
+    });
+    std::printf("%-34s %12.1f\n", "m3log_parse + free", seconds * 1e9 / operations * threads);
+
+    m3log_pool_t* pool = m3log_pool_create(nullptr);
+    seconds = run(threads, [&](size_t) {
+        std::vector<m3log_entry_t*> held(kBatch);
+        for (size_t r = 0; r < rounds; ++r) {
+            for (size_t i = 0; i < corpus.size(); i += kBatch) {
+                for (size_t j = 0; j < kBatch; ++j) {
+                    m3log_pool_parse(pool, corpus[i + j].data(), corpus[i + j].size(), &held[j]);
+                }
+                for (size_t j = 0; j < kBatch; ++j) {
+                    m3log_pool_release(pool, held[j]);
+                }
+            }
+        }
+    });
+    std::printf("%-34s %12.1f\n", "m3log_pool_parse + release", seconds * 1e9 / operations * threads);
+
+    // 创建：m3log_create_entry + m3log_free_entry 对比池化版本
+    const char* tags[] = {"user", "auth", "login"};
+    seconds = run(threads, [&](size_t) {
+        for (size_t r = 0; r < rounds; ++r) {
+            for (const auto& line : corpus) {
+                m3log_free_entry(m3log_create_entry(line.c_str() + 50, M3LOG_LEVEL_INFO, tags, 3));
+            }
+        }
+    });
+    std::printf("%-34s %12.1f\n", "m3log_create_entry + free", seconds * 1e9 / operations * threads);
+
+    seconds = run(threads, [&](size_t) {
+        for (size_t r = 0; r < rounds; ++r) {
+            for (const auto& line : corpus) {
+                m3log_pool_release(pool, m3log_pool_create_entry(pool, line.c_str() + 50, M3LOG_LEVEL_INFO, tags, 3));
+            }
+        }
+    });
+    std::printf("%-34s %12.1f\n", "m3log_pool_create_entry + release", seconds * 1e9 / operations * threads);
+
+    // 跨线程：生产线程取得、消费线程归还
+    std::vector<std::atomic<m3log_entry_t*>> slots(4096);
+    const size_t total = rounds * corpus.size();
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&] {
+        for (size_t n = 0; n < total; ++n) {
+            m3log_entry_t* entry;
+            while (!(entry = slots[n % slots.size()].exchange(nullptr, std::memory_order_acquire))) {
+                std::this_thread::yield();
+            }
+            m3log_pool_release(pool, entry);
+        }
+    });
+    for (size_t n = 0; n < total; ++n) {
+        const std::string& line = corpus[n % corpus.size()];
+        m3log_entry_t* entry = nullptr;
+        m3log_pool_parse(pool, line.data(), line.size(), &entry);
+        while (slots[n % slots.size()].load(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+        }
+        slots[n % slots.size()].store(entry, std::memory_order_release);
+    }
+    consumer.join();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-34s %12.1f\n", "pool parse -> release (2 threads)", seconds * 1e9 / static_cast<double>(total));
+
+    m3log_pool_stats_t stats;
+    m3log_pool_stats(pool, &stats);
+    std::printf("\npool: %zu chunks, %.1f KB reserved, %zu shared free, %zu oversize\n", stats.chunks,
+                stats.reserved_bytes / 1024.0, stats.shared_free, stats.oversize);
+    m3log_pool_destroy(pool);
+    return 0;
+}
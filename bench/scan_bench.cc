@@ -0,0 +1,148 @@
+// 换行转义与分隔符扫描内核的微基准
+//
+// 对比旧实现（std::regex 转义、strchr 链式查找）与新实现（m3log_simd 转义内核、m3log_parse_view 解析头部）：
+//   g++ -std=c++20 -O2 -Ic/include bench/scan_bench.cc -x c c/src/m3log_simd.c c/src/m3log_view.c c/src/m3log.c -o scan_bench
+//   ./scan_bench                    # 自动选择 avx2/sse2
+//   M3LOG_SIMD=scalar ./scan_bench  # 强制标量内核
+//
+// parse_view 各行的旧实现一栏只做 strchr 定位，新实现一栏是完整的 m3log_parse_view（另含标签切分、
+// 级别识别与内容去空白），短行上新实现因此更慢；要看的是耗时是否随消息长度增长
+
+#include "m3log.h"
+#include "m3log_simd.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <typename F>
+double nsPerOp(size_t iterations, F&& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+// 防止编译器优化掉结果
+volatile size_t g_sink;
+
+std::string makeMessage(size_t length, size_t newlineEvery) {
+    std::string message;
+    message.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        if (newlineEvery && i % newlineEvery == newlineEvery - 1) {
+            message.push_back('\n');
+        } else {
+            message.push_back(static_cast<char>('a' + i % 26));
+        }
+    }
+    return message;
+}
+
+// 旧版 Logger::escapeMessage
+std::string escapeRegex(const std::string& message) {
+    std::regex newlineRegex("\n");
+    return std::regex_replace(message, newlineRegex, "\\n");
+}
+
+std::string escapeKernel(const std::string& message) {
+    std::string out(message.size() + m3log_count_newlines(message.data(), message.size()), '\0');
+    out.resize(m3log_escape_newlines(message.data(), message.size(), out.data()));
+    return out;
+}
+
+// 旧版 m3log_parse 的 strchr 链式分隔符查找（只定位，不拷贝）
+size_t locateStrchr(const char* line) {
+    const char* p = strchr(line + 1, ' ');
+    const char* tags = strchr(p, '[');
+    if (tags) {
+        p = strchr(tags, ']');
+    }
+    const char* level = strchr(p, '#');
+    const char* colon = strchr(level ? level : p, ':');
+    return static_cast<size_t>(colon - line);
+}
+
+// 新版：直接调用 m3log_parse_view（栈上 arena，不分配），除定位分隔符外还切分标签
+size_t locateView(const std::string& line) {
+    char buffer[1024];
+    m3log_arena_t arena;
+    m3log_arena_init(&arena, buffer, sizeof(buffer));
+    m3log_view_t view;
+    if (m3log_parse_view(line.data(), line.size(), &view, &arena) != M3LOG_SUCCESS) {
+        return 0;
+    }
+    return static_cast<size_t>(view.content.ptr - line.data());
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernel: %s\n\n", m3log_simd_name());
+
+    std::printf("%-28s %10s %12s %12s %9s\n", "case", "bytes", "old ns/op", "new ns/op", "speedup");
+    const size_t sizes[] = {64, 512, 4096, 65536};
+
+    for (size_t length : sizes) {
+        size_t iterations = 4000000 / (length / 16 + 1) + 100;
+
+        for (size_t every : {size_t(0), size_t(80)}) {
+            std::string message = makeMessage(length, every);
+            double oldNs = nsPerOp(iterations / 20 + 1, [&] { g_sink = escapeRegex(message).size(); });
+            double newNs = nsPerOp(iterations, [&] { g_sink = escapeKernel(message).size(); });
+            char name[64];
+            std::snprintf(name, sizeof(name), "escape %s", every ? "(nl/80B)" : "(no nl)");
+            std::printf("%-28s %10zu %12.1f %12.1f %8.1fx\n", name, length, oldNs, newNs, oldNs / newNs);
+        }
+
+        // 不同头部组合：缺少标签或级别时，旧实现会为查找它们扫描整段消息
+        const char* heads[][2] = {
+            {"parse_view [tags] #LEVEL", "@2023-04-01T15:30:45.123Z [user auth] #INFO: "},
+            {"parse_view #LEVEL only", "@2023-04-01T15:30:45.123Z #INFO: "},
+            {"parse_view [tags] only", "@2023-04-01T15:30:45.123Z [user auth]: "},
+        };
+        for (const auto& head : heads) {
+            std::string line = head[1] + makeMessage(length, 0);
+            double oldNs = nsPerOp(iterations, [&] { g_sink = locateStrchr(line.c_str()); });
+            double newNs = nsPerOp(iterations, [&] { g_sink = locateView(line); });
+            std::printf("%-28s %10zu %12.1f %12.1f %8.1fx\n", head[0], line.size(), oldNs, newNs, oldNs / newNs);
+        }
+    }
+
+    // 完整 m3log_parse 吞吐
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < 1024; ++i) {
+        corpus.push_back("@2023-04-01T15:30:45.123Z [user auth login] #INFO: " + makeMessage(64 + i % 512, 0));
+    }
+    size_t totalBytes = 0;
+    for (const auto& line : corpus) {
+        totalBytes += line.size();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const int rounds = 200;
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto& line : corpus) {
+            m3log_entry_t entry;
+            if (m3log_parse(line.c_str(), &entry) == M3LOG_SUCCESS) {
+                g_sink = entry.tags.count;
+                free(entry.time);
+                for (size_t i = 0; i < entry.tags.count; ++i) {
+                    free(entry.tags.tags[i]);
+                }
+                free(entry.tags.tags);
+                free(entry.content);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("\nm3log_parse: %.1f MB/s\n", totalBytes * rounds / seconds / 1e6);
+    return 0;
+}
@@ -0,0 +1,106 @@
+// 分片输出基准：多个线程同步写日志时单个输出文件与按线程分片的吞吐，以及分片的归并速度
+//
+//   g++ -std=c++20 -O2 -pthread -Icpp -Ic/include bench/shard_bench.cc cpp/m3log.cc cpp/m3log_archive.cc cpp/m3log_binary.cc cpp/m3log_config.cc cpp/m3log_dedup.cc cpp/m3log_limit.cc cpp/m3log_metrics.cc cpp/m3log_recorder.cc cpp/m3log_shard.cc cpp/m3log_sink.cc cpp/m3log_timestamp.cc cpp/m3log_writer.cc -x c c/src/m3log_merge.c c/src/m3log_simd.c c/src/m3log_index.c c/src/m3log_view.c c/src/m3log.c -o shard_bench
+//   ./shard_bench [lines per thread] [max threads] [path]
+// 控制台输出关闭；single 为 setOutputFile（所有线程共享一个 sink 队列与写线程），
+// sharded 为 setShardedOutput（每个线程写自己的文件）。归并结果逐行检查时间戳不减。
+
+#include "m3log.hh"
+#include "m3log_index.h"
+#include "m3log_merge.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace m3log;
+
+double run(size_t threads, size_t lines) {
+    Logger& logger = Logger::instance();
+    TagSet tags = logger.internTags({"bench", "shard"});
+    std::string message(80, 'x');
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (size_t i = 0; i < lines; ++i) {
+                logger.log(LogLevel::INFO, tags, message);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    logger.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(threads * lines) / seconds;
+}
+
+struct MergeCheck {
+    int64_t last = INT64_MIN;
+    size_t lines = 0;
+    bool ordered = true;
+};
+
+int checkLine(const char* line, size_t len, size_t, void* userData) {
+    MergeCheck& check = *static_cast<MergeCheck*>(userData);
+    const char* space = static_cast<const char*>(std::memchr(line, ' ', len));
+    int64_t time;
+    if (line[0] == '@' && space && m3log_index_parse_time(line + 1, space - line - 1, &time) == M3LOG_SUCCESS) {
+        check.ordered = check.ordered && time >= check.last;
+        check.last = time;
+    }
+    ++check.lines;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    size_t maxThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    std::string path = argc > 3 ? argv[3] : "/tmp/m3log_shard_bench.log";
+
+    Logger& logger = Logger::instance();
+    logger.setConsoleOutput(false);
+
+    std::printf("%8s %16s %16s %16s\n", "threads", "single lines/s", "sharded lines/s", "merge lines/s");
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        unlink(path.c_str());
+        logger.setOutputFile(path);
+        double single = run(threads, lines);
+        logger.closeOutputFile();
+
+        for (size_t shard = 0; shard < threads; ++shard) {
+            unlink((path + ".shard" + std::to_string(shard)).c_str());
+        }
+        logger.setShardedOutput(path);
+        double sharded = run(threads, lines);
+        std::vector<std::string> shards = logger.shardPaths();
+        logger.closeShardedOutput();
+
+        std::vector<const char*> inputs;
+        for (const std::string& shard : shards) {
+            inputs.push_back(shard.c_str());
+        }
+        MergeCheck check;
+        auto start = std::chrono::steady_clock::now();
+        m3log_merge_files(inputs.data(), inputs.size(), nullptr, checkLine, &check, nullptr);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (check.lines != threads * lines || !check.ordered) {
+            std::fprintf(stderr, "merge check failed: %zu lines, ordered=%d\n", check.lines, check.ordered);
+            return 1;
+        }
+        std::printf("%8zu %16.0f %16.0f %16.0f\n", threads, single, sharded, check.lines / seconds);
+    }
+    return 0;
+}
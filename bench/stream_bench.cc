@@ -0,0 +1,144 @@
+// 管道输入的流式解析基准
+//
+// 写线程把生成的日志按 4KB 块写入管道，读端分别用以下方式解析：
+//   getline + m3log_parse：调用方自己切行，每行复制到 getline 缓冲区，再由 m3log_parse 分配字段
+//   m3log_stream_feed：read() 到调用方缓冲区后交给流式解析器
+//   m3log_stream_buffer/commit：read() 直接写入解析器的缓冲区
+//   g++ -std=c++20 -O2 -pthread -Ic/include bench/stream_bench.cc -x c c/src/m3log_stream.c c/src/m3log_view.c c/src/m3log_simd.c c/src/m3log.c -o stream_bench
+//   ./stream_bench [MB]
+// 约 1% 的日志带续行；getline 方式不处理续行，因此它的行数会多于流式解析。
+
+#include "m3log_stream.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr size_t kWriteSize = 4096;
+constexpr size_t kReadSize = 64 << 10;
+
+std::string makeCorpus(size_t bytes) {
+    static const char* const levels[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    std::string corpus;
+    for (size_t i = 0; corpus.size() < bytes; ++i) {
+        corpus += "@2023-04-01T15:30:45.123Z [user auth node" + std::to_string(i % 64) + "] #" + levels[i % 4] +
+                  ": request " + std::to_string(i) + " completed in " + std::to_string(i % 997) + "ms";
+        if (i % 100 == 0) {
+            corpus += " with details\\\n  stack frame " + std::to_string(i);
+        }
+        corpus += '\n';
+    }
+    return corpus;
+}
+
+// 每轮创建一个管道，写线程写完后关闭写端；返回读端处理完所有数据的耗时
+template <typename F>
+double throughPipe(const std::string& corpus, F&& reader) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::perror("pipe");
+        std::exit(1);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::thread writer([&] {
+        for (size_t offset = 0; offset < corpus.size();) {
+            size_t n = std::min(kWriteSize, corpus.size() - offset);
+            ssize_t written = write(fds[1], corpus.data() + offset, n);
+            if (written <= 0) {
+                break;
+            }
+            offset += static_cast<size_t>(written);
+        }
+        close(fds[1]);
+    });
+    reader(fds[0]);
+    writer.join();
+    close(fds[0]);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int countEntry(const m3log_view_t* view, const char*, size_t, uint64_t, void* userData) {
+    *static_cast<size_t*>(userData) += view->tag_count;
+    return 0;
+}
+
+void report(const char* name, double seconds, size_t bytes, size_t lines) {
+    std::printf("%-28s %10.1f %12zu\n", name, bytes / seconds / (1 << 20), lines);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const std::string corpus = makeCorpus(megabytes << 20);
+    std::printf("%-28s %10s %12s\n", "case", "MB/s", "lines");
+
+    size_t lines = 0;
+    double seconds = throughPipe(corpus, [&](int fd) {
+        FILE* in = fdopen(dup(fd), "r");
+        char* line = nullptr;
+        size_t capacity = 0;
+        ssize_t len;
+        while ((len = getline(&line, &capacity, in)) > 0) {
+            line[len - 1] = line[len - 1] == '\n' ? '\0' : line[len - 1];
+            m3log_entry_t entry;
+            if (m3log_parse(line, &entry) == M3LOG_SUCCESS) {
+                ++lines;
+                free(entry.time);
+                for (size_t i = 0; i < entry.tags.count; ++i) {
+                    free(entry.tags.tags[i]);
+                }
+                free(entry.tags.tags);
+                free(entry.content);
+            }
+        }
+        free(line);
+        fclose(in);
+    });
+    report("getline + m3log_parse", seconds, corpus.size(), lines);
+
+    size_t tags = 0;
+    m3log_stream_t* stream = nullptr;
+    if (m3log_stream_create(nullptr, countEntry, &tags, &stream) != M3LOG_SUCCESS) {
+        std::fprintf(stderr, "m3log_stream_create failed\n");
+        return 1;
+    }
+    seconds = throughPipe(corpus, [&](int fd) {
+        static char buffer[kReadSize];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            m3log_stream_feed(stream, buffer, static_cast<size_t>(n));
+        }
+        m3log_stream_finish(stream);
+    });
+    m3log_stream_stats_t stats;
+    m3log_stream_stats(stream, &stats);
+    report("m3log_stream_feed", seconds, corpus.size(), stats.entries);
+
+    m3log_stream_reset(stream);
+    seconds = throughPipe(corpus, [&](int fd) {
+        for (;;) {
+            size_t capacity;
+            char* buffer = m3log_stream_buffer(stream, &capacity);
+            ssize_t n = read(fd, buffer, capacity);
+            if (n <= 0) {
+                break;
+            }
+            m3log_stream_commit(stream, static_cast<size_t>(n));
+        }
+        m3log_stream_finish(stream);
+    });
+    m3log_stream_stats(stream, &stats);
+    report("m3log_stream_buffer/commit", seconds, corpus.size(), stats.entries);
+    std::printf("\nstream: %zu continuation lines joined, %zu lines delivered from the stream buffer\n", stats.continued,
+                stats.carried);
+    m3log_stream_destroy(stream);
+    return tags == 0;
+}
@@ -47,6 +47,42 @@ typedef struct {
     char *content;       /* 消息内容 */
 } m3log_entry_t;
 
+/**
+ * 指向外部缓冲区的字符串切片（不以 '\0' 结尾）
+ */
+typedef struct {
+    const char *ptr; /* 起始位置，空切片时可能为 NULL */
+    size_t len;      /* 字节数 */
+} m3log_slice_t;
+
+/**
+ * 视图中内联存放的标签数量，超出部分从 arena 分配
+ */
+#define M3LOG_VIEW_INLINE_TAGS 8
+
+/**
+ * 零拷贝解析结果：所有切片都指向输入缓冲区，输入在使用期间必须保持有效
+ * 注意：tags 可能指向本结构体内的 inline_tags，复制结构体后请勿使用副本的 tags
+ */
+typedef struct {
+    m3log_slice_t time;      /* 时间戳（不含 '@'），没有时间戳时 len 为 0 */
+    m3log_slice_t tags_text; /* '[' 与 ']' 之间的原始标签文本 */
+    m3log_slice_t *tags;     /* 标签切片数组 */
+    size_t tag_count;        /* 标签数量 */
+    m3log_level_t level;     /* 日志级别 */
+    m3log_slice_t content;   /* 去除首尾空白后的消息内容（保持转义形式） */
+    m3log_slice_t inline_tags[M3LOG_VIEW_INLINE_TAGS];
+} m3log_view_t;
+
+/**
+ * 由调用方提供内存的线性分配器，可按批次整体重置
+ */
+typedef struct {
+    char *base;      /* 缓冲区起始地址 */
+    size_t capacity; /* 缓冲区大小 */
+    size_t used;     /* 已使用字节数 */
+} m3log_arena_t;
+
 /**
  * 错误码
  */
@@ -55,20 +91,74 @@ typedef enum {
     M3LOG_ERROR_INVALID_FORMAT,
     M3LOG_ERROR_MEMORY_ALLOCATION,
     M3LOG_ERROR_INVALID_ARGUMENT,
-    M3LOG_ERROR_BUFFER_TOO_SMALL
+    M3LOG_ERROR_BUFFER_TOO_SMALL,
+    M3LOG_ERROR_IO,
+    M3LOG_ERROR_ABORTED
 } m3log_error_t;
 
 /**
- * 初始化 m3log 库
+ * m3log_log 默认的输出缓冲区大小（字节）
+ */
+#define M3LOG_DEFAULT_BUFFER_SIZE (64u << 10)
+
+/**
+ * 输出回调，每次收到若干条完整的日志行（各以 '\n' 结尾）
+ * 回调在库的锁内执行，期间不能再调用 m3log_log
+ * @param data 日志数据，仅在回调期间有效
+ * @param len 字节数
+ * @param user_data 调用方数据
+ */
+typedef void (*m3log_write_callback_t)(const char *data, size_t len, void *user_data);
+
+/**
+ * m3log_log 的输出配置，使用前由 m3log_config_default 填充默认值
+ */
+typedef struct {
+    int fd;                          /* 输出文件描述符，默认 2（标准错误），库不会关闭它 */
+    m3log_write_callback_t callback; /* 非 NULL 时代替 fd 接收输出 */
+    void *user_data;                 /* 传递给回调的数据 */
+    m3log_level_t min_level;         /* 低于该级别的日志直接丢弃，默认 M3LOG_LEVEL_DEBUG */
+    size_t buffer_size;              /* 批量缓冲区大小，默认 M3LOG_DEFAULT_BUFFER_SIZE，最小 256；更长的单行单独输出 */
+    m3log_level_t flush_level;       /* 不低于该级别的日志写入后立即刷新，默认 M3LOG_LEVEL_ERROR */
+    unsigned flush_interval_ms;      /* 距上次刷新超过该时间时，下一条日志写入后刷新，默认 100；0 表示逐条刷新 */
+} m3log_config_t;
+
+/**
+ * 使用默认值填充输出配置
+ * @param config 输出配置
+ */
+void m3log_config_default(m3log_config_t *config);
+
+/**
+ * 以默认配置初始化 m3log 库，已初始化时不做任何事
  * @return M3LOG_SUCCESS 或错误码
  */
 m3log_error_t m3log_init(void);
 
 /**
- * 清理 m3log 库资源
+ * 以指定配置初始化（或重新配置）m3log 库，旧缓冲区中的日志先被刷新到旧的输出
+ * @param config 输出配置，NULL 表示默认配置
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_INVALID_ARGUMENT（没有回调且 fd 无效）或 M3LOG_ERROR_MEMORY_ALLOCATION
+ */
+m3log_error_t m3log_init_with(const m3log_config_t *config);
+
+/**
+ * 刷新缓冲区并清理 m3log 库资源，之后 m3log_log 恢复为默认配置
  */
 void m3log_cleanup(void);
 
+/**
+ * 立即写出缓冲区中的日志
+ * @return M3LOG_SUCCESS 或 M3LOG_ERROR_IO
+ */
+m3log_error_t m3log_flush(void);
+
+/**
+ * 设置 m3log_log 的最低级别，可在任意线程调用
+ * @param level 最低级别
+ */
+void m3log_set_min_level(m3log_level_t level);
+
 /**
  * 解析 m3log 格式的日志字符串
  * @param log_string 要解析的日志字符串
@@ -77,6 +167,48 @@ void m3log_cleanup(void);
  */
 m3log_error_t m3log_parse(const char *log_string, m3log_entry_t *entry);
 
+/**
+ * 零拷贝解析 m3log 日志行，不修改输入，也不调用 malloc
+ * @param line 日志行（无需以 '\0' 结尾）
+ * @param len 日志行长度
+ * @param view 解析结果，切片指向 line
+ * @param arena 标签数超过 M3LOG_VIEW_INLINE_TAGS 时用于分配标签数组，可为 NULL
+ * @return M3LOG_SUCCESS 或错误码；标签过多且 arena 不足时返回 M3LOG_ERROR_BUFFER_TOO_SMALL
+ */
+m3log_error_t m3log_parse_view(const char *line, size_t len, m3log_view_t *view, m3log_arena_t *arena);
+
+/**
+ * 将视图中的切片复制到 arena，使结果不再依赖原始输入缓冲区
+ * @param src 源视图
+ * @param arena 用于存放字符串与标签数组的 arena
+ * @param dst 目标视图（可与 src 相同）
+ * @return M3LOG_SUCCESS 或 M3LOG_ERROR_MEMORY_ALLOCATION（arena 空间不足）
+ */
+m3log_error_t m3log_view_copy(const m3log_view_t *src, m3log_arena_t *arena, m3log_view_t *dst);
+
+/**
+ * 使用调用方提供的缓冲区初始化 arena
+ * @param arena arena 结构体
+ * @param buffer 缓冲区
+ * @param capacity 缓冲区大小
+ */
+void m3log_arena_init(m3log_arena_t *arena, void *buffer, size_t capacity);
+
+/**
+ * 重置 arena，之前分配的内存全部失效
+ * @param arena arena 结构体
+ */
+void m3log_arena_reset(m3log_arena_t *arena);
+
+/**
+ * 从 arena 分配内存
+ * @param arena arena 结构体
+ * @param size 字节数
+ * @param align 对齐要求（2 的幂）
+ * @return 分配的内存，空间不足时返回 NULL
+ */
+void *m3log_arena_alloc(m3log_arena_t *arena, size_t size, size_t align);
+
 /**
  * 生成 m3log 格式的日志字符串
  * @param entry 日志条目结构体
@@ -118,12 +250,17 @@ const char* m3log_level_to_string(m3log_level_t level);
 m3log_level_t m3log_string_to_level(const char *level_str);
 
 /**
- * 快速记录日志的辅助函数
+ * 记录一条日志，写入 m3log_init / m3log_init_with 配置的输出（未初始化时使用默认配置）
+ * 线程安全；消息长度不受限制，其中的换行符被转义为 "\\n"。1KB 以内的消息在栈上渲染，
+ * 更长的消息在一块只增不减的共享缓冲区中渲染，稳定运行时不调用 malloc。
+ * 日志先进入批量缓冲区，按 flush_level、flush_interval_ms 或缓冲区放不下下一行时刷新，输出只收到完整的行；
+ * 没有后台线程，进程退出时剩余的日志由 atexit 钩子写出
  * @param level 日志级别
- * @param tags 逗号分隔的标签字符串
- * @param format 格式化字符串
+ * @param tags 逗号分隔的标签字符串，各标签去除首尾空白，可为 NULL
+ * @param format printf 风格的格式化字符串
  * @param ... 格式化参数
- * @return 成功返回 字符串，否则返回错误码
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_INVALID_FORMAT、M3LOG_ERROR_IO（本次刷新写入失败），
+ *         或 M3LOG_ERROR_MEMORY_ALLOCATION（消息超过此前出现过的最大长度且内存不足）
  */
 m3log_error_t m3log_log(m3log_level_t level, const char *tags, const char *format, ...);
 
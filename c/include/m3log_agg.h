@@ -0,0 +1,243 @@
+/**
+ * @file m3log_agg.h
+ * @brief m3log 流式聚合：按标签与级别统计各时间窗口内的行数与速率
+ * @version 0.1.0
+ *
+ * 聚合器逐条接收解析结果（来自文件、m3log_stream 或 m3log_bulk），按日志时间戳把每行计入
+ * 固定宽度的滚动窗口（桶），键为 (标签, 级别)；一行有多个标签时计入每个标签，另外按级别计入总数。
+ * 聚合器不保留日志内容，只保留最近 buckets 个桶的计数器：滑动窗口的计数与速率由相邻的桶求和得到。
+ *
+ * 计数器按 [桶][标签][级别] 稠密存放，内存约为 buckets × 标签数 × 5 × 8 字节；
+ * 标签与整组标签文本经由开放寻址的散列表映射为编号，相同的标签组合只需一次散列查找。
+ * 时间戳的日期到分钟部分与上一行相同时不再完整解析。
+ *
+ * 聚合器本身不是线程安全的：多线程解析时每个线程使用自己的聚合器，最后用 m3log_agg_merge
+ * 或 m3log_agg_merge_parallel 合并。仅支持 POSIX 平台（pthread 与 m3log_index 的时间解析）。
+ */
+
+#ifndef M3LOG_AGG_H
+#define M3LOG_AGG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "m3log.h"
+#include "m3log_bulk.h"
+#include "m3log_index.h"
+
+/**
+ * 聚合的级别数（DEBUG ~ FATAL）
+ */
+#define M3LOG_AGG_LEVELS 5
+
+/**
+ * 默认桶宽度（纳秒）：1 分钟
+ */
+#define M3LOG_AGG_DEFAULT_WIDTH (60ll * 1000000000ll)
+
+/**
+ * 默认保留的桶数
+ */
+#define M3LOG_AGG_DEFAULT_BUCKETS 60
+
+/**
+ * 默认最多跟踪的标签数
+ */
+#define M3LOG_AGG_DEFAULT_MAX_TAGS 4096
+
+/**
+ * 聚合器
+ */
+typedef struct m3log_agg m3log_agg_t;
+
+/**
+ * 桶关闭回调：桶关闭后不再接收数据，回调中可用 m3log_agg_count / m3log_agg_foreach 读取该桶
+ * @param agg 聚合器
+ * @param start 桶的起始时间（自 Unix 纪元以来的纳秒数），桶覆盖 [start, start + width)
+ * @param user_data 调用方数据
+ */
+typedef void (*m3log_agg_close_callback_t)(const m3log_agg_t *agg, int64_t start, void *user_data);
+
+/**
+ * 聚合选项，全部置零即使用默认值
+ */
+typedef struct {
+    int64_t width;      /* 桶宽度（纳秒），0 表示 M3LOG_AGG_DEFAULT_WIDTH */
+    size_t buckets;     /* 保留的桶数（查询与滑动窗口的最大跨度），0 表示 M3LOG_AGG_DEFAULT_BUCKETS */
+    size_t lateness;    /* 最新的桶之前还有多少个桶接收迟到的数据，更早的桶关闭；不超过 buckets - 1 */
+    size_t max_tags;    /* 最多跟踪的标签数，0 表示 M3LOG_AGG_DEFAULT_MAX_TAGS；之后出现的标签只计入总数 */
+    m3log_agg_close_callback_t on_close; /* 桶关闭回调，可为 NULL */
+    void *user_data;                     /* 传递给 on_close 的数据 */
+} m3log_agg_options_t;
+
+/**
+ * 聚合统计
+ */
+typedef struct {
+    uint64_t entries;   /* 计入的行数 */
+    uint64_t invalid;   /* 格式无效的行数（m3log_agg_add_line / m3log_agg_add_buffer） */
+    uint64_t untimed;   /* 没有时间戳或时间戳无法解析而被忽略的行数 */
+    uint64_t late;      /* 所属的桶已关闭而被忽略的行数 */
+    uint64_t untracked; /* 标签数达到 max_tags 后未计入的标签次数 */
+    size_t tags;        /* 跟踪的标签数 */
+} m3log_agg_stats_t;
+
+/**
+ * 遍历回调
+ * @param start 桶的起始时间（纳秒）
+ * @param tag 标签，NULL 表示该级别的总行数
+ * @param tag_len 标签长度
+ * @param level 级别
+ * @param count 行数，总是大于 0
+ * @param user_data 调用方数据
+ * @return 0 继续，非 0 停止遍历
+ */
+typedef int (*m3log_agg_foreach_callback_t)(int64_t start, const char *tag, size_t tag_len, m3log_level_t level,
+                                            uint64_t count, void *user_data);
+
+/**
+ * 创建聚合器
+ * @param options 选项，可为 NULL
+ * @param agg 成功时返回聚合器
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_INVALID_ARGUMENT 或 M3LOG_ERROR_MEMORY_ALLOCATION
+ */
+m3log_error_t m3log_agg_create(const m3log_agg_options_t *options, m3log_agg_t **agg);
+
+/**
+ * 销毁聚合器（不会关闭未关闭的桶，需要时先调用 m3log_agg_flush）
+ * @param agg 聚合器，可为 NULL
+ */
+void m3log_agg_destroy(m3log_agg_t *agg);
+
+/**
+ * 计入一条解析结果
+ * @param agg 聚合器
+ * @param view 解析结果，调用返回后即可复用
+ * @return M3LOG_SUCCESS 或 M3LOG_ERROR_MEMORY_ALLOCATION（新标签无法加入时，该行只计入总数）
+ */
+m3log_error_t m3log_agg_add(m3log_agg_t *agg, const m3log_view_t *view);
+
+/**
+ * 解析并计入一行
+ * @param agg 聚合器
+ * @param line 日志行（不含换行）
+ * @param len 日志行长度
+ * @return 同 m3log_agg_add；格式无效的行计入统计并返回 M3LOG_SUCCESS
+ */
+m3log_error_t m3log_agg_add_line(m3log_agg_t *agg, const char *line, size_t len);
+
+/**
+ * 按行解析并计入一段文本，最后一行可以没有换行；不处理续行（需要时使用 m3log_stream 配合
+ * m3log_agg_stream_callback）
+ * @param agg 聚合器
+ * @param data 日志文本
+ * @param len 文本长度
+ * @return 同 m3log_agg_add_line
+ */
+m3log_error_t m3log_agg_add_buffer(m3log_agg_t *agg, const char *data, size_t len);
+
+/**
+ * 可直接传给 m3log_stream_create 的回调，user_data 为聚合器
+ * @return 0，内存不足时返回非 0 停止解析
+ */
+int m3log_agg_stream_callback(const m3log_view_t *view, const char *line, size_t len, uint64_t offset,
+                              void *user_data);
+
+/**
+ * 可直接传给 m3log_bulk_parse_file / m3log_bulk_parse_buffer 的回调：user_data 为聚合器数组，
+ * 第 i 个工作线程的批次计入第 i 个聚合器，数组长度不小于工作线程数；之后用 m3log_agg_merge_parallel 合并
+ * @return 0，内存不足时返回非 0 停止解析
+ */
+int m3log_agg_bulk_callback(const m3log_bulk_batch_t *batch, void *user_data);
+
+/**
+ * 关闭所有尚未关闭的桶（按时间顺序调用 on_close），用于输入结束时输出最后的结果
+ * @param agg 聚合器
+ */
+void m3log_agg_flush(m3log_agg_t *agg);
+
+/**
+ * 把 src 的计数合并到 dst（src 不变）；按时间顺序合并各桶，dst 中已关闭的桶不再接收数据。
+ * 两者的桶宽度必须相同
+ * @param dst 目标聚合器
+ * @param src 源聚合器
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_INVALID_ARGUMENT 或 M3LOG_ERROR_MEMORY_ALLOCATION
+ */
+m3log_error_t m3log_agg_merge(m3log_agg_t *dst, const m3log_agg_t *src);
+
+/**
+ * 以二叉树方式并行合并多个聚合器到 aggs[0]：每一轮两两合并，轮数为 log2(count)。
+ * 用于合并各线程的部分聚合时，部分聚合器应不设置 on_close，并把 lateness 设为 buckets - 1，
+ * 使各线程交错的时间范围不会被当作迟到数据丢弃
+ * @param aggs 聚合器数组，合并后除 aggs[0] 外的内容不确定
+ * @param count 数组长度
+ * @return 同 m3log_agg_merge
+ */
+m3log_error_t m3log_agg_merge_parallel(m3log_agg_t *const *aggs, size_t count);
+
+/**
+ * 用多个线程聚合整个文件：每个工作线程计入自己的部分聚合器，最后并行合并到 agg。
+ * 只有最后 buckets 个桶被保留，需要完整的历史时把 buckets 设为覆盖文件的时间跨度
+ * @param agg 聚合器
+ * @param path 日志文件路径
+ * @param options 批量解析选项，可为 NULL（preserve_order 被忽略）
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_IO 或 M3LOG_ERROR_MEMORY_ALLOCATION
+ */
+m3log_error_t m3log_agg_file(m3log_agg_t *agg, const char *path, const m3log_bulk_options_t *options);
+
+/**
+ * 统计起始时间落在 [from, to) 内的桶中的行数
+ * @param agg 聚合器
+ * @param tag 标签（以 '\0' 结尾），NULL 表示所有行
+ * @param level_mask M3LOG_LEVEL_BIT 的组合，0 表示任意级别
+ * @param from 起始时间（纳秒）
+ * @param to 结束时间（纳秒）
+ * @return 行数
+ */
+uint64_t m3log_agg_count(const m3log_agg_t *agg, const char *tag, unsigned level_mask, int64_t from, int64_t to);
+
+/**
+ * 滑动窗口速率：以最新的桶的结束时间为终点、长度为 window 的窗口内每秒的行数（窗口按桶宽度向上取整）
+ * @param agg 聚合器
+ * @param tag 标签，NULL 表示所有行
+ * @param level_mask M3LOG_LEVEL_BIT 的组合，0 表示任意级别
+ * @param window 窗口长度（纳秒），不超过 buckets × width
+ * @return 每秒行数，没有数据时为 0
+ */
+double m3log_agg_rate(const m3log_agg_t *agg, const char *tag, unsigned level_mask, int64_t window);
+
+/**
+ * 最新的桶的结束时间（纳秒），还没有数据时返回 INT64_MIN
+ * @param agg 聚合器
+ * @return 结束时间
+ */
+int64_t m3log_agg_latest(const m3log_agg_t *agg);
+
+/**
+ * 按时间顺序遍历起始时间落在 [from, to) 内的桶中所有非零的计数：每个桶先给出各级别的总数（tag 为 NULL），
+ * 再给出各标签的计数
+ * @param agg 聚合器
+ * @param from 起始时间（纳秒）
+ * @param to 结束时间（纳秒）
+ * @param callback 遍历回调
+ * @param user_data 传递给回调的数据
+ * @return M3LOG_SUCCESS，回调要求停止时返回 M3LOG_ERROR_ABORTED
+ */
+m3log_error_t m3log_agg_foreach(const m3log_agg_t *agg, int64_t from, int64_t to,
+                                m3log_agg_foreach_callback_t callback, void *user_data);
+
+/**
+ * 读取统计
+ * @param agg 聚合器
+ * @param stats 统计结果
+ */
+void m3log_agg_stats(const m3log_agg_t *agg, m3log_agg_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* M3LOG_AGG_H */
@@ -0,0 +1,96 @@
+/**
+ * @file m3log_bulk.h
+ * @brief m3log 大文件批量解析接口
+ * @version 0.1.0
+ *
+ * 将文件 mmap 到内存，按换行对齐切分为若干块，由工作线程并行调用
+ * m3log_parse_view 解析，并以批次（每块一个批次）回调给调用方。
+ * 仅支持 POSIX 平台（mmap 与 pthread）。
+ */
+
+#ifndef M3LOG_BULK_H
+#define M3LOG_BULK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "m3log.h"
+
+/**
+ * 默认块大小（字节）
+ */
+#define M3LOG_BULK_DEFAULT_CHUNK (4u << 20)
+
+/**
+ * 批量解析选项，全部置零即使用默认值
+ */
+typedef struct {
+    size_t threads;     /* 工作线程数，0 表示在线 CPU 数 */
+    size_t chunk_size;  /* 块大小，0 表示 M3LOG_BULK_DEFAULT_CHUNK */
+    int preserve_order; /* 非 0 时按文件顺序串行回调，否则各线程并发回调 */
+} m3log_bulk_options_t;
+
+/**
+ * 一个块的解析结果，仅在回调期间有效
+ */
+typedef struct {
+    const m3log_view_t *views; /* 解析成功的日志行，切片指向映射的文件内容 */
+    const size_t *offsets;     /* 每条日志行在输入中的起始偏移 */
+    size_t count;              /* 日志行数量 */
+    size_t invalid;            /* 本块中格式无效而被跳过的行数 */
+    size_t chunk_index;        /* 块序号，从 0 开始 */
+    size_t worker;             /* 解析本块的工作线程序号（0 ~ threads-1），可用于选择线程私有的状态 */
+} m3log_bulk_batch_t;
+
+/**
+ * 批次回调
+ * @param batch 批次
+ * @param user_data 调用方数据
+ * @return 0 继续，非 0 停止解析
+ */
+typedef int (*m3log_bulk_callback_t)(const m3log_bulk_batch_t *batch, void *user_data);
+
+/**
+ * 批量解析统计
+ */
+typedef struct {
+    size_t bytes;   /* 输入字节数 */
+    size_t chunks;  /* 块数量 */
+    size_t entries; /* 解析成功的行数 */
+    size_t invalid; /* 格式无效的行数 */
+    size_t threads; /* 实际使用的线程数 */
+} m3log_bulk_stats_t;
+
+/**
+ * 批量解析内存中的日志文本
+ * @param data 日志文本，行以 '\n' 分隔（可带 '\r'），空行被忽略
+ * @param len 文本长度
+ * @param options 解析选项，可为 NULL
+ * @param callback 批次回调；未设置 preserve_order 时可能被多个线程同时调用
+ * @param user_data 传递给回调的数据
+ * @param stats 统计结果，可为 NULL
+ * @return M3LOG_SUCCESS、回调要求停止时返回 M3LOG_ERROR_ABORTED，或其他错误码
+ */
+m3log_error_t m3log_bulk_parse_buffer(const char *data, size_t len, const m3log_bulk_options_t *options,
+                                      m3log_bulk_callback_t callback, void *user_data,
+                                      m3log_bulk_stats_t *stats);
+
+/**
+ * 将文件映射到内存并批量解析
+ * @param path 文件路径
+ * @param options 解析选项，可为 NULL
+ * @param callback 批次回调
+ * @param user_data 传递给回调的数据
+ * @param stats 统计结果，可为 NULL
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_IO（无法打开或映射文件），或同 m3log_bulk_parse_buffer
+ */
+m3log_error_t m3log_bulk_parse_file(const char *path, const m3log_bulk_options_t *options,
+                                    m3log_bulk_callback_t callback, void *user_data,
+                                    m3log_bulk_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* M3LOG_BULK_H */
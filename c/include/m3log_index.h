@@ -0,0 +1,151 @@
+/**
+ * @file m3log_index.h
+ * @brief m3log 日志文件的旁路索引
+ * @version 0.1.0
+ *
+ * 索引文件（默认为日志路径加 ".m3ix"）把日志按每 N 行划分为块，为每块记录
+ * 字节范围、时间范围、出现过的级别与标签布隆过滤器。查询时先用索引排除不可能
+ * 命中的块，只解析候选块中的行；索引之后追加的日志（尚未成块的尾部）总是完整扫描，
+ * 因此索引落后于日志时结果仍然完整。
+ * 索引可以由 m3log_index_build 离线增量生成，也可以在写日志时由 m3log_index_builder_t 同步生成。
+ * 仅支持 POSIX 平台（mmap）。
+ */
+
+#ifndef M3LOG_INDEX_H
+#define M3LOG_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "m3log.h"
+
+/**
+ * 默认每块行数
+ */
+#define M3LOG_INDEX_DEFAULT_BLOCK_LINES 1024
+
+/**
+ * 默认每块布隆过滤器的字节数
+ */
+#define M3LOG_INDEX_DEFAULT_BLOOM_BYTES 256
+
+/**
+ * 级别在 m3log_index_query_t::level_mask 中对应的位
+ */
+#define M3LOG_LEVEL_BIT(level) (1u << (level))
+
+/**
+ * 索引选项，全部置零即使用默认值；仅在新建索引时生效，已有索引沿用其自身的参数
+ */
+typedef struct {
+    size_t block_lines; /* 每块行数，0 表示 M3LOG_INDEX_DEFAULT_BLOCK_LINES */
+    size_t bloom_bytes; /* 每块布隆过滤器字节数，0 表示 M3LOG_INDEX_DEFAULT_BLOOM_BYTES */
+} m3log_index_options_t;
+
+/**
+ * 查询条件，全部置零表示不过滤
+ */
+typedef struct {
+    unsigned level_mask;     /* M3LOG_LEVEL_BIT 的组合，0 表示任意级别 */
+    const char *const *tags; /* 必须全部出现的标签 */
+    size_t tag_count;        /* 标签数量 */
+    int has_time_range;      /* 非 0 时只匹配时间戳在 [min_time, max_time] 内的行，没有时间戳的行不匹配 */
+    int64_t min_time;        /* 自 Unix 纪元以来的纳秒数，见 m3log_index_parse_time */
+    int64_t max_time;
+} m3log_index_query_t;
+
+/**
+ * 查询统计
+ */
+typedef struct {
+    uint64_t bytes;         /* 日志文件字节数 */
+    uint64_t bytes_scanned; /* 实际读取并解析的字节数 */
+    size_t blocks;          /* 索引中有效的块数 */
+    size_t candidates;      /* 未被索引排除的块数 */
+    size_t lines_parsed;    /* 解析的行数 */
+    size_t matches;         /* 匹配的行数 */
+} m3log_index_stats_t;
+
+/**
+ * 匹配行回调
+ * @param view 解析结果，切片指向映射的日志内容，仅在回调期间有效
+ * @param line 原始日志行（不含换行）
+ * @param len 日志行长度
+ * @param offset 该行在日志文件中的偏移
+ * @param user_data 调用方数据
+ * @return 0 继续，非 0 停止查询
+ */
+typedef int (*m3log_index_callback_t)(const m3log_view_t *view, const char *line, size_t len, uint64_t offset,
+                                      void *user_data);
+
+/**
+ * 增量索引生成器
+ */
+typedef struct m3log_index_builder m3log_index_builder_t;
+
+/**
+ * 解析 ISO 8601 时间戳："YYYY-MM-DDTHH:MM:SS"，可带 1~9 位小数与 "Z" 或 "±HH:MM" 时区，没有时区时按 UTC
+ * @param text 时间戳文本（无需以 '\0' 结尾）
+ * @param len 文本长度
+ * @param nanos 自 Unix 纪元以来的纳秒数
+ * @return M3LOG_SUCCESS 或 M3LOG_ERROR_INVALID_FORMAT
+ */
+m3log_error_t m3log_index_parse_time(const char *text, size_t len, int64_t *nanos);
+
+/**
+ * 打开（不存在时创建）日志的索引，先为日志中尚未索引的部分补齐索引，之后由调用方逐行追加。
+ * 日志比索引覆盖的范围短（被截断或替换）时重建索引
+ * @param log_path 日志文件路径
+ * @param index_path 索引文件路径，NULL 表示 log_path 加 ".m3ix"
+ * @param options 选项，可为 NULL
+ * @param builder 成功时返回生成器
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_IO 或 M3LOG_ERROR_MEMORY_ALLOCATION
+ */
+m3log_error_t m3log_index_builder_open(const char *log_path, const char *index_path,
+                                       const m3log_index_options_t *options, m3log_index_builder_t **builder);
+
+/**
+ * 记录一行刚追加到日志末尾的日志；块写满时追加到索引文件
+ * @param builder 生成器
+ * @param line 日志行（不含结尾换行，日志中该行之后必须紧跟一个 '\n'）
+ * @param len 日志行长度
+ */
+void m3log_index_builder_add(m3log_index_builder_t *builder, const char *line, size_t len);
+
+/**
+ * 写出未满的最后一块并关闭生成器；下次打开时该块会被重新生成
+ * @param builder 生成器，可为 NULL
+ * @return M3LOG_SUCCESS，或期间任意一次写入索引失败时返回 M3LOG_ERROR_IO
+ */
+m3log_error_t m3log_index_builder_close(m3log_index_builder_t *builder);
+
+/**
+ * 离线为日志文件生成或增量更新索引
+ * @param log_path 日志文件路径
+ * @param index_path 索引文件路径，NULL 表示 log_path 加 ".m3ix"
+ * @param options 选项，可为 NULL
+ * @return M3LOG_SUCCESS 或错误码
+ */
+m3log_error_t m3log_index_build(const char *log_path, const char *index_path, const m3log_index_options_t *options);
+
+/**
+ * 借助索引查询日志文件，按文件顺序回调匹配的行；索引不存在或无效时退化为完整扫描
+ * @param log_path 日志文件路径
+ * @param index_path 索引文件路径，NULL 表示 log_path 加 ".m3ix"
+ * @param query 查询条件，可为 NULL
+ * @param callback 匹配行回调
+ * @param user_data 传递给回调的数据
+ * @param stats 统计结果，可为 NULL
+ * @return M3LOG_SUCCESS、回调要求停止时返回 M3LOG_ERROR_ABORTED，或其他错误码
+ */
+m3log_error_t m3log_index_query(const char *log_path, const char *index_path, const m3log_index_query_t *query,
+                                m3log_index_callback_t callback, void *user_data, m3log_index_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* M3LOG_INDEX_H */
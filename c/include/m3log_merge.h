@@ -0,0 +1,89 @@
+/**
+ * @file m3log_merge.h
+ * @brief m3log 多路归并：把各自按时间有序的多个日志（例如按线程分片的文件）合并为一个全局有序的流
+ * @version 0.1.0
+ *
+ * 每个输入只保留一个固定大小的读缓冲区，当前行的时间戳放在最小堆中，按 (时间, 输入序号) 逐行输出，
+ * 内存只与输入数和缓冲区大小有关，与文件大小无关。时间相同的行按输入序号排列，同一输入内保持原有顺序，
+ * 因此结果是稳定的；输入本身不是有序时仍按各输入的原有顺序归并，并计入统计。
+ *
+ * 以 '\' 结尾的行与下一行属于同一条日志（续行），作为一个整体输出；输出的字节与输入完全相同。
+ * 没有时间戳或时间戳无法解析的行沿用同一输入上一行的时间，紧随其后输出。
+ * 仅支持 POSIX 平台（read(2) 与 m3log_index 的时间解析）。
+ */
+
+#ifndef M3LOG_MERGE_H
+#define M3LOG_MERGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "m3log.h"
+
+/**
+ * 默认的单个输入读缓冲区大小（字节），同时是一条日志（含续行）的最大长度
+ */
+#define M3LOG_MERGE_DEFAULT_BUFFER (64u << 10)
+
+/**
+ * 归并选项，全部置零即使用默认值
+ */
+typedef struct {
+    size_t buffer_size; /* 每个输入的读缓冲区大小，0 表示 M3LOG_MERGE_DEFAULT_BUFFER；更长的日志被丢弃 */
+} m3log_merge_options_t;
+
+/**
+ * 输出回调
+ * @param line 一条日志（含续行，不含结尾换行），仅在回调期间有效
+ * @param len 日志长度
+ * @param input 来源输入的序号
+ * @param user_data 调用方数据
+ * @return 0 继续，非 0 停止归并
+ */
+typedef int (*m3log_merge_callback_t)(const char *line, size_t len, size_t input, void *user_data);
+
+/**
+ * 归并统计
+ */
+typedef struct {
+    uint64_t lines;      /* 输出的日志条数 */
+    uint64_t bytes;      /* 读取的字节数 */
+    uint64_t untimed;    /* 没有可解析时间戳、沿用上一行时间的条数 */
+    uint64_t disordered; /* 时间早于同一输入上一条的条数（该输入本身无序） */
+    uint64_t oversize;   /* 超过缓冲区大小而被丢弃的条数 */
+} m3log_merge_stats_t;
+
+/**
+ * 归并多个已打开的描述符（只读取，不关闭）
+ * @param fds 描述符数组，数组下标即输入序号
+ * @param count 描述符数量
+ * @param options 选项，可为 NULL
+ * @param callback 输出回调，按全局时间顺序调用
+ * @param user_data 传递给回调的数据
+ * @param stats 可为 NULL，返回统计
+ * @return M3LOG_SUCCESS、回调要求停止时返回 M3LOG_ERROR_ABORTED、M3LOG_ERROR_IO 或 M3LOG_ERROR_MEMORY_ALLOCATION
+ */
+m3log_error_t m3log_merge_fds(const int *fds, size_t count, const m3log_merge_options_t *options,
+                              m3log_merge_callback_t callback, void *user_data, m3log_merge_stats_t *stats);
+
+/**
+ * 归并多个日志文件
+ * @param paths 文件路径数组，数组下标即输入序号
+ * @param count 文件数量
+ * @param options 选项，可为 NULL
+ * @param callback 输出回调，按全局时间顺序调用
+ * @param user_data 传递给回调的数据
+ * @param stats 可为 NULL，返回统计
+ * @return 同 m3log_merge_fds；任一文件无法打开时返回 M3LOG_ERROR_IO
+ */
+m3log_error_t m3log_merge_files(const char *const *paths, size_t count, const m3log_merge_options_t *options,
+                                m3log_merge_callback_t callback, void *user_data, m3log_merge_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* M3LOG_MERGE_H */
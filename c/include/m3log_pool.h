@@ -0,0 +1,109 @@
+/**
+ * @file m3log_pool.h
+ * @brief m3log 日志条目对象池
+ * @version 0.1.0
+ *
+ * 从池中取得的 m3log_entry_t 与其全部字符串（时间戳、标签数组与各标签、内容）
+ * 位于同一块连续内存中，归还后按尺寸等级留在池内复用，不交还系统分配器。
+ * 每个线程持有自己的空闲缓存，取用与归还在常见情况下不加锁；
+ * 线程缓存超出上限时成批移交给池的共享空闲链表，线程退出时全部移交。
+ * 仅支持 POSIX 平台（pthread）。
+ */
+
+#ifndef M3LOG_POOL_H
+#define M3LOG_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "m3log.h"
+
+/**
+ * 每个线程在每个尺寸等级上默认缓存的空闲条目数
+ */
+#define M3LOG_POOL_DEFAULT_THREAD_CACHE 64
+
+/**
+ * 池化的单个条目（含字符串）超过该字节数时单独分配，归还时直接释放
+ */
+#define M3LOG_POOL_MAX_POOLED (64u << 10)
+
+/**
+ * 对象池，由 m3log_pool_create 创建
+ */
+typedef struct m3log_pool m3log_pool_t;
+
+/**
+ * 对象池选项，全部置零即使用默认值
+ */
+typedef struct {
+    size_t thread_cache; /* 每个线程每个尺寸等级缓存的空闲条目数，0 表示 M3LOG_POOL_DEFAULT_THREAD_CACHE */
+} m3log_pool_options_t;
+
+/**
+ * 对象池统计
+ */
+typedef struct {
+    size_t reserved_bytes; /* 为池化条目向系统申请的总字节数（只增不减） */
+    size_t chunks;         /* 向系统申请的内存块数 */
+    size_t shared_free;    /* 共享空闲链表中的条目数（不含各线程缓存） */
+    size_t oversize;       /* 超过 M3LOG_POOL_MAX_POOLED 而单独分配的次数 */
+} m3log_pool_stats_t;
+
+/**
+ * 创建对象池
+ * @param options 选项，可为 NULL
+ * @return 对象池，内存不足时返回 NULL
+ */
+m3log_pool_t *m3log_pool_create(const m3log_pool_options_t *options);
+
+/**
+ * 销毁对象池并释放其全部内存
+ * 调用前必须归还所有条目，且其他线程不再使用该池
+ * @param pool 对象池，可为 NULL
+ */
+void m3log_pool_destroy(m3log_pool_t *pool);
+
+/**
+ * 解析 m3log 日志行，结果存放在池化条目中（语义同 m3log_parse）
+ * @param pool 对象池
+ * @param line 日志行（无需以 '\0' 结尾）
+ * @param len 日志行长度
+ * @param entry 成功时指向池化条目，使用后需调用 m3log_pool_release 归还
+ * @return M3LOG_SUCCESS 或错误码
+ */
+m3log_error_t m3log_pool_parse(m3log_pool_t *pool, const char *line, size_t len, m3log_entry_t **entry);
+
+/**
+ * 从池中创建新的日志条目（语义同 m3log_create_entry）
+ * @param pool 对象池
+ * @param content 日志内容
+ * @param level 日志级别
+ * @param tags 标签数组，NULL 元素视为空标签
+ * @param tag_count 标签数量
+ * @return 池化条目，使用后需调用 m3log_pool_release 归还；参数无效或内存不足时返回 NULL
+ */
+m3log_entry_t *m3log_pool_create_entry(m3log_pool_t *pool, const char *content, m3log_level_t level,
+                                       const char **tags, size_t tag_count);
+
+/**
+ * 将条目归还对象池，可以在取得它的线程之外的线程调用
+ * 池化条目不能传给 m3log_free_entry，其字段也不能单独释放
+ * @param pool 取得该条目的对象池
+ * @param entry 池化条目，可为 NULL
+ */
+void m3log_pool_release(m3log_pool_t *pool, m3log_entry_t *entry);
+
+/**
+ * 读取对象池统计
+ * @param pool 对象池
+ * @param stats 统计结果
+ */
+void m3log_pool_stats(m3log_pool_t *pool, m3log_pool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* M3LOG_POOL_H */
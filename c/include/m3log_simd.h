@@ -0,0 +1,63 @@
+/**
+ * @file m3log_simd.h
+ * @brief m3log 字节扫描与换行转义内核，C 与 C++ 实现共用
+ * @version 0.1.0
+ *
+ * 提供 SSE2 / AVX2 向量化实现与标量回退，首次调用时通过 CPUID 选择。
+ * 所有函数只读取 [data, data + len) 范围内的字节，不要求输入以 '\0' 结尾。
+ */
+
+#ifndef M3LOG_SIMD_H
+#define M3LOG_SIMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h> /* 用于 size_t */
+
+/**
+ * 查找第一个换行符 '\n'
+ * @param data 输入数据
+ * @param len 输入长度
+ * @return 指向第一个换行符的指针，没有则返回 NULL
+ */
+const char *m3log_find_newline(const char *data, size_t len);
+
+/**
+ * 统计换行符的数量
+ * @param data 输入数据
+ * @param len 输入长度
+ * @return 换行符数量
+ */
+size_t m3log_count_newlines(const char *data, size_t len);
+
+/**
+ * 将换行符转义为两个字符 "\n"
+ * @param src 输入数据
+ * @param len 输入长度
+ * @param dst 输出缓冲区，至少 len + m3log_count_newlines(src, len) 字节
+ * @return 写入 dst 的字节数
+ */
+size_t m3log_escape_newlines(const char *src, size_t len, char *dst);
+
+/**
+ * 将两个字符 "\n" 还原为换行符，其余字节原样复制
+ * @param src 输入数据
+ * @param len 输入长度
+ * @param dst 输出缓冲区，至少 len 字节，可以与 src 相同（原地还原）
+ * @return 写入 dst 的字节数
+ */
+size_t m3log_unescape_newlines(const char *src, size_t len, char *dst);
+
+/**
+ * 当前选用的内核名称
+ * @return "avx2"、"sse2" 或 "scalar"
+ */
+const char *m3log_simd_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* M3LOG_SIMD_H */
@@ -0,0 +1,136 @@
+/**
+ * @file m3log_stream.h
+ * @brief m3log 流式增量解析接口
+ * @version 0.1.0
+ *
+ * 接收任意切分的字节块（管道、套接字的 read() 结果），按行解析并通过回调逐条交付。
+ * 行尾的 '\' 表示该行在下一行继续（v0.1.0 规范的多行处理）：续行被拼接为一条日志，
+ * 断开处以转义形式 "\n" 保留，可用 m3log_unescape_newlines 还原为真正的换行。
+ *
+ * 完整落在输入块内的普通行直接在输入上原地解析，不做复制；只有跨越块边界或带续行的行
+ * 才暂存到解析器内部固定大小的缓冲区。使用 m3log_stream_buffer / m3log_stream_commit
+ * 时 read() 直接写入该缓冲区，跨块的行也无需复制。
+ * 解析器状态在创建后大小固定，超过 max_line 的行被整体丢弃并计入统计。
+ */
+
+#ifndef M3LOG_STREAM_H
+#define M3LOG_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "m3log.h"
+
+/**
+ * 默认的最大行长度（字节，按拼接续行后的逻辑行计算）
+ */
+#define M3LOG_STREAM_DEFAULT_MAX_LINE (64u << 10)
+
+/**
+ * 流式解析选项，全部置零即使用默认值
+ */
+typedef struct {
+    size_t max_line; /* 最大行长度，0 表示 M3LOG_STREAM_DEFAULT_MAX_LINE */
+} m3log_stream_options_t;
+
+/**
+ * 日志行回调
+ * @param view 解析结果，切片指向 line，仅在回调期间有效
+ * @param line 拼接续行后的日志行（不含换行）
+ * @param len 日志行长度
+ * @param offset 该行第一个字节在输入流中的偏移
+ * @param user_data 调用方数据
+ * @return 0 继续，非 0 停止解析
+ */
+typedef int (*m3log_stream_callback_t)(const m3log_view_t *view, const char *line, size_t len, uint64_t offset,
+                                       void *user_data);
+
+/**
+ * 流式解析统计
+ */
+typedef struct {
+    uint64_t bytes;   /* 输入字节数 */
+    size_t entries;   /* 解析成功的行数 */
+    size_t invalid;   /* 格式无效而被跳过的行数 */
+    size_t oversize;  /* 超过 max_line 而被丢弃的行数 */
+    size_t carried;   /* 跨越输入块或带续行、经内部缓冲区交付的行数 */
+    size_t continued; /* 被拼接的续行数 */
+} m3log_stream_stats_t;
+
+/**
+ * 流式解析器
+ */
+typedef struct m3log_stream m3log_stream_t;
+
+/**
+ * 创建流式解析器
+ * @param options 选项，可为 NULL
+ * @param callback 日志行回调
+ * @param user_data 传递给回调的数据
+ * @param stream 成功时返回解析器
+ * @return M3LOG_SUCCESS、M3LOG_ERROR_INVALID_ARGUMENT 或 M3LOG_ERROR_MEMORY_ALLOCATION
+ */
+m3log_error_t m3log_stream_create(const m3log_stream_options_t *options, m3log_stream_callback_t callback,
+                                  void *user_data, m3log_stream_t **stream);
+
+/**
+ * 销毁解析器，未结束的行被丢弃（需要时先调用 m3log_stream_finish）
+ * @param stream 解析器，可为 NULL
+ */
+void m3log_stream_destroy(m3log_stream_t *stream);
+
+/**
+ * 输入一块数据；完整的行立即回调，末尾不完整的行暂存到下次调用
+ * @param stream 解析器
+ * @param data 输入数据，调用返回后即可复用
+ * @param len 输入长度
+ * @return M3LOG_SUCCESS，回调要求停止时返回 M3LOG_ERROR_ABORTED（此后解析器只能 reset 或销毁）
+ */
+m3log_error_t m3log_stream_feed(m3log_stream_t *stream, const char *data, size_t len);
+
+/**
+ * 取得内部缓冲区中可直接写入的空间，配合 m3log_stream_commit 使用：
+ *   n = read(fd, m3log_stream_buffer(stream, &capacity), capacity);
+ *   m3log_stream_commit(stream, n);
+ * @param stream 解析器
+ * @param capacity 返回可写入的字节数，总是大于 0
+ * @return 可写入的位置，在下一次 feed、commit、finish 或 reset 之前有效
+ */
+char *m3log_stream_buffer(m3log_stream_t *stream, size_t *capacity);
+
+/**
+ * 解析刚写入 m3log_stream_buffer 返回空间的 len 个字节
+ * @param stream 解析器
+ * @param len 写入的字节数，不超过 m3log_stream_buffer 返回的容量
+ * @return 同 m3log_stream_feed；len 超出容量时返回 M3LOG_ERROR_INVALID_ARGUMENT
+ */
+m3log_error_t m3log_stream_commit(m3log_stream_t *stream, size_t len);
+
+/**
+ * 输入结束：把暂存的不完整行（没有结尾换行或以续行结尾）作为最后一行交付，之后解析器可继续接收新的流
+ * @param stream 解析器
+ * @return 同 m3log_stream_feed
+ */
+m3log_error_t m3log_stream_finish(m3log_stream_t *stream);
+
+/**
+ * 丢弃暂存的行与停止状态并清零统计，用于开始解析新的流
+ * @param stream 解析器
+ */
+void m3log_stream_reset(m3log_stream_t *stream);
+
+/**
+ * 读取统计
+ * @param stream 解析器
+ * @param stats 统计结果
+ */
+void m3log_stream_stats(const m3log_stream_t *stream, m3log_stream_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* M3LOG_STREAM_H */
@@ -4,6 +4,7 @@
  */
 
 #include "../include/m3log.h"
+#include "../include/m3log_simd.h"
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -12,35 +13,212 @@
 #include <time.h>
 
 #if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#include <windows.h>
 #define strdup _strdup
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
 #endif
 
+#if defined(_MSC_VER)
+#define M3LOG_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define M3LOG_THREAD_LOCAL __thread
+#else
+#define M3LOG_THREAD_LOCAL _Thread_local
+#endif
+
+/* 最低级别在加锁之前读取 */
+#if defined(__GNUC__)
+#define M3LOG_LEVEL_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define M3LOG_LEVEL_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#else
+#define M3LOG_LEVEL_LOAD(p) (*(volatile int *)(p))
+#define M3LOG_LEVEL_STORE(p, v) (*(volatile int *)(p) = (v))
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+typedef SRWLOCK m3log_mutex_t;
+#define M3LOG_MUTEX_INITIALIZER SRWLOCK_INIT
+#define m3log_mutex_lock(m) AcquireSRWLockExclusive(m)
+#define m3log_mutex_unlock(m) ReleaseSRWLockExclusive(m)
+#else
+typedef pthread_mutex_t m3log_mutex_t;
+#define M3LOG_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define m3log_mutex_lock(m) pthread_mutex_lock(m)
+#define m3log_mutex_unlock(m) pthread_mutex_unlock(m)
+#endif
+
+/* 在栈上渲染的消息长度上限，更长的消息使用 sink 的 scratch */
+#define M3LOG_INLINE_MESSAGE 1024
+#define M3LOG_MIN_BUFFER_SIZE 256
+#define M3LOG_DEFAULT_FLUSH_INTERVAL_MS 100
+
+/**
+ * m3log_log 的输出：批量缓冲区与刷新策略，全部字段受 mutex 保护
+ */
+typedef struct {
+    m3log_mutex_t mutex;
+    int fd;
+    m3log_write_callback_t callback;
+    void *user_data;
+    char *buffer;               /* 批量缓冲区，未配置时指向静态的默认缓冲区 */
+    size_t capacity;
+    size_t used;
+    m3log_level_t flush_level;
+    unsigned flush_interval_ms;
+    long long last_flush_ms;
+    char *scratch;              /* 长消息的渲染缓冲区，只增不减，m3log_cleanup 时释放 */
+    size_t scratch_size;
+    char *spill;                /* 比批量缓冲区还长的单行在此渲染，只增不减，m3log_cleanup 时释放 */
+    size_t spill_size;
+    m3log_error_t error;        /* 最近一次刷新失败的错误码，由 m3log_log / m3log_flush 取走 */
+    int exit_hook;              /* 是否已注册 atexit 刷新 */
+} m3log_sink_t;
+
 /* 内部函数声明 */
 static char *m3log_generate_timestamp(void);
-static m3log_tags_t m3log_parse_tags(const char *tags_str);
 static void m3log_free_tags(m3log_tags_t *tags);
-static char *m3log_trim(char *str);
+static void m3log_free_entry_fields(m3log_entry_t *entry);
+static char *m3log_strndup(const char *str, size_t len);
+static m3log_error_t m3log_entry_from_view(const m3log_view_t *view, m3log_entry_t *entry);
+static void m3log_gmtime(const time_t *t, struct tm *out);
+static size_t m3log_format_time(const struct timespec *ts, char *out);
+static long long m3log_now_ms(struct timespec *ts);
+static void m3log_sink_flush_locked(m3log_sink_t *sink, long long now_ms);
+static void m3log_sink_append(m3log_sink_t *sink, const char *data, size_t len);
+static void m3log_sink_append_escaped(m3log_sink_t *sink, const char *data, size_t len);
+static size_t m3log_sink_append_tags(m3log_sink_t *sink, const char *tags);
+static size_t m3log_escaped_length(const char *data, size_t len);
+static void m3log_flush_at_exit(void);
 
 /* 全局初始化标志 */
 static int g_m3log_initialized = 0;
 
+static char g_m3log_default_buffer[M3LOG_DEFAULT_BUFFER_SIZE];
+static int g_m3log_min_level = M3LOG_LEVEL_DEBUG;
+static m3log_sink_t g_m3log_sink = {
+    M3LOG_MUTEX_INITIALIZER, 2, NULL, NULL, g_m3log_default_buffer, M3LOG_DEFAULT_BUFFER_SIZE, 0,
+    M3LOG_LEVEL_ERROR, M3LOG_DEFAULT_FLUSH_INTERVAL_MS, 0, NULL, 0, NULL, 0, M3LOG_SUCCESS, 0,
+};
+
+void m3log_config_default(m3log_config_t *config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(m3log_config_t));
+    config->fd = 2;
+    config->min_level = M3LOG_LEVEL_DEBUG;
+    config->buffer_size = M3LOG_DEFAULT_BUFFER_SIZE;
+    config->flush_level = M3LOG_LEVEL_ERROR;
+    config->flush_interval_ms = M3LOG_DEFAULT_FLUSH_INTERVAL_MS;
+}
+
 m3log_error_t m3log_init(void) {
     if (g_m3log_initialized) {
         return M3LOG_SUCCESS;
     }
+    return m3log_init_with(NULL);
+}
 
-    /* 可以在这里进行任何全局初始化 */
+m3log_error_t m3log_init_with(const m3log_config_t *config) {
+    m3log_config_t defaults;
+    if (!config) {
+        m3log_config_default(&defaults);
+        config = &defaults;
+    }
+    if (!config->callback && config->fd < 0) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* 新缓冲区在锁外分配，默认大小直接使用静态缓冲区 */
+    size_t capacity = config->buffer_size < M3LOG_MIN_BUFFER_SIZE ? M3LOG_MIN_BUFFER_SIZE : config->buffer_size;
+    char *buffer = g_m3log_default_buffer;
+    if (capacity != M3LOG_DEFAULT_BUFFER_SIZE) {
+        buffer = (char *)malloc(capacity);
+        if (!buffer) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    m3log_sink_t *sink = &g_m3log_sink;
+    struct timespec now;
+    long long now_ms = m3log_now_ms(&now);
+
+    m3log_mutex_lock(&sink->mutex);
+    m3log_sink_flush_locked(sink, now_ms);
+    char *old_buffer = sink->buffer;
+    sink->fd = config->fd;
+    sink->callback = config->callback;
+    sink->user_data = config->user_data;
+    sink->buffer = buffer;
+    sink->capacity = capacity;
+    sink->flush_level = config->flush_level;
+    sink->flush_interval_ms = config->flush_interval_ms;
+    sink->error = M3LOG_SUCCESS;
+    if (!sink->exit_hook) {
+        sink->exit_hook = atexit(m3log_flush_at_exit) == 0;
+    }
+    M3LOG_LEVEL_STORE(&g_m3log_min_level, (int)config->min_level);
     g_m3log_initialized = 1;
+    m3log_mutex_unlock(&sink->mutex);
+
+    if (old_buffer != g_m3log_default_buffer) {
+        free(old_buffer);
+    }
     return M3LOG_SUCCESS;
 }
 
 void m3log_cleanup(void) {
-    if (!g_m3log_initialized) {
-        return;
+    m3log_sink_t *sink = &g_m3log_sink;
+    struct timespec now;
+    long long now_ms = m3log_now_ms(&now);
+
+    m3log_mutex_lock(&sink->mutex);
+    m3log_sink_flush_locked(sink, now_ms);
+    char *old_buffer = sink->buffer;
+    char *old_scratch = sink->scratch;
+    char *old_spill = sink->spill;
+    sink->fd = 2;
+    sink->callback = NULL;
+    sink->user_data = NULL;
+    sink->buffer = g_m3log_default_buffer;
+    sink->capacity = M3LOG_DEFAULT_BUFFER_SIZE;
+    sink->flush_level = M3LOG_LEVEL_ERROR;
+    sink->flush_interval_ms = M3LOG_DEFAULT_FLUSH_INTERVAL_MS;
+    sink->scratch = NULL;
+    sink->scratch_size = 0;
+    sink->spill = NULL;
+    sink->spill_size = 0;
+    sink->error = M3LOG_SUCCESS;
+    M3LOG_LEVEL_STORE(&g_m3log_min_level, (int)M3LOG_LEVEL_DEBUG);
+    g_m3log_initialized = 0;
+    m3log_mutex_unlock(&sink->mutex);
+
+    if (old_buffer != g_m3log_default_buffer) {
+        free(old_buffer);
     }
+    free(old_scratch);
+    free(old_spill);
+}
 
-    /* 可以在这里清理全局资源 */
-    g_m3log_initialized = 0;
+m3log_error_t m3log_flush(void) {
+    m3log_sink_t *sink = &g_m3log_sink;
+    struct timespec now;
+    long long now_ms = m3log_now_ms(&now);
+
+    m3log_mutex_lock(&sink->mutex);
+    m3log_sink_flush_locked(sink, now_ms);
+    m3log_error_t err = sink->error;
+    sink->error = M3LOG_SUCCESS;
+    m3log_mutex_unlock(&sink->mutex);
+    return err;
+}
+
+void m3log_set_min_level(m3log_level_t level) {
+    M3LOG_LEVEL_STORE(&g_m3log_min_level, (int)level);
 }
 
 m3log_error_t m3log_parse(const char *log_string, m3log_entry_t *entry) {
@@ -51,91 +229,32 @@ m3log_error_t m3log_parse(const char *log_string, m3log_entry_t *entry) {
     /* 初始化结果结构体 */
     memset(entry, 0, sizeof(m3log_entry_t));
 
-    char *log_copy = strdup(log_string);
-    if (!log_copy) {
-        return M3LOG_ERROR_MEMORY_ALLOCATION;
-    }
-
-    char *time_part = NULL;
-    char *tags_part = NULL;
-    char *level_part = NULL;
-    char *content_part = NULL;
-
-    /* 提取时间戳部分 (@2023-04-01T15:30:45Z) */
-    if (log_copy[0] == '@') {
-        time_part = log_copy + 1;
-        char *time_end = strchr(time_part, ' ');
-        if (time_end) {
-            *time_end = '\0';
-            entry->time = strdup(time_part);
-            time_part = time_end + 1;
-        } else {
-            free(log_copy);
-            return M3LOG_ERROR_INVALID_FORMAT;
-        }
-    } else {
-        time_part = log_copy;
-        entry->time = NULL; /* 没有时间戳 */
-    }
-
-    /* 提取标签部分 ([标签1 标签2 ...]) */
-    tags_part = strchr(time_part, '[');
-    if (tags_part) {
-        char *tags_end = strchr(tags_part, ']');
-        if (tags_end) {
-            *tags_end = '\0';
-            entry->tags = m3log_parse_tags(tags_part + 1);
-            tags_part = tags_end + 1;
-        } else {
-            free(log_copy);
-            if (entry->time)
-                free(entry->time);
-            return M3LOG_ERROR_INVALID_FORMAT;
-        }
-    } else {
-        /* 没有标签部分 */
-        entry->tags.tags = NULL;
-        entry->tags.count = 0;
-        tags_part = time_part;
-    }
-
-    /* 提取级别部分 (#INFO) */
-    level_part = strchr(tags_part, '#');
-    if (level_part) {
-        char *level_end = strchr(level_part, ':');
-        if (level_end) {
-            *level_end = '\0';
-            char *level_str = m3log_trim(level_part + 1);
-            entry->level = m3log_string_to_level(level_str);
-            content_part = level_end + 1;
-        } else {
-            free(log_copy);
-            if (entry->time)
-                free(entry->time);
-            m3log_free_tags(&entry->tags);
-            return M3LOG_ERROR_INVALID_FORMAT;
-        }
-    } else {
-        /* 没有级别部分 */
-        entry->level = M3LOG_LEVEL_UNKNOWN;
-        content_part = tags_part;
-
-        /* 如果没有级别，则检查冒号直接分隔内容 */
-        char *content_sep = strchr(content_part, ':');
-        if (content_sep) {
-            content_part = content_sep + 1;
+    /* 先零拷贝解析，再只为结果字段分配内存；标签过多时借用栈上的临时 arena，放不下再改用堆上成倍增长的 arena */
+    m3log_slice_t overflow[64];
+    m3log_arena_t arena;
+    m3log_arena_init(&arena, overflow, sizeof(overflow));
+    char *heap = NULL;
+
+    m3log_view_t view;
+    size_t len = strlen(log_string);
+    m3log_error_t err = m3log_parse_view(log_string, len, &view, &arena);
+    while (err == M3LOG_ERROR_BUFFER_TOO_SMALL) {
+        /* 标签数量不超过行长，arena 只会增长到有限大小 */
+        size_t capacity = arena.capacity * 2;
+        char *base = (char *)realloc(heap, capacity);
+        if (!base) {
+            free(heap);
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
         }
+        heap = base;
+        m3log_arena_init(&arena, heap, capacity);
+        err = m3log_parse_view(log_string, len, &view, &arena);
     }
-
-    /* 提取内容部分 */
-    if (content_part) {
-        entry->content = strdup(m3log_trim(content_part));
-    } else {
-        entry->content = strdup("");
+    if (err == M3LOG_SUCCESS) {
+        err = m3log_entry_from_view(&view, entry);
     }
-
-    free(log_copy);
-    return M3LOG_SUCCESS;
+    free(heap);
+    return err;
 }
 
 int m3log_format(const m3log_entry_t *entry, char *buffer, size_t buffer_size) {
@@ -309,151 +428,254 @@ m3log_error_t m3log_log(m3log_level_t level, const char *tags, const char *forma
     if (!format) {
         return M3LOG_ERROR_INVALID_ARGUMENT;
     }
+    if ((int)level < M3LOG_LEVEL_LOAD(&g_m3log_min_level)) {
+        return M3LOG_SUCCESS;
+    }
+
+    struct timespec now;
+    long long now_ms = m3log_now_ms(&now);
+    char time_text[48];
+    size_t time_len = m3log_format_time(&now, time_text);
 
-    /* 处理可变参数，格式化消息 */
+    /* 先在锁外把消息渲染到栈上，多数消息到此为止 */
+    char content[M3LOG_INLINE_MESSAGE];
     va_list args;
     va_start(args, format);
-
-    char content[4096] = {0}; /* 足够大的缓冲区 */
-    vsnprintf(content, sizeof(content), format, args);
-
+    int length = vsnprintf(content, sizeof(content), format, args);
     va_end(args);
-
-    /* 解析标签 */
-    char **tag_array = NULL;
-    size_t tag_count = 0;
-
-    if (tags && *tags) {
-        /* 计算标签数量 */
-        const char *p = tags;
-        tag_count = 1; /* 至少有一个标签 */
-
-        while (*p) {
-            if (*p == ',') {
-                tag_count++;
+    if (length < 0) {
+        return M3LOG_ERROR_INVALID_FORMAT;
+    }
+
+    m3log_sink_t *sink = &g_m3log_sink;
+    const char *message = content;
+    m3log_mutex_lock(&sink->mutex);
+
+    /* 放不下的消息在锁内按完整长度重新渲染到 scratch */
+    if ((size_t)length >= sizeof(content)) {
+        size_t needed = (size_t)length + 1;
+        if (sink->scratch_size < needed) {
+            char *scratch = (char *)realloc(sink->scratch, needed);
+            if (!scratch) {
+                m3log_mutex_unlock(&sink->mutex);
+                return M3LOG_ERROR_MEMORY_ALLOCATION;
             }
-            p++;
-        }
-
-        /* 分配标签数组 */
-        tag_array = (char **)malloc(sizeof(char *) * tag_count);
-        if (!tag_array) {
-            return M3LOG_ERROR_MEMORY_ALLOCATION;
+            sink->scratch = scratch;
+            sink->scratch_size = needed;
         }
-
-        /* 解析标签 */
-        char tags_copy[1024] = {0};
-        strncpy(tags_copy, tags, sizeof(tags_copy) - 1);
-
-        char *token = strtok(tags_copy, ",");
-        size_t i = 0;
-
-        while (token && i < tag_count) {
-            tag_array[i++] = m3log_trim(token);
-            token = strtok(NULL, ",");
+        va_start(args, format);
+        vsnprintf(sink->scratch, needed, format, args);
+        va_end(args);
+        message = sink->scratch;
+    }
+
+    if (!sink->exit_hook) {
+        sink->exit_hook = atexit(m3log_flush_at_exit) == 0;
+    }
+
+    /* 先算出整行的长度：缓冲区中只放完整的行，放不下时先刷新 */
+    const char *name = level >= M3LOG_LEVEL_DEBUG && level < M3LOG_LEVEL_UNKNOWN ? m3log_level_to_string(level) : NULL;
+    size_t name_len = name ? strlen(name) : 0;
+    size_t line_len = 1 + time_len + 2 + m3log_sink_append_tags(NULL, tags) + (name ? 3 + name_len + 2 : 4) +
+                      m3log_escaped_length(message, (size_t)length) + 1;
+    if (line_len > sink->capacity - sink->used) {
+        m3log_sink_flush_locked(sink, now_ms);
+    }
+
+    /* 比整个缓冲区还长的行在 spill 中渲染，写完立即作为一个整体交给输出 */
+    char *buffer = sink->buffer;
+    size_t capacity = sink->capacity;
+    if (line_len > capacity) {
+        if (sink->spill_size < line_len) {
+            char *spill = (char *)realloc(sink->spill, line_len);
+            if (!spill) {
+                m3log_mutex_unlock(&sink->mutex);
+                return M3LOG_ERROR_MEMORY_ALLOCATION;
+            }
+            sink->spill = spill;
+            sink->spill_size = line_len;
         }
-
-        tag_count = i; /* 更新实际标签数量 */
-    }
-
-    /* 创建日志条目 */
-    m3log_entry_t *entry = m3log_create_entry(content, level, (const char **)tag_array, tag_count);
-
-    /* 释放标签数组 */
-    free(tag_array);
-
-    if (!entry) {
-        return M3LOG_ERROR_MEMORY_ALLOCATION;
-    }
-
-    /* 格式化日志并输出 */
-    char log_buffer[4096] = {0};
-    int result = m3log_format(entry, log_buffer, sizeof(log_buffer));
-
-    m3log_free_entry(entry);
-
-    if (result < 0) {
-        return (m3log_error_t)(-result);
-    }
-
-    /* 输出日志 (在实际应用中，您可能想要将其写入文件或发送到日志系统) */
-    //   printf("%s\n", log_buffer);
-
-    return log_buffer;
+        sink->buffer = sink->spill;
+        sink->capacity = line_len;
+    }
+
+    /* @时间戳 [标签...] #级别: 消息 */
+    m3log_sink_append(sink, "@", 1);
+    m3log_sink_append(sink, time_text, time_len);
+    m3log_sink_append(sink, " [", 2);
+    m3log_sink_append_tags(sink, tags);
+    if (name) {
+        m3log_sink_append(sink, "] #", 3);
+        m3log_sink_append(sink, name, name_len);
+        m3log_sink_append(sink, ": ", 2);
+    } else {
+        m3log_sink_append(sink, "] : ", 4);
+    }
+    m3log_sink_append_escaped(sink, message, (size_t)length);
+    m3log_sink_append(sink, "\n", 1);
+
+    if (sink->buffer != buffer) {
+        m3log_sink_flush_locked(sink, now_ms);
+        sink->buffer = buffer;
+        sink->capacity = capacity;
+    } else if (level >= sink->flush_level || now_ms - sink->last_flush_ms >= (long long)sink->flush_interval_ms) {
+        m3log_sink_flush_locked(sink, now_ms);
+    }
+    m3log_error_t err = sink->error;
+    sink->error = M3LOG_SUCCESS;
+    m3log_mutex_unlock(&sink->mutex);
+    return err;
 }
 
 /* 内部辅助函数实现 */
 
 static char *m3log_generate_timestamp(void) {
     time_t now;
-    struct tm *tm_info;
+    struct tm tm_info;
     char timestamp[32] = {0};
 
     time(&now);
+    m3log_gmtime(&now, &tm_info);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm_info);
 
+    return strdup(timestamp);
+}
+
+static void m3log_gmtime(const time_t *t, struct tm *out) {
 #ifdef _WIN32
-    struct tm tm_info_local;
-    gmtime_s(&tm_info_local, &now);
-    tm_info = &tm_info_local;
+    gmtime_s(out, t);
 #else
-    tm_info = gmtime(&now);
+    gmtime_r(t, out);
 #endif
-
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", tm_info);
-
-    return strdup(timestamp);
 }
 
-static m3log_tags_t m3log_parse_tags(const char *tags_str) {
-    m3log_tags_t result = {NULL, 0};
-
-    if (!tags_str || !*tags_str) {
-        return result;
+static long long m3log_now_ms(struct timespec *ts) {
+    if (timespec_get(ts, TIME_UTC) == 0) {
+        ts->tv_sec = time(NULL);
+        ts->tv_nsec = 0;
     }
+    return (long long)ts->tv_sec * 1000 + ts->tv_nsec / 1000000;
+}
 
-    /* 计算标签数量 */
-    size_t count = 1;
-    const char *p = tags_str;
+static size_t m3log_format_time(const struct timespec *ts, char *out) {
+    /* 每个线程缓存当前这一秒的 "YYYY-MM-DDTHH:MM:SS"，同一秒内只需补上毫秒 */
+    static M3LOG_THREAD_LOCAL time_t cached_second = (time_t)-1;
+    static M3LOG_THREAD_LOCAL char cached_text[40];
+    static M3LOG_THREAD_LOCAL size_t cached_len = 0;
+
+    if (ts->tv_sec != cached_second || cached_len == 0) {
+        struct tm tm_info;
+        m3log_gmtime(&ts->tv_sec, &tm_info);
+        cached_len = strftime(cached_text, sizeof(cached_text), "%Y-%m-%dT%H:%M:%S", &tm_info);
+        cached_second = ts->tv_sec;
+    }
+
+    int ms = (int)(ts->tv_nsec / 1000000);
+    memcpy(out, cached_text, cached_len);
+    out[cached_len] = '.';
+    out[cached_len + 1] = (char)('0' + ms / 100);
+    out[cached_len + 2] = (char)('0' + ms / 10 % 10);
+    out[cached_len + 3] = (char)('0' + ms % 10);
+    out[cached_len + 4] = 'Z';
+    return cached_len + 5;
+}
 
-    while (*p) {
-        if (isspace((unsigned char)*p)) {
-            count++;
-            /* 跳过连续的空格 */
-            while (*(p + 1) && isspace((unsigned char)*(p + 1))) {
-                p++;
-            }
+static int m3log_write_fd(int fd, const char *data, size_t len) {
+    while (len > 0) {
+#if defined(_WIN32) || defined(_WIN64)
+        int n = _write(fd, data, (unsigned)(len > 0x40000000u ? 0x40000000u : len));
+#else
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
         }
-        p++;
-    }
-
-    /* 分配标签数组 */
-    char **tags = (char **)malloc(sizeof(char *) * count);
-    if (!tags) {
-        return result;
+#endif
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
     }
+    return 0;
+}
 
-    /* 解析标签 */
-    char *tags_copy = strdup(tags_str);
-    if (!tags_copy) {
-        free(tags);
-        return result;
+static void m3log_sink_flush_locked(m3log_sink_t *sink, long long now_ms) {
+    if (sink->used > 0) {
+        if (sink->callback) {
+            sink->callback(sink->buffer, sink->used, sink->user_data);
+        } else if (m3log_write_fd(sink->fd, sink->buffer, sink->used) != 0) {
+            sink->error = M3LOG_ERROR_IO;
+        }
+        /* 写入失败的数据直接丢弃，缓冲区不会因输出故障而停滞 */
+        sink->used = 0;
     }
+    sink->last_flush_ms = now_ms;
+}
 
-    size_t i = 0;
-    char *token = strtok(tags_copy, " \t\n\r\f\v");
+static void m3log_sink_append(m3log_sink_t *sink, const char *data, size_t len) {
+    /* 调用方已按整行长度确认剩余空间 */
+    memcpy(sink->buffer + sink->used, data, len);
+    sink->used += len;
+}
 
-    while (token && i < count) {
-        tags[i++] = strdup(token);
-        token = strtok(NULL, " \t\n\r\f\v");
+static void m3log_sink_append_escaped(m3log_sink_t *sink, const char *data, size_t len) {
+    const char *newline;
+    while ((newline = m3log_find_newline(data, len)) != NULL) {
+        size_t n = (size_t)(newline - data);
+        m3log_sink_append(sink, data, n);
+        m3log_sink_append(sink, "\\n", 2);
+        data += n + 1;
+        len -= n + 1;
     }
+    m3log_sink_append(sink, data, len);
+}
 
-    free(tags_copy);
+static size_t m3log_escaped_length(const char *data, size_t len) {
+    /* 每个换行符转义后多占一个字节 */
+    size_t total = len;
+    const char *newline;
+    while ((newline = m3log_find_newline(data, len)) != NULL) {
+        total++;
+        len -= (size_t)(newline - data) + 1;
+        data = newline + 1;
+    }
+    return total;
+}
 
-    /* 设置结果 */
-    result.tags = tags;
-    result.count = i; /* 实际解析的标签数量 */
+static size_t m3log_sink_append_tags(m3log_sink_t *sink, const char *tags) {
+    /* 逗号分隔，逐个去除首尾空白后以空格连接，跳过空标签；不修改输入。sink 为 NULL 时只计算长度 */
+    size_t total = 0;
+    int first = 1;
+    while (tags && *tags) {
+        const char *end = strchr(tags, ',');
+        const char *next = end ? end + 1 : NULL;
+        if (!end) {
+            end = tags + strlen(tags);
+        }
+        while (tags < end && isspace((unsigned char)*tags)) {
+            tags++;
+        }
+        while (end > tags && isspace((unsigned char)end[-1])) {
+            end--;
+        }
+        if (end > tags) {
+            size_t n = (size_t)(end - tags);
+            if (sink) {
+                if (!first) {
+                    m3log_sink_append(sink, " ", 1);
+                }
+                m3log_sink_append(sink, tags, n);
+            }
+            total += (first ? 0 : 1) + n;
+            first = 0;
+        }
+        tags = next;
+    }
+    return total;
+}
 
-    return result;
+static void m3log_flush_at_exit(void) {
+    m3log_flush();
 }
 
 static void m3log_free_tags(m3log_tags_t *tags) {
@@ -475,38 +697,57 @@ static void m3log_free_tags(m3log_tags_t *tags) {
     tags->count = 0;
 }
 
-static char *m3log_trim(char *str) {
-    if (!str) {
-        return NULL;
-    }
+static void m3log_free_entry_fields(m3log_entry_t *entry) {
+    free(entry->time);
+    entry->time = NULL;
+    m3log_free_tags(&entry->tags);
+    free(entry->content);
+    entry->content = NULL;
+}
 
-    /* 跳过前导空格 */
-    char *start = str;
-    while (*start && isspace((unsigned char)*start)) {
-        start++;
+static m3log_error_t m3log_entry_from_view(const m3log_view_t *view, m3log_entry_t *entry) {
+    /* 提取时间戳部分 */
+    if (view->time.ptr) {
+        entry->time = m3log_strndup(view->time.ptr, view->time.len);
+        if (!entry->time) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
     }
 
-    /* 如果字符串全是空格 */
-    if (!*start) {
-        *str = '\0';
-        return str;
+    /* 提取标签部分 */
+    if (view->tag_count > 0) {
+        entry->tags.tags = (char **)malloc(sizeof(char *) * view->tag_count);
+        if (!entry->tags.tags) {
+            m3log_free_entry_fields(entry);
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        for (size_t i = 0; i < view->tag_count; i++) {
+            entry->tags.tags[i] = m3log_strndup(view->tags[i].ptr, view->tags[i].len);
+            if (!entry->tags.tags[i]) {
+                m3log_free_entry_fields(entry);
+                return M3LOG_ERROR_MEMORY_ALLOCATION;
+            }
+            entry->tags.count = i + 1;
+        }
     }
 
-    /* 查找字符串末尾 */
-    char *end = start + strlen(start) - 1;
-
-    /* 修剪尾随空格 */
-    while (end > start && isspace((unsigned char)*end)) {
-        end--;
+    /* 提取级别与内容部分 */
+    entry->level = view->level;
+    entry->content = m3log_strndup(view->content.ptr ? view->content.ptr : "", view->content.len);
+    if (!entry->content) {
+        m3log_free_entry_fields(entry);
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
     }
 
-    /* 添加终止符 */
-    *(end + 1) = '\0';
+    return M3LOG_SUCCESS;
+}
 
-    /* 如果原字符串前面有空格，则移动字符串 */
-    if (start != str) {
-        memmove(str, start, (end - start) + 2);
+static char *m3log_strndup(const char *str, size_t len) {
+    char *copy = (char *)malloc(len + 1);
+    if (!copy) {
+        return NULL;
     }
-
-    return str;
-}
\ No newline at end of file
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
@@ -0,0 +1,895 @@
+/**
+ * @file m3log_agg.c
+ * @brief m3log 流式聚合实现
+ */
+
+#include "../include/m3log_agg.h"
+#include "../include/m3log_simd.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define M3LOG_AGG_EMPTY INT64_MIN
+#define M3LOG_AGG_UNTRACKED UINT32_MAX
+#define M3LOG_AGG_INITIAL_TAGS 16
+#define M3LOG_AGG_INITIAL_MAP 64
+#define M3LOG_AGG_INITIAL_ARENA 1024
+/* 缓存的标签组合数上限（相对于 max_tags），超出后新的组合每次逐个查找标签 */
+#define M3LOG_AGG_SETS_PER_TAG 4
+
+/* 散列表条目：键文本存放在表的 text 中 */
+typedef struct {
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t len;
+    uint32_t value;
+    uint32_t used;
+} m3log_agg_entry_t;
+
+/* 开放寻址（线性探测）散列表，键为字节串，值为 32 位整数；只增不删 */
+typedef struct {
+    m3log_agg_entry_t *entries;
+    size_t capacity; /* 2 的幂 */
+    size_t count;
+    char *text;
+    size_t text_len;
+    size_t text_capacity;
+} m3log_agg_map_t;
+
+/*
+ * 桶 b 存放在槽位 b mod buckets。[head - buckets + 1, head] 内每个桶都有槽位（epochs 记录槽位当前的桶），
+ * 其中序号小于 closed 的已关闭。计数器按槽位连续存放：counts[(槽位 × tag_capacity + 标签) × 级别数 + 级别]。
+ */
+struct m3log_agg {
+    int64_t width;
+    size_t buckets;
+    size_t lateness;
+    size_t max_tags;
+    m3log_agg_close_callback_t on_close;
+    void *user_data;
+
+    int64_t *epochs;
+    uint64_t *counts;
+    uint64_t *totals; /* totals[槽位 × 级别数 + 级别] */
+    size_t tag_capacity;
+    int64_t head;
+    int64_t closed;
+
+    m3log_agg_map_t tags;    /* 标签 -> 编号 */
+    uint32_t *tag_offsets;   /* 编号 -> 标签文本在 tags.text 中的位置 */
+    uint32_t *tag_lens;
+    m3log_agg_map_t sets;    /* 原始标签文本 -> set_ids 中的位置 */
+    uint32_t *set_ids;       /* 每组为 [标签数, 编号...]，去重后的编号 */
+    size_t set_len;
+    size_t set_capacity;
+    int last_set_valid;      /* 上一行的标签组合，相邻行相同时免去散列 */
+    uint32_t last_set_offset;
+    uint32_t last_set_len;
+    uint32_t last_set_value;
+
+    /* 时间戳缓存：日期到分钟的前 16 个字符与时区后缀相同时，只需解析秒与小数部分 */
+    int time_cached;
+    char time_prefix[16];
+    char time_zone[8];
+    size_t zone_len;
+    int64_t minute_base;
+
+    /* 上一行所在的桶 */
+    int bucket_cached;
+    int64_t bucket_start;
+    int64_t bucket_index;
+    size_t bucket_slot;
+
+    m3log_arena_t arena;
+    m3log_agg_stats_t stats;
+};
+
+/* 并行合并的一个任务 */
+typedef struct {
+    m3log_agg_t *dst;
+    const m3log_agg_t *src;
+    pthread_t thread;
+    int started;
+    m3log_error_t result;
+} m3log_agg_merge_job_t;
+
+/* 内部函数声明 */
+static uint64_t m3log_agg_hash(const char *data, size_t len);
+static m3log_agg_entry_t *m3log_agg_map_find(const m3log_agg_map_t *map, const char *key, size_t len, uint64_t hash);
+static m3log_error_t m3log_agg_map_insert(m3log_agg_map_t *map, const char *key, size_t len, uint64_t hash,
+                                          uint32_t value, m3log_agg_entry_t **entry);
+static void m3log_agg_map_free(m3log_agg_map_t *map);
+static m3log_error_t m3log_agg_tag_id(m3log_agg_t *agg, const char *tag, size_t len, uint32_t *id);
+static m3log_error_t m3log_agg_grow_tags(m3log_agg_t *agg);
+static m3log_error_t m3log_agg_tag_set(m3log_agg_t *agg, const m3log_view_t *view, const uint32_t **ids);
+static int m3log_agg_time(m3log_agg_t *agg, m3log_slice_t time, int64_t *nanos);
+static int m3log_agg_seconds(const char *text, size_t len, int64_t *offset, size_t *zone);
+static int64_t m3log_agg_floor_div(int64_t a, int64_t b);
+static size_t m3log_agg_slot(const m3log_agg_t *agg, int64_t bucket);
+static void m3log_agg_advance(m3log_agg_t *agg, int64_t bucket);
+static void m3log_agg_close(m3log_agg_t *agg, int64_t until);
+static uint64_t m3log_agg_bucket_lines(const m3log_agg_t *agg, size_t slot);
+static void *m3log_agg_merge_main(void *arg);
+
+m3log_error_t m3log_agg_create(const m3log_agg_options_t *options, m3log_agg_t **agg) {
+    if (!agg) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    *agg = NULL;
+
+    int64_t width = options && options->width ? options->width : M3LOG_AGG_DEFAULT_WIDTH;
+    size_t buckets = options && options->buckets ? options->buckets : M3LOG_AGG_DEFAULT_BUCKETS;
+    size_t max_tags = options && options->max_tags ? options->max_tags : M3LOG_AGG_DEFAULT_MAX_TAGS;
+    if (width <= 0 || max_tags >= M3LOG_AGG_UNTRACKED) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    m3log_agg_t *result = (m3log_agg_t *)calloc(1, sizeof(m3log_agg_t));
+    if (!result) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    result->width = width;
+    result->buckets = buckets;
+    result->lateness = options ? options->lateness : 0;
+    if (result->lateness > buckets - 1) {
+        result->lateness = buckets - 1;
+    }
+    result->max_tags = max_tags;
+    result->on_close = options ? options->on_close : NULL;
+    result->user_data = options ? options->user_data : NULL;
+    result->head = M3LOG_AGG_EMPTY;
+    result->closed = M3LOG_AGG_EMPTY;
+
+    result->epochs = (int64_t *)malloc(buckets * sizeof(int64_t));
+    result->totals = (uint64_t *)calloc(buckets * M3LOG_AGG_LEVELS, sizeof(uint64_t));
+    m3log_arena_init(&result->arena, malloc(M3LOG_AGG_INITIAL_ARENA), M3LOG_AGG_INITIAL_ARENA);
+    if (!result->epochs || !result->totals || !result->arena.base || m3log_agg_grow_tags(result) != M3LOG_SUCCESS) {
+        m3log_agg_destroy(result);
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    for (size_t i = 0; i < buckets; i++) {
+        result->epochs[i] = M3LOG_AGG_EMPTY;
+    }
+
+    *agg = result;
+    return M3LOG_SUCCESS;
+}
+
+void m3log_agg_destroy(m3log_agg_t *agg) {
+    if (!agg) {
+        return;
+    }
+    m3log_agg_map_free(&agg->tags);
+    m3log_agg_map_free(&agg->sets);
+    free(agg->tag_offsets);
+    free(agg->tag_lens);
+    free(agg->set_ids);
+    free(agg->epochs);
+    free(agg->counts);
+    free(agg->totals);
+    free(agg->arena.base);
+    free(agg);
+}
+
+m3log_error_t m3log_agg_add(m3log_agg_t *agg, const m3log_view_t *view) {
+    if ((unsigned)view->level >= M3LOG_AGG_LEVELS) {
+        agg->stats.invalid++;
+        return M3LOG_SUCCESS;
+    }
+
+    int64_t nanos;
+    if (view->time.len == 0 || !m3log_agg_time(agg, view->time, &nanos)) {
+        agg->stats.untimed++;
+        return M3LOG_SUCCESS;
+    }
+
+    /* 大多数行与上一行落在同一个桶中，免去除法 */
+    if (!agg->bucket_cached || nanos < agg->bucket_start || nanos - agg->bucket_start >= agg->width) {
+        int64_t bucket = m3log_agg_floor_div(nanos, agg->width);
+        if (bucket > agg->head) {
+            m3log_agg_advance(agg, bucket);
+        } else if (bucket < agg->closed) {
+            agg->stats.late++;
+            return M3LOG_SUCCESS;
+        }
+        agg->bucket_cached = 1;
+        agg->bucket_index = bucket;
+        agg->bucket_start = bucket * agg->width;
+        agg->bucket_slot = m3log_agg_slot(agg, bucket);
+    }
+    size_t slot = agg->bucket_slot;
+    agg->totals[slot * M3LOG_AGG_LEVELS + view->level]++;
+    agg->stats.entries++;
+
+    if (view->tag_count == 0) {
+        return M3LOG_SUCCESS;
+    }
+    const uint32_t *ids;
+    m3log_error_t err = m3log_agg_tag_set(agg, view, &ids);
+    if (err != M3LOG_SUCCESS) {
+        return err;
+    }
+    uint64_t *counts = agg->counts + slot * agg->tag_capacity * M3LOG_AGG_LEVELS + view->level;
+    for (uint32_t i = 1; i <= ids[0]; i++) {
+        if (ids[i] == M3LOG_AGG_UNTRACKED) {
+            agg->stats.untracked++;
+        } else {
+            counts[(size_t)ids[i] * M3LOG_AGG_LEVELS]++;
+        }
+    }
+    return M3LOG_SUCCESS;
+}
+
+m3log_error_t m3log_agg_add_line(m3log_agg_t *agg, const char *line, size_t len) {
+    m3log_view_t view;
+    m3log_arena_reset(&agg->arena);
+    m3log_error_t err = m3log_parse_view(line, len, &view, &agg->arena);
+    while (err == M3LOG_ERROR_BUFFER_TOO_SMALL) {
+        size_t capacity = agg->arena.capacity * 2;
+        char *base = (char *)realloc(agg->arena.base, capacity);
+        if (!base) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        m3log_arena_init(&agg->arena, base, capacity);
+        err = m3log_parse_view(line, len, &view, &agg->arena);
+    }
+    if (err != M3LOG_SUCCESS) {
+        agg->stats.invalid++;
+        return M3LOG_SUCCESS;
+    }
+    return m3log_agg_add(agg, &view);
+}
+
+m3log_error_t m3log_agg_add_buffer(m3log_agg_t *agg, const char *data, size_t len) {
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end) {
+        const char *newline = m3log_find_newline(p, (size_t)(end - p));
+        const char *line_end = newline ? newline : end;
+        size_t line_len = (size_t)(line_end - p);
+        if (line_len > 0 && p[line_len - 1] == '\r') {
+            line_len--;
+        }
+        if (line_len > 0) {
+            m3log_error_t err = m3log_agg_add_line(agg, p, line_len);
+            if (err != M3LOG_SUCCESS) {
+                return err;
+            }
+        }
+        p = line_end + 1;
+    }
+    return M3LOG_SUCCESS;
+}
+
+int m3log_agg_stream_callback(const m3log_view_t *view, const char *line, size_t len, uint64_t offset,
+                              void *user_data) {
+    (void)line;
+    (void)len;
+    (void)offset;
+    return m3log_agg_add((m3log_agg_t *)user_data, view) != M3LOG_SUCCESS;
+}
+
+int m3log_agg_bulk_callback(const m3log_bulk_batch_t *batch, void *user_data) {
+    m3log_agg_t *agg = ((m3log_agg_t *const *)user_data)[batch->worker];
+    agg->stats.invalid += batch->invalid;
+    for (size_t i = 0; i < batch->count; i++) {
+        if (m3log_agg_add(agg, &batch->views[i]) != M3LOG_SUCCESS) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void m3log_agg_flush(m3log_agg_t *agg) {
+    if (agg->head != M3LOG_AGG_EMPTY) {
+        m3log_agg_close(agg, agg->head + 1);
+    }
+}
+
+m3log_error_t m3log_agg_merge(m3log_agg_t *dst, const m3log_agg_t *src) {
+    if (!dst || !src || dst->width != src->width) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    dst->stats.invalid += src->stats.invalid;
+    dst->stats.untimed += src->stats.untimed;
+    dst->stats.late += src->stats.late;
+    dst->stats.untracked += src->stats.untracked;
+    if (src->head == M3LOG_AGG_EMPTY) {
+        return M3LOG_SUCCESS;
+    }
+
+    /* 源标签编号到目标标签编号的映射 */
+    size_t tag_count = src->tags.count;
+    uint32_t *map = (uint32_t *)malloc((tag_count ? tag_count : 1) * sizeof(uint32_t));
+    if (!map) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    for (size_t id = 0; id < tag_count; id++) {
+        m3log_error_t err = m3log_agg_tag_id(dst, src->tags.text + src->tag_offsets[id], src->tag_lens[id], &map[id]);
+        if (err != M3LOG_SUCCESS) {
+            free(map);
+            return err;
+        }
+    }
+
+    /* 按时间顺序合并，目标聚合器的关闭与 on_close 与逐行计入时一致 */
+    dst->bucket_cached = 0;
+    for (int64_t bucket = src->head - (int64_t)src->buckets + 1; bucket <= src->head; bucket++) {
+        size_t from = m3log_agg_slot(src, bucket);
+        uint64_t lines = m3log_agg_bucket_lines(src, from);
+        if (src->epochs[from] != bucket || lines == 0) {
+            continue;
+        }
+        if (bucket > dst->head) {
+            m3log_agg_advance(dst, bucket);
+        } else if (bucket < dst->closed) {
+            dst->stats.late += lines;
+            continue;
+        }
+
+        size_t to = m3log_agg_slot(dst, bucket);
+        for (size_t level = 0; level < M3LOG_AGG_LEVELS; level++) {
+            dst->totals[to * M3LOG_AGG_LEVELS + level] += src->totals[from * M3LOG_AGG_LEVELS + level];
+        }
+        const uint64_t *source = src->counts + from * src->tag_capacity * M3LOG_AGG_LEVELS;
+        uint64_t *target = dst->counts + to * dst->tag_capacity * M3LOG_AGG_LEVELS;
+        for (size_t id = 0; id < tag_count; id++) {
+            for (size_t level = 0; level < M3LOG_AGG_LEVELS; level++) {
+                uint64_t count = source[id * M3LOG_AGG_LEVELS + level];
+                if (count == 0) {
+                    continue;
+                }
+                if (map[id] == M3LOG_AGG_UNTRACKED) {
+                    dst->stats.untracked += count;
+                } else {
+                    target[(size_t)map[id] * M3LOG_AGG_LEVELS + level] += count;
+                }
+            }
+        }
+        dst->stats.entries += lines;
+    }
+    free(map);
+    return M3LOG_SUCCESS;
+}
+
+m3log_error_t m3log_agg_merge_parallel(m3log_agg_t *const *aggs, size_t count) {
+    if (!aggs && count > 0) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    if (count < 2) {
+        return M3LOG_SUCCESS;
+    }
+
+    m3log_agg_merge_job_t *jobs = (m3log_agg_merge_job_t *)calloc(count / 2 + 1, sizeof(m3log_agg_merge_job_t));
+    if (!jobs) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    m3log_error_t result = M3LOG_SUCCESS;
+    for (size_t step = 1; step < count && result == M3LOG_SUCCESS; step *= 2) {
+        size_t n = 0;
+        for (size_t i = 0; i + step < count; i += 2 * step) {
+            jobs[n].dst = aggs[i];
+            jobs[n].src = aggs[i + step];
+            jobs[n].result = M3LOG_SUCCESS;
+            n++;
+        }
+
+        /* 调用线程执行第一个合并，其余各用一个线程；创建失败的在调用线程补做 */
+        for (size_t j = 1; j < n; j++) {
+            jobs[j].started = pthread_create(&jobs[j].thread, NULL, m3log_agg_merge_main, &jobs[j]) == 0;
+        }
+        m3log_agg_merge_main(&jobs[0]);
+        for (size_t j = 1; j < n; j++) {
+            if (jobs[j].started) {
+                pthread_join(jobs[j].thread, NULL);
+            } else {
+                m3log_agg_merge_main(&jobs[j]);
+            }
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (jobs[j].result != M3LOG_SUCCESS) {
+                result = jobs[j].result;
+            }
+        }
+    }
+    free(jobs);
+    return result;
+}
+
+m3log_error_t m3log_agg_file(m3log_agg_t *agg, const char *path, const m3log_bulk_options_t *options) {
+    if (!agg || !path) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    m3log_bulk_options_t bulk;
+    memset(&bulk, 0, sizeof(bulk));
+    if (options) {
+        bulk = *options;
+    }
+    bulk.preserve_order = 0;
+    if (bulk.threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        bulk.threads = online > 0 ? (size_t)online : 1;
+    }
+
+    /* 各线程领取的块在时间上交错，部分聚合器接收保留范围内的所有数据 */
+    m3log_agg_options_t partial_options;
+    memset(&partial_options, 0, sizeof(partial_options));
+    partial_options.width = agg->width;
+    partial_options.buckets = agg->buckets;
+    partial_options.lateness = agg->buckets - 1;
+    partial_options.max_tags = agg->max_tags;
+
+    m3log_agg_t **partials = (m3log_agg_t **)calloc(bulk.threads, sizeof(m3log_agg_t *));
+    if (!partials) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    m3log_error_t err = M3LOG_SUCCESS;
+    for (size_t i = 0; i < bulk.threads && err == M3LOG_SUCCESS; i++) {
+        err = m3log_agg_create(&partial_options, &partials[i]);
+    }
+    if (err == M3LOG_SUCCESS) {
+        err = m3log_bulk_parse_file(path, &bulk, m3log_agg_bulk_callback, partials, NULL);
+        if (err == M3LOG_ERROR_ABORTED) {
+            err = M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+    if (err == M3LOG_SUCCESS) {
+        err = m3log_agg_merge_parallel(partials, bulk.threads);
+    }
+    if (err == M3LOG_SUCCESS) {
+        err = m3log_agg_merge(agg, partials[0]);
+    }
+    for (size_t i = 0; i < bulk.threads; i++) {
+        m3log_agg_destroy(partials[i]);
+    }
+    free(partials);
+    return err;
+}
+
+uint64_t m3log_agg_count(const m3log_agg_t *agg, const char *tag, unsigned level_mask, int64_t from, int64_t to) {
+    if (agg->head == M3LOG_AGG_EMPTY) {
+        return 0;
+    }
+    uint32_t id = 0;
+    if (tag) {
+        size_t len = strlen(tag);
+        const m3log_agg_entry_t *entry = m3log_agg_map_find(&agg->tags, tag, len, m3log_agg_hash(tag, len));
+        if (!entry) {
+            return 0;
+        }
+        id = entry->value;
+    }
+    if (level_mask == 0) {
+        level_mask = (1u << M3LOG_AGG_LEVELS) - 1;
+    }
+
+    uint64_t total = 0;
+    for (int64_t bucket = agg->head - (int64_t)agg->buckets + 1; bucket <= agg->head; bucket++) {
+        int64_t start = bucket * agg->width;
+        size_t slot = m3log_agg_slot(agg, bucket);
+        if (start < from || start >= to || agg->epochs[slot] != bucket) {
+            continue;
+        }
+        const uint64_t *counts = tag ? agg->counts + (slot * agg->tag_capacity + id) * M3LOG_AGG_LEVELS
+                                     : agg->totals + slot * M3LOG_AGG_LEVELS;
+        for (unsigned level = 0; level < M3LOG_AGG_LEVELS; level++) {
+            if (level_mask & M3LOG_LEVEL_BIT(level)) {
+                total += counts[level];
+            }
+        }
+    }
+    return total;
+}
+
+double m3log_agg_rate(const m3log_agg_t *agg, const char *tag, unsigned level_mask, int64_t window) {
+    if (agg->head == M3LOG_AGG_EMPTY || window <= 0) {
+        return 0.0;
+    }
+    int64_t buckets = (window + agg->width - 1) / agg->width;
+    if (buckets > (int64_t)agg->buckets) {
+        buckets = (int64_t)agg->buckets;
+    }
+    int64_t end = m3log_agg_latest(agg);
+    int64_t span = buckets * agg->width;
+    uint64_t count = m3log_agg_count(agg, tag, level_mask, end - span, end);
+    return (double)count * 1e9 / (double)span;
+}
+
+int64_t m3log_agg_latest(const m3log_agg_t *agg) {
+    return agg->head == M3LOG_AGG_EMPTY ? M3LOG_AGG_EMPTY : (agg->head + 1) * agg->width;
+}
+
+m3log_error_t m3log_agg_foreach(const m3log_agg_t *agg, int64_t from, int64_t to,
+                                m3log_agg_foreach_callback_t callback, void *user_data) {
+    if (!callback) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    if (agg->head == M3LOG_AGG_EMPTY) {
+        return M3LOG_SUCCESS;
+    }
+    for (int64_t bucket = agg->head - (int64_t)agg->buckets + 1; bucket <= agg->head; bucket++) {
+        int64_t start = bucket * agg->width;
+        size_t slot = m3log_agg_slot(agg, bucket);
+        if (start < from || start >= to || agg->epochs[slot] != bucket) {
+            continue;
+        }
+        const uint64_t *totals = agg->totals + slot * M3LOG_AGG_LEVELS;
+        for (size_t level = 0; level < M3LOG_AGG_LEVELS; level++) {
+            if (totals[level] && callback(start, NULL, 0, (m3log_level_t)level, totals[level], user_data) != 0) {
+                return M3LOG_ERROR_ABORTED;
+            }
+        }
+        const uint64_t *counts = agg->counts + slot * agg->tag_capacity * M3LOG_AGG_LEVELS;
+        for (size_t id = 0; id < agg->tags.count; id++) {
+            const char *tag = agg->tags.text + agg->tag_offsets[id];
+            for (size_t level = 0; level < M3LOG_AGG_LEVELS; level++) {
+                uint64_t count = counts[id * M3LOG_AGG_LEVELS + level];
+                if (count && callback(start, tag, agg->tag_lens[id], (m3log_level_t)level, count, user_data) != 0) {
+                    return M3LOG_ERROR_ABORTED;
+                }
+            }
+        }
+    }
+    return M3LOG_SUCCESS;
+}
+
+void m3log_agg_stats(const m3log_agg_t *agg, m3log_agg_stats_t *stats) {
+    *stats = agg->stats;
+    stats->tags = agg->tags.count;
+}
+
+/* 内部辅助函数实现 */
+
+/* 按 8 字节分组的乘法散列，标签通常只有十几个字节 */
+static uint64_t m3log_agg_hash(const char *data, size_t len) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ len;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+        data += 8;
+        len -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data, len);
+    hash = (hash ^ tail) * 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 29);
+}
+
+static m3log_agg_entry_t *m3log_agg_map_find(const m3log_agg_map_t *map, const char *key, size_t len, uint64_t hash) {
+    if (map->capacity == 0) {
+        return NULL;
+    }
+    size_t mask = map->capacity - 1;
+    for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+        m3log_agg_entry_t *entry = &map->entries[i];
+        if (!entry->used) {
+            return NULL;
+        }
+        if (entry->hash == hash && entry->len == len && memcmp(map->text + entry->offset, key, len) == 0) {
+            return entry;
+        }
+    }
+}
+
+static m3log_error_t m3log_agg_map_insert(m3log_agg_map_t *map, const char *key, size_t len, uint64_t hash,
+                                          uint32_t value, m3log_agg_entry_t **entry) {
+    /* 负载不超过 1/2 */
+    if ((map->count + 1) * 2 > map->capacity) {
+        size_t capacity = map->capacity ? map->capacity * 2 : M3LOG_AGG_INITIAL_MAP;
+        m3log_agg_entry_t *entries = (m3log_agg_entry_t *)calloc(capacity, sizeof(m3log_agg_entry_t));
+        if (!entries) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        for (size_t i = 0; i < map->capacity; i++) {
+            if (map->entries[i].used) {
+                size_t j = (size_t)map->entries[i].hash & (capacity - 1);
+                while (entries[j].used) {
+                    j = (j + 1) & (capacity - 1);
+                }
+                entries[j] = map->entries[i];
+            }
+        }
+        free(map->entries);
+        map->entries = entries;
+        map->capacity = capacity;
+    }
+    if (map->text_len + len > map->text_capacity) {
+        size_t capacity = map->text_capacity ? map->text_capacity * 2 : 1024;
+        while (capacity < map->text_len + len) {
+            capacity *= 2;
+        }
+        char *text = (char *)realloc(map->text, capacity);
+        if (!text) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        map->text = text;
+        map->text_capacity = capacity;
+    }
+
+    size_t mask = map->capacity - 1;
+    size_t i = (size_t)hash & mask;
+    while (map->entries[i].used) {
+        i = (i + 1) & mask;
+    }
+    memcpy(map->text + map->text_len, key, len);
+    map->entries[i].hash = hash;
+    map->entries[i].offset = (uint32_t)map->text_len;
+    map->entries[i].len = (uint32_t)len;
+    map->entries[i].value = value;
+    map->entries[i].used = 1;
+    map->text_len += len;
+    map->count++;
+    if (entry) {
+        *entry = &map->entries[i];
+    }
+    return M3LOG_SUCCESS;
+}
+
+static void m3log_agg_map_free(m3log_agg_map_t *map) {
+    free(map->entries);
+    free(map->text);
+}
+
+/* 查找或登记标签；标签数达到 max_tags 时返回 M3LOG_AGG_UNTRACKED */
+static m3log_error_t m3log_agg_tag_id(m3log_agg_t *agg, const char *tag, size_t len, uint32_t *id) {
+    uint64_t hash = m3log_agg_hash(tag, len);
+    const m3log_agg_entry_t *entry = m3log_agg_map_find(&agg->tags, tag, len, hash);
+    if (entry) {
+        *id = entry->value;
+        return M3LOG_SUCCESS;
+    }
+    if (agg->tags.count >= agg->max_tags) {
+        *id = M3LOG_AGG_UNTRACKED;
+        return M3LOG_SUCCESS;
+    }
+    if (agg->tags.count == agg->tag_capacity) {
+        m3log_error_t err = m3log_agg_grow_tags(agg);
+        if (err != M3LOG_SUCCESS) {
+            return err;
+        }
+    }
+
+    uint32_t value = (uint32_t)agg->tags.count;
+    m3log_agg_entry_t *inserted;
+    m3log_error_t err = m3log_agg_map_insert(&agg->tags, tag, len, hash, value, &inserted);
+    if (err != M3LOG_SUCCESS) {
+        return err;
+    }
+    agg->tag_offsets[value] = inserted->offset;
+    agg->tag_lens[value] = inserted->len;
+    *id = value;
+    return M3LOG_SUCCESS;
+}
+
+/* 标签容量翻倍（不超过 max_tags），各槽位的计数器搬到新的位置 */
+static m3log_error_t m3log_agg_grow_tags(m3log_agg_t *agg) {
+    size_t capacity = agg->tag_capacity ? agg->tag_capacity * 2 : M3LOG_AGG_INITIAL_TAGS;
+    if (capacity > agg->max_tags) {
+        capacity = agg->max_tags;
+    }
+
+    uint64_t *counts = (uint64_t *)calloc(agg->buckets * capacity * M3LOG_AGG_LEVELS, sizeof(uint64_t));
+    uint32_t *offsets = (uint32_t *)realloc(agg->tag_offsets, capacity * sizeof(uint32_t));
+    if (offsets) {
+        agg->tag_offsets = offsets;
+    }
+    uint32_t *lens = (uint32_t *)realloc(agg->tag_lens, capacity * sizeof(uint32_t));
+    if (lens) {
+        agg->tag_lens = lens;
+    }
+    if (!counts || !offsets || !lens) {
+        free(counts);
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    if (agg->counts) {
+        size_t row = agg->tag_capacity * M3LOG_AGG_LEVELS;
+        for (size_t slot = 0; slot < agg->buckets; slot++) {
+            memcpy(counts + slot * capacity * M3LOG_AGG_LEVELS, agg->counts + slot * row, row * sizeof(uint64_t));
+        }
+        free(agg->counts);
+    }
+    agg->counts = counts;
+    agg->tag_capacity = capacity;
+    return M3LOG_SUCCESS;
+}
+
+/* 一行的标签组合对应的编号列表 [n, id...]：按原始标签文本缓存，相邻行相同时直接复用 */
+static m3log_error_t m3log_agg_tag_set(m3log_agg_t *agg, const m3log_view_t *view, const uint32_t **ids) {
+    const char *text = view->tags_text.ptr;
+    size_t len = view->tags_text.len;
+    if (agg->last_set_valid && agg->last_set_len == len &&
+        memcmp(agg->sets.text + agg->last_set_offset, text, len) == 0) {
+        *ids = agg->set_ids + agg->last_set_value;
+        return M3LOG_SUCCESS;
+    }
+
+    uint64_t hash = m3log_agg_hash(text, len);
+    const m3log_agg_entry_t *entry = m3log_agg_map_find(&agg->sets, text, len, hash);
+    if (entry) {
+        agg->last_set_valid = 1;
+        agg->last_set_offset = entry->offset;
+        agg->last_set_len = entry->len;
+        agg->last_set_value = entry->value;
+        *ids = agg->set_ids + entry->value;
+        return M3LOG_SUCCESS;
+    }
+
+    /* 新的组合：在 set_ids 末尾生成编号列表，能缓存时才提交 */
+    size_t needed = agg->set_len + view->tag_count + 1;
+    if (needed > agg->set_capacity) {
+        size_t capacity = agg->set_capacity ? agg->set_capacity * 2 : 256;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        uint32_t *set_ids = (uint32_t *)realloc(agg->set_ids, capacity * sizeof(uint32_t));
+        if (!set_ids) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        agg->set_ids = set_ids;
+        agg->set_capacity = capacity;
+    }
+    uint32_t *list = agg->set_ids + agg->set_len;
+    uint32_t count = 0;
+    for (size_t i = 0; i < view->tag_count; i++) {
+        uint32_t id;
+        m3log_error_t err = m3log_agg_tag_id(agg, view->tags[i].ptr, view->tags[i].len, &id);
+        if (err != M3LOG_SUCCESS) {
+            return err;
+        }
+        int seen = 0;
+        for (uint32_t j = 1; j <= count && !seen; j++) {
+            seen = list[j] == id && id != M3LOG_AGG_UNTRACKED;
+        }
+        if (!seen) {
+            list[++count] = id;
+        }
+    }
+    list[0] = count;
+    *ids = list;
+
+    agg->last_set_valid = 0;
+    if (agg->sets.count < agg->max_tags * M3LOG_AGG_SETS_PER_TAG) {
+        m3log_agg_entry_t *inserted;
+        if (m3log_agg_map_insert(&agg->sets, text, len, hash, (uint32_t)agg->set_len, &inserted) == M3LOG_SUCCESS) {
+            agg->last_set_valid = 1;
+            agg->last_set_offset = inserted->offset;
+            agg->last_set_len = inserted->len;
+            agg->last_set_value = inserted->value;
+            agg->set_len += count + 1;
+        }
+    }
+    return M3LOG_SUCCESS;
+}
+
+static int m3log_agg_time(m3log_agg_t *agg, m3log_slice_t time, int64_t *nanos) {
+    const char *text = time.ptr;
+    size_t len = time.len;
+    int64_t offset;
+    size_t zone;
+    if (agg->time_cached && len >= 19 && memcmp(text, agg->time_prefix, 16) == 0 &&
+        m3log_agg_seconds(text, len, &offset, &zone) && len - zone == agg->zone_len &&
+        memcmp(text + zone, agg->time_zone, agg->zone_len) == 0) {
+        *nanos = agg->minute_base + offset;
+        return 1;
+    }
+
+    if (m3log_index_parse_time(text, len, nanos) != M3LOG_SUCCESS) {
+        return 0;
+    }
+    if (m3log_agg_seconds(text, len, &offset, &zone) && len - zone <= sizeof(agg->time_zone)) {
+        memcpy(agg->time_prefix, text, 16);
+        memcpy(agg->time_zone, text + zone, len - zone);
+        agg->zone_len = len - zone;
+        agg->minute_base = *nanos - offset;
+        agg->time_cached = 1;
+    }
+    return 1;
+}
+
+/* 解析时间戳第 16 个字符起的 ":SS[.小数]"，返回分钟内的纳秒偏移与时区部分的起点 */
+static int m3log_agg_seconds(const char *text, size_t len, int64_t *offset, size_t *zone) {
+    if (len < 19 || text[16] != ':' || text[17] < '0' || text[17] > '9' || text[18] < '0' || text[18] > '9') {
+        return 0;
+    }
+    int64_t second = (text[17] - '0') * 10 + (text[18] - '0');
+    if (second > 60) {
+        return 0;
+    }
+
+    size_t pos = 19;
+    int64_t fraction = 0;
+    if (pos < len && text[pos] == '.') {
+        pos++;
+        size_t digits = 0;
+        int64_t scale = 100000000;
+        while (pos < len && text[pos] >= '0' && text[pos] <= '9') {
+            if (digits < 9) {
+                fraction += (text[pos] - '0') * scale;
+                scale /= 10;
+            }
+            digits++;
+            pos++;
+        }
+        if (digits == 0) {
+            return 0;
+        }
+    }
+    *offset = second * 1000000000 + fraction;
+    *zone = pos;
+    return 1;
+}
+
+static int64_t m3log_agg_floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+static size_t m3log_agg_slot(const m3log_agg_t *agg, int64_t bucket) {
+    int64_t slot = bucket % (int64_t)agg->buckets;
+    return (size_t)(slot < 0 ? slot + (int64_t)agg->buckets : slot);
+}
+
+/* 最新的桶前进到 bucket：先关闭超出迟到范围的桶，再清空新桶占用的槽位 */
+static void m3log_agg_advance(m3log_agg_t *agg, int64_t bucket) {
+    int64_t closed = bucket - (int64_t)agg->lateness;
+    int64_t oldest = bucket - (int64_t)agg->buckets + 1;
+    int64_t first = oldest;
+    if (agg->head != M3LOG_AGG_EMPTY) {
+        m3log_agg_close(agg, closed);
+        if (agg->head + 1 > first) {
+            first = agg->head + 1;
+        }
+    }
+
+    size_t row = agg->tag_capacity * M3LOG_AGG_LEVELS;
+    for (int64_t b = first; b <= bucket; b++) {
+        size_t slot = m3log_agg_slot(agg, b);
+        agg->epochs[slot] = b;
+        memset(agg->counts + slot * row, 0, row * sizeof(uint64_t));
+        memset(agg->totals + slot * M3LOG_AGG_LEVELS, 0, M3LOG_AGG_LEVELS * sizeof(uint64_t));
+    }
+    agg->head = bucket;
+    if (closed > agg->closed) {
+        agg->closed = closed;
+    }
+}
+
+/* 关闭序号小于 until 的桶，对有数据的桶调用 on_close */
+static void m3log_agg_close(m3log_agg_t *agg, int64_t until) {
+    if (until <= agg->closed) {
+        return;
+    }
+    if (agg->on_close) {
+        int64_t first = agg->head - (int64_t)agg->buckets + 1;
+        if (agg->closed > first) {
+            first = agg->closed;
+        }
+        for (int64_t b = first; b < until && b <= agg->head; b++) {
+            size_t slot = m3log_agg_slot(agg, b);
+            if (agg->epochs[slot] == b && m3log_agg_bucket_lines(agg, slot) > 0) {
+                agg->on_close(agg, b * agg->width, agg->user_data);
+            }
+        }
+    }
+    agg->closed = until;
+}
+
+static uint64_t m3log_agg_bucket_lines(const m3log_agg_t *agg, size_t slot) {
+    uint64_t lines = 0;
+    for (size_t level = 0; level < M3LOG_AGG_LEVELS; level++) {
+        lines += agg->totals[slot * M3LOG_AGG_LEVELS + level];
+    }
+    return lines;
+}
+
+static void *m3log_agg_merge_main(void *arg) {
+    m3log_agg_merge_job_t *job = (m3log_agg_merge_job_t *)arg;
+    job->result = m3log_agg_merge(job->dst, job->src);
+    return NULL;
+}
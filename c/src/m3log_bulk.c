@@ -0,0 +1,361 @@
+/**
+ * @file m3log_bulk.c
+ * @brief m3log 大文件批量解析实现
+ */
+
+#include "../include/m3log_bulk.h"
+#include "../include/m3log_simd.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define M3LOG_BULK_INITIAL_VIEWS 4096
+#define M3LOG_BULK_INITIAL_ARENA (64u << 10)
+
+/* 所有工作线程共享的任务状态 */
+typedef struct {
+    const char *data;
+    size_t len;
+    size_t chunk_size;
+    size_t chunk_count;
+    int preserve_order;
+    m3log_bulk_callback_t callback;
+    void *user_data;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    size_t next_chunk;    /* 下一个待领取的块 */
+    size_t next_delivery; /* preserve_order 时下一个允许回调的块 */
+    int stop;
+    m3log_error_t error;
+} m3log_bulk_job_t;
+
+/* 每个工作线程私有的批次缓冲区，跨块复用 */
+typedef struct {
+    m3log_bulk_job_t *job;
+    size_t index;
+    m3log_view_t *views;
+    size_t *offsets;
+    size_t count;
+    size_t capacity;
+    size_t invalid;
+    m3log_arena_t arena;
+    size_t total_entries;
+    size_t total_invalid;
+} m3log_bulk_worker_t;
+
+/* 内部函数声明 */
+static size_t m3log_bulk_chunk_start(const m3log_bulk_job_t *job, size_t index);
+static m3log_error_t m3log_bulk_parse_line(m3log_bulk_worker_t *worker, const char *line, size_t len,
+                                           size_t offset);
+static m3log_error_t m3log_bulk_parse_chunk(m3log_bulk_worker_t *worker, size_t index);
+static int m3log_bulk_deliver(m3log_bulk_worker_t *worker, size_t index);
+static void m3log_bulk_fail(m3log_bulk_job_t *job, m3log_error_t error);
+static void *m3log_bulk_worker_main(void *arg);
+static size_t m3log_bulk_default_threads(void);
+
+m3log_error_t m3log_bulk_parse_buffer(const char *data, size_t len, const m3log_bulk_options_t *options,
+                                      m3log_bulk_callback_t callback, void *user_data,
+                                      m3log_bulk_stats_t *stats) {
+    if ((!data && len > 0) || !callback) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    m3log_bulk_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.data = data;
+    job.len = len;
+    job.chunk_size = options && options->chunk_size ? options->chunk_size : M3LOG_BULK_DEFAULT_CHUNK;
+    job.chunk_count = (len + job.chunk_size - 1) / job.chunk_size;
+    job.preserve_order = options ? options->preserve_order : 0;
+    job.callback = callback;
+    job.user_data = user_data;
+    job.error = M3LOG_SUCCESS;
+
+    size_t threads = options && options->threads ? options->threads : m3log_bulk_default_threads();
+    if (threads > job.chunk_count) {
+        threads = job.chunk_count;
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    m3log_bulk_worker_t *workers = (m3log_bulk_worker_t *)calloc(threads, sizeof(m3log_bulk_worker_t));
+    pthread_t *handles = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if (!workers || !handles) {
+        free(workers);
+        free(handles);
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    pthread_mutex_init(&job.mutex, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    /* 调用线程自身作为 0 号工作线程，其余线程创建失败时由已有线程分担 */
+    size_t started = 1;
+    for (size_t i = 0; i < threads; i++) {
+        workers[i].job = &job;
+        workers[i].index = i;
+    }
+    for (size_t i = 1; i < threads; i++) {
+        if (pthread_create(&handles[i], NULL, m3log_bulk_worker_main, &workers[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+    m3log_bulk_worker_main(&workers[0]);
+    for (size_t i = 1; i < started; i++) {
+        pthread_join(handles[i], NULL);
+    }
+
+    if (stats) {
+        memset(stats, 0, sizeof(m3log_bulk_stats_t));
+        stats->bytes = len;
+        stats->chunks = job.chunk_count;
+        stats->threads = started;
+    }
+    for (size_t i = 0; i < threads; i++) {
+        if (stats) {
+            stats->entries += workers[i].total_entries;
+            stats->invalid += workers[i].total_invalid;
+        }
+        free(workers[i].views);
+        free(workers[i].offsets);
+        free(workers[i].arena.base);
+    }
+
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.mutex);
+    free(workers);
+    free(handles);
+    return job.error;
+}
+
+m3log_error_t m3log_bulk_parse_file(const char *path, const m3log_bulk_options_t *options,
+                                    m3log_bulk_callback_t callback, void *user_data,
+                                    m3log_bulk_stats_t *stats) {
+    if (!path || !callback) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return M3LOG_ERROR_IO;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return M3LOG_ERROR_IO;
+    }
+
+    size_t len = (size_t)st.st_size;
+    if (len == 0) {
+        close(fd);
+        return m3log_bulk_parse_buffer(NULL, 0, options, callback, user_data, stats);
+    }
+
+    void *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return M3LOG_ERROR_IO;
+    }
+
+    /* 每个线程顺序读取各自的块，提示内核加大预读 */
+    madvise(data, len, MADV_SEQUENTIAL);
+
+    m3log_error_t result = m3log_bulk_parse_buffer((const char *)data, len, options, callback, user_data, stats);
+    munmap(data, len);
+    return result;
+}
+
+/* 内部辅助函数实现 */
+
+/* 块 i 从名义起点 i * chunk_size 处或之后的第一个行首开始，保证每行只属于一个块 */
+static size_t m3log_bulk_chunk_start(const m3log_bulk_job_t *job, size_t index) {
+    if (index == 0) {
+        return 0;
+    }
+    if (index >= job->chunk_count) {
+        return job->len;
+    }
+
+    size_t nominal = index * job->chunk_size;
+    const char *newline = m3log_find_newline(job->data + nominal - 1, job->len - nominal + 1);
+    return newline ? (size_t)(newline - job->data) + 1 : job->len;
+}
+
+static m3log_error_t m3log_bulk_parse_line(m3log_bulk_worker_t *worker, const char *line, size_t len,
+                                           size_t offset) {
+    if (worker->count == worker->capacity) {
+        size_t capacity = worker->capacity ? worker->capacity * 2 : M3LOG_BULK_INITIAL_VIEWS;
+        m3log_view_t *views = (m3log_view_t *)realloc(worker->views, capacity * sizeof(m3log_view_t));
+        if (!views) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        worker->views = views;
+
+        size_t *offsets = (size_t *)realloc(worker->offsets, capacity * sizeof(size_t));
+        if (!offsets) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        worker->offsets = offsets;
+        worker->capacity = capacity;
+    }
+
+    m3log_view_t *view = &worker->views[worker->count];
+    for (;;) {
+        size_t used = worker->arena.used;
+        m3log_error_t err = m3log_parse_view(line, len, view, &worker->arena);
+        if (err != M3LOG_ERROR_BUFFER_TOO_SMALL) {
+            if (err != M3LOG_SUCCESS) {
+                worker->invalid++;
+                return M3LOG_SUCCESS;
+            }
+            break;
+        }
+
+        /* 标签过多：扩大 arena 后重新解析，并修正已解析行中指向旧 arena 的标签数组 */
+        worker->arena.used = used;
+        size_t capacity = worker->arena.capacity ? worker->arena.capacity * 2 : M3LOG_BULK_INITIAL_ARENA;
+        char *base = (char *)realloc(worker->arena.base, capacity);
+        if (!base) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        for (size_t i = 0; i < worker->count; i++) {
+            m3log_view_t *prev = &worker->views[i];
+            if (prev->tag_count > M3LOG_VIEW_INLINE_TAGS) {
+                prev->tags = (m3log_slice_t *)(base + ((char *)prev->tags - worker->arena.base));
+            }
+        }
+        worker->arena.base = base;
+        worker->arena.capacity = capacity;
+    }
+
+    worker->offsets[worker->count] = offset;
+    worker->count++;
+    return M3LOG_SUCCESS;
+}
+
+static m3log_error_t m3log_bulk_parse_chunk(m3log_bulk_worker_t *worker, size_t index) {
+    const m3log_bulk_job_t *job = worker->job;
+    size_t begin = m3log_bulk_chunk_start(job, index);
+    size_t end = m3log_bulk_chunk_start(job, index + 1);
+
+    worker->count = 0;
+    worker->invalid = 0;
+    m3log_arena_reset(&worker->arena);
+
+    const char *p = job->data + begin;
+    const char *chunk_end = job->data + end;
+    while (p < chunk_end) {
+        const char *newline = m3log_find_newline(p, (size_t)(chunk_end - p));
+        const char *line_end = newline ? newline : chunk_end;
+        size_t line_len = (size_t)(line_end - p);
+        if (line_len > 0 && p[line_len - 1] == '\r') {
+            line_len--;
+        }
+
+        if (line_len > 0) {
+            m3log_error_t err = m3log_bulk_parse_line(worker, p, line_len, (size_t)(p - job->data));
+            if (err != M3LOG_SUCCESS) {
+                return err;
+            }
+        }
+        p = line_end + 1;
+    }
+
+    /* 视图数组可能被 realloc 过，内联标签指针需要指回各自的结构体 */
+    for (size_t i = 0; i < worker->count; i++) {
+        if (worker->views[i].tag_count <= M3LOG_VIEW_INLINE_TAGS) {
+            worker->views[i].tags = worker->views[i].inline_tags;
+        }
+    }
+    return M3LOG_SUCCESS;
+}
+
+static int m3log_bulk_deliver(m3log_bulk_worker_t *worker, size_t index) {
+    m3log_bulk_job_t *job = worker->job;
+    m3log_bulk_batch_t batch;
+    batch.views = worker->views;
+    batch.offsets = worker->offsets;
+    batch.count = worker->count;
+    batch.invalid = worker->invalid;
+    batch.chunk_index = index;
+    batch.worker = worker->index;
+
+    worker->total_entries += worker->count;
+    worker->total_invalid += worker->invalid;
+
+    if (!job->preserve_order) {
+        return job->callback(&batch, job->user_data);
+    }
+
+    /* 保序模式：等待前一个块回调完成，解析本身仍然并行 */
+    pthread_mutex_lock(&job->mutex);
+    while (job->next_delivery != index && !job->stop) {
+        pthread_cond_wait(&job->cond, &job->mutex);
+    }
+    int stopped = job->stop;
+    pthread_mutex_unlock(&job->mutex);
+    if (stopped) {
+        return 0;
+    }
+
+    int result = job->callback(&batch, job->user_data);
+
+    pthread_mutex_lock(&job->mutex);
+    job->next_delivery++;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->mutex);
+    return result;
+}
+
+static void m3log_bulk_fail(m3log_bulk_job_t *job, m3log_error_t error) {
+    pthread_mutex_lock(&job->mutex);
+    if (!job->stop) {
+        job->stop = 1;
+        job->error = error;
+    }
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->mutex);
+}
+
+static void *m3log_bulk_worker_main(void *arg) {
+    m3log_bulk_worker_t *worker = (m3log_bulk_worker_t *)arg;
+    m3log_bulk_job_t *job = worker->job;
+
+    for (;;) {
+        /* 按顺序领取块，保序模式下等待时间因此最短 */
+        pthread_mutex_lock(&job->mutex);
+        size_t index = job->next_chunk;
+        int done = job->stop || index >= job->chunk_count;
+        if (!done) {
+            job->next_chunk++;
+        }
+        pthread_mutex_unlock(&job->mutex);
+        if (done) {
+            break;
+        }
+
+        m3log_error_t err = m3log_bulk_parse_chunk(worker, index);
+        if (err != M3LOG_SUCCESS) {
+            m3log_bulk_fail(job, err);
+            break;
+        }
+        if (m3log_bulk_deliver(worker, index) != 0) {
+            m3log_bulk_fail(job, M3LOG_ERROR_ABORTED);
+            break;
+        }
+    }
+    return NULL;
+}
+
+static size_t m3log_bulk_default_threads(void) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (size_t)online : 1;
+}
@@ -0,0 +1,661 @@
+/**
+ * @file m3log_index.c
+ * @brief m3log 旁路索引实现
+ */
+
+#include "../include/m3log_index.h"
+#include "../include/m3log_simd.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * 索引文件布局（本机字节序）：
+ *   [0, 64)   文件头：魔数 "M3IX"、版本、每块行数、布隆过滤器字节数
+ *   [64, ...) 块记录，每条为 m3log_index_block_t 加 bloom_bytes 字节的布隆过滤器，按日志顺序首尾相接
+ * 最后一条记录的行数不足 block_lines 时是关闭时写出的未满块，再次打开时被丢弃并重新生成。
+ */
+#define M3LOG_INDEX_VERSION 1
+#define M3LOG_INDEX_HEADER_SIZE 64
+#define M3LOG_INDEX_MAX_BLOOM (64u << 10)
+#define M3LOG_INDEX_HASHES 4
+#define M3LOG_INDEX_SUFFIX ".m3ix"
+#define M3LOG_INDEX_INITIAL_ARENA 4096
+
+/* 块内至少有一行带时间戳，min_time / max_time 有效 */
+#define M3LOG_INDEX_TIMED 1
+/* 块内有无法完整解析的行（标签过多），查询时总是作为候选 */
+#define M3LOG_INDEX_OPAQUE 2
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t block_lines;
+    uint32_t bloom_bytes;
+    uint8_t reserved[48];
+} m3log_index_header_t;
+
+typedef struct {
+    uint64_t offset;    /* 块在日志中的起始偏移 */
+    uint64_t length;    /* 块的字节数（含换行） */
+    int64_t min_time;   /* 块内最早的时间戳（纳秒） */
+    int64_t max_time;   /* 块内最晚的时间戳（纳秒） */
+    uint32_t lines;     /* 行数 */
+    uint8_t level_mask; /* 出现过的级别，M3LOG_LEVEL_BIT 的组合 */
+    uint8_t flags;
+    uint16_t reserved;
+} m3log_index_block_t;
+
+typedef char m3log_index_header_size_check[sizeof(m3log_index_header_t) == M3LOG_INDEX_HEADER_SIZE ? 1 : -1];
+typedef char m3log_index_block_size_check[sizeof(m3log_index_block_t) == 40 ? 1 : -1];
+
+struct m3log_index_builder {
+    int fd;
+    uint32_t block_lines;
+    uint32_t bloom_bytes;
+    size_t record_size;
+    uint64_t offset;           /* 下一行在日志中的偏移 */
+    m3log_index_block_t block; /* 正在累积的块 */
+    unsigned char *record;     /* 序列化缓冲区：块记录与紧随其后的布隆过滤器（直接在此累积） */
+    m3log_error_t error;
+    m3log_slice_t overflow[64];
+};
+
+/* 内部函数声明 */
+static char *m3log_index_default_path(const char *log_path, const char *index_path);
+static int m3log_index_valid_header(const m3log_index_header_t *header);
+static int m3log_index_read_at(int fd, void *buffer, size_t len, off_t offset);
+static int m3log_index_write_all(int fd, const void *buffer, size_t len);
+static uint64_t m3log_index_hash(const char *data, size_t len);
+static void m3log_index_bloom_add(unsigned char *bloom, uint32_t bloom_bytes, uint64_t hash);
+static int m3log_index_bloom_test(const unsigned char *bloom, uint32_t bloom_bytes, uint64_t hash);
+static void m3log_index_builder_feed(m3log_index_builder_t *builder, const char *line, size_t len,
+                                     size_t consumed);
+static void m3log_index_builder_reset(m3log_index_builder_t *builder);
+static void m3log_index_builder_emit(m3log_index_builder_t *builder);
+static int64_t m3log_index_days_from_civil(int64_t year, unsigned month, unsigned day);
+static int m3log_index_digits(const char *p, size_t n, int *value);
+
+m3log_error_t m3log_index_parse_time(const char *text, size_t len, int64_t *nanos) {
+    if (!text || !nanos) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    int year, month, day, hour, minute, second;
+    if (len < 19 || text[4] != '-' || text[7] != '-' || (text[10] != 'T' && text[10] != ' ') ||
+        text[13] != ':' || text[16] != ':' || !m3log_index_digits(text, 4, &year) ||
+        !m3log_index_digits(text + 5, 2, &month) || !m3log_index_digits(text + 8, 2, &day) ||
+        !m3log_index_digits(text + 11, 2, &hour) || !m3log_index_digits(text + 14, 2, &minute) ||
+        !m3log_index_digits(text + 17, 2, &second)) {
+        return M3LOG_ERROR_INVALID_FORMAT;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return M3LOG_ERROR_INVALID_FORMAT;
+    }
+
+    /* 小数部分：最多取 9 位，更多的位被忽略 */
+    size_t pos = 19;
+    int64_t fraction = 0;
+    if (pos < len && text[pos] == '.') {
+        pos++;
+        size_t digits = 0;
+        int64_t scale = 100000000;
+        while (pos < len && text[pos] >= '0' && text[pos] <= '9') {
+            if (digits < 9) {
+                fraction += (text[pos] - '0') * scale;
+                scale /= 10;
+            }
+            digits++;
+            pos++;
+        }
+        if (digits == 0) {
+            return M3LOG_ERROR_INVALID_FORMAT;
+        }
+    }
+
+    int64_t zone = 0;
+    if (pos < len && text[pos] == 'Z') {
+        pos++;
+    } else if (pos < len && (text[pos] == '+' || text[pos] == '-')) {
+        int zone_hour, zone_minute;
+        int sign = text[pos] == '-' ? -1 : 1;
+        pos++;
+        if (len - pos < 4 || !m3log_index_digits(text + pos, 2, &zone_hour)) {
+            return M3LOG_ERROR_INVALID_FORMAT;
+        }
+        pos += 2;
+        if (text[pos] == ':') {
+            pos++;
+        }
+        if (len - pos < 2 || !m3log_index_digits(text + pos, 2, &zone_minute)) {
+            return M3LOG_ERROR_INVALID_FORMAT;
+        }
+        pos += 2;
+        zone = sign * (zone_hour * 3600 + zone_minute * 60);
+    }
+    if (pos != len) {
+        return M3LOG_ERROR_INVALID_FORMAT;
+    }
+
+    int64_t days = m3log_index_days_from_civil(year, (unsigned)month, (unsigned)day);
+    int64_t seconds = days * 86400 + hour * 3600 + minute * 60 + second - zone;
+    *nanos = seconds * 1000000000 + fraction;
+    return M3LOG_SUCCESS;
+}
+
+m3log_error_t m3log_index_builder_open(const char *log_path, const char *index_path,
+                                       const m3log_index_options_t *options, m3log_index_builder_t **builder) {
+    if (!log_path || !builder) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    *builder = NULL;
+
+    char *path = m3log_index_default_path(log_path, index_path);
+    if (!path) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    int log_fd = open(log_path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (log_fd < 0 || fstat(log_fd, &st) != 0) {
+        if (log_fd >= 0) {
+            close(log_fd);
+        }
+        free(path);
+        return M3LOG_ERROR_IO;
+    }
+    uint64_t log_size = (uint64_t)st.st_size;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    free(path);
+    if (fd < 0) {
+        close(log_fd);
+        return M3LOG_ERROR_IO;
+    }
+
+    /* 沿用已有索引：丢弃末尾未写完的记录与未满块，从其覆盖范围之后继续 */
+    m3log_index_header_t header;
+    uint64_t kept = 0;
+    uint64_t covered = 0;
+    size_t record_size = 0;
+    int valid = fstat(fd, &st) == 0 && m3log_index_read_at(fd, &header, sizeof(header), 0) &&
+                m3log_index_valid_header(&header);
+    if (valid) {
+        record_size = sizeof(m3log_index_block_t) + header.bloom_bytes;
+        kept = ((uint64_t)st.st_size - M3LOG_INDEX_HEADER_SIZE) / record_size;
+        m3log_index_block_t last;
+        if (kept > 0 && m3log_index_read_at(fd, &last, sizeof(last),
+                                            (off_t)(M3LOG_INDEX_HEADER_SIZE + (kept - 1) * record_size))) {
+            if (last.lines < header.block_lines) {
+                kept--;
+                covered = last.offset;
+            } else {
+                covered = last.offset + last.length;
+            }
+        } else {
+            kept = 0;
+        }
+        /* 日志比索引覆盖的范围短：已被截断或替换 */
+        valid = covered <= log_size;
+    }
+    if (!valid) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "M3IX", 4);
+        header.version = M3LOG_INDEX_VERSION;
+        header.block_lines = (uint32_t)(options && options->block_lines ? options->block_lines
+                                                                         : M3LOG_INDEX_DEFAULT_BLOCK_LINES);
+        size_t bloom = options && options->bloom_bytes ? options->bloom_bytes : M3LOG_INDEX_DEFAULT_BLOOM_BYTES;
+        bloom = (bloom + 7) & ~(size_t)7;
+        header.bloom_bytes = (uint32_t)(bloom > M3LOG_INDEX_MAX_BLOOM ? M3LOG_INDEX_MAX_BLOOM : bloom);
+        record_size = sizeof(m3log_index_block_t) + header.bloom_bytes;
+        kept = 0;
+        covered = 0;
+    }
+
+    if (ftruncate(fd, (off_t)(M3LOG_INDEX_HEADER_SIZE + kept * record_size)) != 0 ||
+        (!valid && (lseek(fd, 0, SEEK_SET) != 0 || !m3log_index_write_all(fd, &header, sizeof(header)))) ||
+        lseek(fd, 0, SEEK_END) < 0) {
+        close(fd);
+        close(log_fd);
+        return M3LOG_ERROR_IO;
+    }
+
+    m3log_index_builder_t *result = (m3log_index_builder_t *)calloc(1, sizeof(m3log_index_builder_t));
+    unsigned char *record = (unsigned char *)calloc(1, record_size);
+    if (!result || !record) {
+        free(result);
+        free(record);
+        close(fd);
+        close(log_fd);
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    result->fd = fd;
+    result->block_lines = header.block_lines;
+    result->bloom_bytes = header.bloom_bytes;
+    result->record_size = record_size;
+    result->offset = covered;
+    result->record = record;
+    result->error = M3LOG_SUCCESS;
+    m3log_index_builder_reset(result);
+
+    /* 补齐日志中尚未索引的部分；末尾没有换行的残行按实际长度计入 */
+    if (log_size > covered) {
+        void *data = mmap(NULL, (size_t)log_size, PROT_READ, MAP_PRIVATE, log_fd, 0);
+        if (data == MAP_FAILED) {
+            close(log_fd);
+            m3log_index_builder_close(result);
+            return M3LOG_ERROR_IO;
+        }
+        madvise(data, (size_t)log_size, MADV_SEQUENTIAL);
+
+        const char *p = (const char *)data + covered;
+        const char *end = (const char *)data + log_size;
+        while (p < end) {
+            const char *newline = m3log_find_newline(p, (size_t)(end - p));
+            const char *line_end = newline ? newline : end;
+            size_t len = (size_t)(line_end - p);
+            m3log_index_builder_feed(result, p, len, newline ? len + 1 : len);
+            p = line_end + 1;
+        }
+        munmap(data, (size_t)log_size);
+    }
+    close(log_fd);
+
+    *builder = result;
+    return M3LOG_SUCCESS;
+}
+
+void m3log_index_builder_add(m3log_index_builder_t *builder, const char *line, size_t len) {
+    if (!builder || (!line && len > 0)) {
+        return;
+    }
+    m3log_index_builder_feed(builder, line, len, len + 1);
+}
+
+m3log_error_t m3log_index_builder_close(m3log_index_builder_t *builder) {
+    if (!builder) {
+        return M3LOG_SUCCESS;
+    }
+
+    if (builder->block.lines > 0) {
+        m3log_index_builder_emit(builder);
+    }
+    m3log_error_t err = builder->error;
+    if (close(builder->fd) != 0 && err == M3LOG_SUCCESS) {
+        err = M3LOG_ERROR_IO;
+    }
+    free(builder->record);
+    free(builder);
+    return err;
+}
+
+m3log_error_t m3log_index_build(const char *log_path, const char *index_path, const m3log_index_options_t *options) {
+    m3log_index_builder_t *builder;
+    m3log_error_t err = m3log_index_builder_open(log_path, index_path, options, &builder);
+    if (err != M3LOG_SUCCESS) {
+        return err;
+    }
+    return m3log_index_builder_close(builder);
+}
+
+m3log_error_t m3log_index_query(const char *log_path, const char *index_path, const m3log_index_query_t *query,
+                                m3log_index_callback_t callback, void *user_data, m3log_index_stats_t *stats) {
+    if (!log_path || !callback || (query && query->tag_count > 0 && !query->tags)) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    m3log_index_query_t all;
+    if (!query) {
+        memset(&all, 0, sizeof(all));
+        query = &all;
+    }
+    if (stats) {
+        memset(stats, 0, sizeof(m3log_index_stats_t));
+    }
+
+    int fd = open(log_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return M3LOG_ERROR_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return M3LOG_ERROR_IO;
+    }
+    uint64_t size = (uint64_t)st.st_size;
+    const char *data = NULL;
+    if (size > 0) {
+        void *map = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return M3LOG_ERROR_IO;
+        }
+        /* 只读取候选块，关闭预读 */
+        madvise(map, (size_t)size, MADV_RANDOM);
+        data = (const char *)map;
+    }
+    close(fd);
+
+    /* 读取整个索引；不存在或无效时没有可用的块 */
+    m3log_index_header_t header;
+    unsigned char *records = NULL;
+    uint64_t record_count = 0;
+    size_t record_size = 0;
+    char *path = m3log_index_default_path(log_path, index_path);
+    int index_fd = path ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+    free(path);
+    if (index_fd >= 0) {
+        if (fstat(index_fd, &st) == 0 && m3log_index_read_at(index_fd, &header, sizeof(header), 0) &&
+            m3log_index_valid_header(&header)) {
+            record_size = sizeof(m3log_index_block_t) + header.bloom_bytes;
+            record_count = ((uint64_t)st.st_size - M3LOG_INDEX_HEADER_SIZE) / record_size;
+            records = record_count ? (unsigned char *)malloc((size_t)(record_count * record_size)) : NULL;
+            if (!records ||
+                !m3log_index_read_at(index_fd, records, (size_t)(record_count * record_size), M3LOG_INDEX_HEADER_SIZE)) {
+                record_count = 0;
+            }
+        }
+        close(index_fd);
+    }
+
+    uint64_t *hashes = NULL;
+    size_t *tag_lengths = NULL;
+    m3log_arena_t arena;
+    m3log_arena_init(&arena, malloc(M3LOG_INDEX_INITIAL_ARENA), M3LOG_INDEX_INITIAL_ARENA);
+    if (query->tag_count > 0) {
+        hashes = (uint64_t *)malloc(query->tag_count * sizeof(uint64_t));
+        tag_lengths = (size_t *)malloc(query->tag_count * sizeof(size_t));
+    }
+    if (!arena.base || (query->tag_count > 0 && (!hashes || !tag_lengths))) {
+        free(arena.base);
+        free(hashes);
+        free(tag_lengths);
+        free(records);
+        if (data) {
+            munmap((void *)data, (size_t)size);
+        }
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    for (size_t i = 0; i < query->tag_count; i++) {
+        tag_lengths[i] = strlen(query->tags[i]);
+        hashes[i] = m3log_index_hash(query->tags[i], tag_lengths[i]);
+    }
+
+    /* 依次检查索引中与日志衔接的块，之后的部分（未成块或索引落后）完整扫描 */
+    m3log_error_t result = M3LOG_SUCCESS;
+    uint64_t covered = 0;
+    uint64_t index = 0;
+    for (;;) {
+        uint64_t begin = covered;
+        uint64_t end = size;
+        int candidate = 1;
+        if (index < record_count) {
+            m3log_index_block_t block;
+            const unsigned char *record = records + index * record_size;
+            memcpy(&block, record, sizeof(block));
+            if (block.offset == covered && block.offset + block.length <= size) {
+                const unsigned char *bloom = record + sizeof(block);
+                end = block.offset + block.length;
+                if (!(block.flags & M3LOG_INDEX_OPAQUE)) {
+                    if (query->level_mask && !(block.level_mask & query->level_mask)) {
+                        candidate = 0;
+                    }
+                    if (query->has_time_range &&
+                        (!(block.flags & M3LOG_INDEX_TIMED) || block.max_time < query->min_time ||
+                         block.min_time > query->max_time)) {
+                        candidate = 0;
+                    }
+                    for (size_t i = 0; candidate && i < query->tag_count; i++) {
+                        candidate = m3log_index_bloom_test(bloom, header.bloom_bytes, hashes[i]);
+                    }
+                }
+                if (stats) {
+                    stats->blocks++;
+                    stats->candidates += (size_t)candidate;
+                }
+                index++;
+            } else {
+                index = record_count;
+            }
+        }
+        covered = end;
+
+        if (candidate && end > begin) {
+            if (stats) {
+                stats->bytes_scanned += end - begin;
+            }
+            const char *p = data + begin;
+            const char *range_end = data + end;
+            while (p < range_end && result == M3LOG_SUCCESS) {
+                const char *newline = m3log_find_newline(p, (size_t)(range_end - p));
+                const char *line_end = newline ? newline : range_end;
+                size_t len = (size_t)(line_end - p);
+                if (len > 0 && p[len - 1] == '\r') {
+                    len--;
+                }
+
+                m3log_view_t view;
+                m3log_error_t err = len > 0 ? m3log_parse_view(p, len, &view, &arena) : M3LOG_ERROR_INVALID_FORMAT;
+                while (err == M3LOG_ERROR_BUFFER_TOO_SMALL) {
+                    size_t capacity = arena.capacity * 2;
+                    char *base = (char *)realloc(arena.base, capacity);
+                    if (!base) {
+                        result = M3LOG_ERROR_MEMORY_ALLOCATION;
+                        break;
+                    }
+                    m3log_arena_init(&arena, base, capacity);
+                    err = m3log_parse_view(p, len, &view, &arena);
+                }
+                m3log_arena_reset(&arena);
+
+                if (err == M3LOG_SUCCESS) {
+                    int match = !query->level_mask || (query->level_mask & M3LOG_LEVEL_BIT(view.level));
+                    if (match && query->has_time_range) {
+                        int64_t time;
+                        match = view.time.len > 0 &&
+                                m3log_index_parse_time(view.time.ptr, view.time.len, &time) == M3LOG_SUCCESS &&
+                                time >= query->min_time && time <= query->max_time;
+                    }
+                    for (size_t i = 0; match && i < query->tag_count; i++) {
+                        match = 0;
+                        for (size_t j = 0; j < view.tag_count && !match; j++) {
+                            match = view.tags[j].len == tag_lengths[i] &&
+                                    memcmp(view.tags[j].ptr, query->tags[i], tag_lengths[i]) == 0;
+                        }
+                    }
+                    if (stats) {
+                        stats->lines_parsed++;
+                        stats->matches += (size_t)match;
+                    }
+                    if (match && callback(&view, p, len, (uint64_t)(p - data), user_data) != 0) {
+                        result = M3LOG_ERROR_ABORTED;
+                    }
+                }
+                p = line_end + 1;
+            }
+        }
+        if (covered >= size || result != M3LOG_SUCCESS) {
+            break;
+        }
+    }
+
+    if (stats) {
+        stats->bytes = size;
+    }
+    free(arena.base);
+    free(hashes);
+    free(tag_lengths);
+    free(records);
+    if (data) {
+        munmap((void *)data, (size_t)size);
+    }
+    return result;
+}
+
+/* 内部辅助函数实现 */
+
+static char *m3log_index_default_path(const char *log_path, const char *index_path) {
+    const char *suffix = index_path ? "" : M3LOG_INDEX_SUFFIX;
+    const char *base = index_path ? index_path : log_path;
+    size_t base_len = strlen(base);
+    size_t suffix_len = strlen(suffix);
+    char *path = (char *)malloc(base_len + suffix_len + 1);
+    if (path) {
+        memcpy(path, base, base_len);
+        memcpy(path + base_len, suffix, suffix_len + 1);
+    }
+    return path;
+}
+
+static int m3log_index_valid_header(const m3log_index_header_t *header) {
+    return memcmp(header->magic, "M3IX", 4) == 0 && header->version == M3LOG_INDEX_VERSION &&
+           header->block_lines > 0 && header->bloom_bytes > 0 && header->bloom_bytes % 8 == 0 &&
+           header->bloom_bytes <= M3LOG_INDEX_MAX_BLOOM;
+}
+
+static int m3log_index_read_at(int fd, void *buffer, size_t len, off_t offset) {
+    char *p = (char *)buffer;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 1;
+}
+
+static int m3log_index_write_all(int fd, const void *buffer, size_t len) {
+    const char *p = (const char *)buffer;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+/* FNV-1a，布隆过滤器的各个位置由 h1 + i * h2 得出 */
+static uint64_t m3log_index_hash(const char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void m3log_index_bloom_add(unsigned char *bloom, uint32_t bloom_bytes, uint64_t hash) {
+    uint64_t bits = (uint64_t)bloom_bytes * 8;
+    uint64_t h2 = (hash >> 32) | 1;
+    for (unsigned i = 0; i < M3LOG_INDEX_HASHES; i++) {
+        uint64_t bit = (hash + i * h2) % bits;
+        bloom[bit >> 3] |= (unsigned char)(1u << (bit & 7));
+    }
+}
+
+static int m3log_index_bloom_test(const unsigned char *bloom, uint32_t bloom_bytes, uint64_t hash) {
+    uint64_t bits = (uint64_t)bloom_bytes * 8;
+    uint64_t h2 = (hash >> 32) | 1;
+    for (unsigned i = 0; i < M3LOG_INDEX_HASHES; i++) {
+        uint64_t bit = (hash + i * h2) % bits;
+        if (!(bloom[bit >> 3] & (1u << (bit & 7)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 计入一行；consumed 为该行在日志中占用的字节数（通常为 len + 1） */
+static void m3log_index_builder_feed(m3log_index_builder_t *builder, const char *line, size_t len,
+                                     size_t consumed) {
+    m3log_index_block_t *block = &builder->block;
+    if (block->lines == 0) {
+        block->offset = builder->offset;
+    }
+
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    m3log_arena_t arena;
+    m3log_arena_init(&arena, builder->overflow, sizeof(builder->overflow));
+    m3log_view_t view;
+    m3log_error_t err = len > 0 ? m3log_parse_view(line, len, &view, &arena) : M3LOG_ERROR_INVALID_FORMAT;
+    if (err == M3LOG_SUCCESS) {
+        unsigned char *bloom = builder->record + sizeof(m3log_index_block_t);
+        block->level_mask |= (uint8_t)M3LOG_LEVEL_BIT(view.level);
+        for (size_t i = 0; i < view.tag_count; i++) {
+            m3log_index_bloom_add(bloom, builder->bloom_bytes, m3log_index_hash(view.tags[i].ptr, view.tags[i].len));
+        }
+        int64_t time;
+        if (view.time.len > 0 && m3log_index_parse_time(view.time.ptr, view.time.len, &time) == M3LOG_SUCCESS) {
+            if (!(block->flags & M3LOG_INDEX_TIMED) || time < block->min_time) {
+                block->min_time = time;
+            }
+            if (!(block->flags & M3LOG_INDEX_TIMED) || time > block->max_time) {
+                block->max_time = time;
+            }
+            block->flags |= M3LOG_INDEX_TIMED;
+        }
+    } else if (err == M3LOG_ERROR_BUFFER_TOO_SMALL) {
+        block->flags |= M3LOG_INDEX_OPAQUE;
+    }
+    /* 格式无效的行不会被任何查询匹配，只计入字节范围 */
+
+    block->lines++;
+    builder->offset += consumed;
+    block->length = builder->offset - block->offset;
+    if (block->lines >= builder->block_lines) {
+        m3log_index_builder_emit(builder);
+    }
+}
+
+static void m3log_index_builder_reset(m3log_index_builder_t *builder) {
+    memset(&builder->block, 0, sizeof(builder->block));
+    builder->block.offset = builder->offset;
+    memset(builder->record + sizeof(m3log_index_block_t), 0, builder->bloom_bytes);
+}
+
+static void m3log_index_builder_emit(m3log_index_builder_t *builder) {
+    memcpy(builder->record, &builder->block, sizeof(builder->block));
+    if (!m3log_index_write_all(builder->fd, builder->record, builder->record_size)) {
+        builder->error = M3LOG_ERROR_IO;
+    }
+    m3log_index_builder_reset(builder);
+}
+
+/* 公历日期到 1970-01-01 的天数 */
+static int64_t m3log_index_days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = (unsigned)(year - era * 400);
+    unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (int64_t)day_of_era - 719468;
+}
+
+static int m3log_index_digits(const char *p, size_t n, int *value) {
+    int result = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return 0;
+        }
+        result = result * 10 + (p[i] - '0');
+    }
+    *value = result;
+    return 1;
+}
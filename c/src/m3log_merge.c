@@ -0,0 +1,261 @@
+/**
+ * @file m3log_merge.c
+ * @brief m3log 多路归并实现
+ */
+
+#include "../include/m3log_merge.h"
+#include "../include/m3log_index.h"
+#include "../include/m3log_simd.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* 单个输入：buf 中 [next, end) 为尚未交付的数据，当前日志为 [start, start + len) */
+typedef struct {
+    int fd;
+    char *buf;
+    size_t start;
+    size_t len;
+    size_t next;
+    size_t end;
+    int eof;
+    int discarding; /* 正在丢弃超长的日志，直到它结束 */
+    int64_t time;   /* 当前日志的排序时间 */
+    int timed;      /* 是否出现过带时间戳的日志 */
+} m3log_merge_input_t;
+
+/* 内部函数声明 */
+static int m3log_merge_next(m3log_merge_input_t *input, size_t capacity, m3log_merge_stats_t *stats);
+static void m3log_merge_set_time(m3log_merge_input_t *input, m3log_merge_stats_t *stats);
+static int m3log_merge_less(const m3log_merge_input_t *inputs, size_t a, size_t b);
+static void m3log_merge_sift_down(const m3log_merge_input_t *inputs, size_t *heap, size_t size, size_t pos);
+
+m3log_error_t m3log_merge_fds(const int *fds, size_t count, const m3log_merge_options_t *options,
+                              m3log_merge_callback_t callback, void *user_data, m3log_merge_stats_t *stats) {
+    if ((!fds && count > 0) || !callback) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    size_t capacity = options && options->buffer_size ? options->buffer_size : M3LOG_MERGE_DEFAULT_BUFFER;
+
+    m3log_merge_stats_t local;
+    memset(&local, 0, sizeof(local));
+    m3log_merge_input_t *inputs = (m3log_merge_input_t *)calloc(count ? count : 1, sizeof(m3log_merge_input_t));
+    size_t *heap = (size_t *)malloc((count ? count : 1) * sizeof(size_t));
+    m3log_error_t err = inputs && heap ? M3LOG_SUCCESS : M3LOG_ERROR_MEMORY_ALLOCATION;
+
+    /* 每个输入读出第一条日志，构建最小堆 */
+    size_t size = 0;
+    for (size_t i = 0; i < count && err == M3LOG_SUCCESS; i++) {
+        inputs[i].fd = fds[i];
+        inputs[i].time = INT64_MIN;
+        inputs[i].buf = (char *)malloc(capacity);
+        if (!inputs[i].buf) {
+            err = M3LOG_ERROR_MEMORY_ALLOCATION;
+            break;
+        }
+        int result = m3log_merge_next(&inputs[i], capacity, &local);
+        if (result < 0) {
+            err = M3LOG_ERROR_IO;
+        } else if (result > 0) {
+            heap[size++] = i;
+        }
+    }
+    if (err == M3LOG_SUCCESS) {
+        for (size_t pos = size / 2; pos-- > 0;) {
+            m3log_merge_sift_down(inputs, heap, size, pos);
+        }
+    }
+
+    /* 输出堆顶，再从同一输入补充下一条；该输入仍然最早时 sift_down 只做一次比较 */
+    while (err == M3LOG_SUCCESS && size > 0) {
+        size_t index = heap[0];
+        m3log_merge_input_t *input = &inputs[index];
+        if (callback(input->buf + input->start, input->len, index, user_data) != 0) {
+            err = M3LOG_ERROR_ABORTED;
+            break;
+        }
+        local.lines++;
+
+        int result = m3log_merge_next(input, capacity, &local);
+        if (result < 0) {
+            err = M3LOG_ERROR_IO;
+        } else {
+            if (result == 0) {
+                heap[0] = heap[--size];
+            }
+            m3log_merge_sift_down(inputs, heap, size, 0);
+        }
+    }
+
+    if (inputs) {
+        for (size_t i = 0; i < count; i++) {
+            free(inputs[i].buf);
+        }
+    }
+    free(inputs);
+    free(heap);
+    if (stats) {
+        *stats = local;
+    }
+    return err;
+}
+
+m3log_error_t m3log_merge_files(const char *const *paths, size_t count, const m3log_merge_options_t *options,
+                                m3log_merge_callback_t callback, void *user_data, m3log_merge_stats_t *stats) {
+    if ((!paths && count > 0) || !callback) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    int *fds = (int *)malloc((count ? count : 1) * sizeof(int));
+    if (!fds) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    m3log_error_t err = M3LOG_SUCCESS;
+    size_t opened = 0;
+    for (; opened < count; opened++) {
+        fds[opened] = open(paths[opened], O_RDONLY | O_CLOEXEC);
+        if (fds[opened] < 0) {
+            err = M3LOG_ERROR_IO;
+            break;
+        }
+    }
+    if (err == M3LOG_SUCCESS) {
+        err = m3log_merge_fds(fds, count, options, callback, user_data, stats);
+    }
+    for (size_t i = 0; i < opened; i++) {
+        close(fds[i]);
+    }
+    free(fds);
+    return err;
+}
+
+/* 内部辅助函数实现 */
+
+/*
+ * 读出下一条日志：以 '\' 结尾的物理行与下一行拼成一条，空行跳过。
+ * 缓冲区中没有完整的日志时把剩余部分移到开头再 read()，超过缓冲区的日志被丢弃。
+ * 返回 1 表示有日志，0 表示输入结束，-1 表示读取失败
+ */
+static int m3log_merge_next(m3log_merge_input_t *input, size_t capacity, m3log_merge_stats_t *stats) {
+    char *buf = input->buf;
+    size_t scan = input->next; /* 当前物理行的起点 */
+    for (;;) {
+        while (scan < input->end) {
+            const char *newline = m3log_find_newline(buf + scan, input->end - scan);
+            if (!newline) {
+                break;
+            }
+            size_t line_end = (size_t)(newline - buf);
+            size_t content_end = line_end;
+            if (content_end > scan && buf[content_end - 1] == '\r') {
+                content_end--;
+            }
+            if (content_end > scan && buf[content_end - 1] == '\\') {
+                scan = line_end + 1;
+                continue;
+            }
+
+            size_t start = input->next;
+            input->next = line_end + 1;
+            scan = input->next;
+            if (input->discarding) {
+                input->discarding = 0;
+                continue;
+            }
+            if (content_end == start) {
+                continue;
+            }
+            input->start = start;
+            input->len = line_end - start;
+            m3log_merge_set_time(input, stats);
+            return 1;
+        }
+
+        if (input->eof) {
+            /* 最后一条日志可以没有换行 */
+            size_t start = input->next;
+            input->next = input->end;
+            if (input->discarding || start == input->end) {
+                return 0;
+            }
+            input->start = start;
+            input->len = input->end - start;
+            m3log_merge_set_time(input, stats);
+            return 1;
+        }
+
+        size_t pending = input->end - input->next;
+        if (pending >= capacity) {
+            if (!input->discarding) {
+                stats->oversize++;
+                input->discarding = 1;
+            }
+            pending = 0;
+            input->next = input->end;
+            scan = input->end;
+        }
+        memmove(buf, buf + input->next, pending);
+        scan -= input->next;
+        input->next = 0;
+        input->end = pending;
+
+        ssize_t n = read(input->fd, buf + input->end, capacity - input->end);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            input->eof = 1;
+        }
+        input->end += (size_t)n;
+        stats->bytes += (uint64_t)n;
+    }
+}
+
+/* 取日志开头 "@时间戳 " 中的时间，没有时沿用上一条的时间 */
+static void m3log_merge_set_time(m3log_merge_input_t *input, m3log_merge_stats_t *stats) {
+    const char *line = input->buf + input->start;
+    size_t len = input->len;
+    int64_t time;
+    if (len > 1 && line[0] == '@') {
+        const char *space = (const char *)memchr(line, ' ', len);
+        size_t time_len = (space ? (size_t)(space - line) : len) - 1;
+        if (m3log_index_parse_time(line + 1, time_len, &time) == M3LOG_SUCCESS) {
+            if (input->timed && time < input->time) {
+                stats->disordered++;
+            }
+            input->time = time;
+            input->timed = 1;
+            return;
+        }
+    }
+    stats->untimed++;
+}
+
+/* 按 (时间, 输入序号) 比较，时间相同的日志按输入序号输出 */
+static int m3log_merge_less(const m3log_merge_input_t *inputs, size_t a, size_t b) {
+    return inputs[a].time < inputs[b].time || (inputs[a].time == inputs[b].time && a < b);
+}
+
+static void m3log_merge_sift_down(const m3log_merge_input_t *inputs, size_t *heap, size_t size, size_t pos) {
+    size_t item = heap[pos];
+    for (;;) {
+        size_t child = pos * 2 + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && m3log_merge_less(inputs, heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!m3log_merge_less(inputs, heap[child], item)) {
+            break;
+        }
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = item;
+}
@@ -0,0 +1,413 @@
+/**
+ * @file m3log_pool.c
+ * @brief m3log 日志条目对象池实现
+ */
+
+#include "../include/m3log_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* 尺寸等级 c 的块（头部 + 数据区）大小为 256 << c，最大等级即 M3LOG_POOL_MAX_POOLED */
+#define M3LOG_POOL_MIN_BLOCK 256u
+#define M3LOG_POOL_CLASSES 9
+#define M3LOG_POOL_OVERSIZE ((unsigned)-1)
+
+/* 每次向系统申请的内存块至少这么大，按所需等级切分为若干个块 */
+#define M3LOG_POOL_CHUNK_SIZE (64u << 10)
+#define M3LOG_POOL_CHUNK_BLOCKS 4
+
+/* 条目的头部，数据区紧随其后：标签指针数组，然后依次是时间戳、各标签与内容 */
+typedef struct m3log_pool_block {
+    struct m3log_pool_block *next; /* 空闲链表 */
+    unsigned size_class;           /* 尺寸等级，M3LOG_POOL_OVERSIZE 表示单独分配 */
+    size_t capacity;               /* 数据区字节数 */
+    m3log_entry_t entry;
+} m3log_pool_block_t;
+
+/* 向系统申请的内存块，池销毁时整体释放 */
+typedef struct m3log_pool_chunk {
+    struct m3log_pool_chunk *next;
+    size_t size;
+} m3log_pool_chunk_t;
+
+/* 线程缓存，经 pthread 线程私有数据与线程绑定 */
+typedef struct m3log_pool_cache {
+    m3log_pool_t *pool;
+    struct m3log_pool_cache *prev;
+    struct m3log_pool_cache *next;
+    m3log_pool_block_t *free[M3LOG_POOL_CLASSES];
+    size_t count[M3LOG_POOL_CLASSES];
+} m3log_pool_cache_t;
+
+struct m3log_pool {
+    pthread_key_t key;
+    size_t thread_cache;
+
+    pthread_mutex_t mutex;                           /* 保护以下字段 */
+    m3log_pool_block_t *free[M3LOG_POOL_CLASSES];    /* 共享空闲链表 */
+    size_t free_count[M3LOG_POOL_CLASSES];
+    m3log_pool_chunk_t *chunks;
+    m3log_pool_cache_t *caches;
+    size_t reserved_bytes;
+    size_t chunk_count;
+    size_t oversize;
+};
+
+_Static_assert(sizeof(m3log_pool_block_t) % sizeof(void *) == 0, "pool block data must be pointer aligned");
+_Static_assert(sizeof(m3log_pool_chunk_t) % sizeof(void *) == 0, "pool chunk data must be pointer aligned");
+
+/* 内部函数声明 */
+static m3log_pool_cache_t *m3log_pool_cache(m3log_pool_t *pool);
+static void m3log_pool_cache_exit(void *arg);
+static void m3log_pool_return_locked(m3log_pool_t *pool, m3log_pool_cache_t *cache, unsigned size_class,
+                                     size_t count);
+static int m3log_pool_refill(m3log_pool_t *pool, m3log_pool_cache_t *cache, unsigned size_class);
+static m3log_pool_block_t *m3log_pool_acquire(m3log_pool_t *pool, size_t need);
+static char *m3log_pool_copy(char **cursor, const char *str, size_t len);
+
+m3log_pool_t *m3log_pool_create(const m3log_pool_options_t *options) {
+    m3log_pool_t *pool = (m3log_pool_t *)calloc(1, sizeof(m3log_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    if (pthread_key_create(&pool->key, m3log_pool_cache_exit) != 0) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->thread_cache =
+        options && options->thread_cache ? options->thread_cache : M3LOG_POOL_DEFAULT_THREAD_CACHE;
+    return pool;
+}
+
+void m3log_pool_destroy(m3log_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+
+    /* 先删除线程私有数据键，之后退出的线程不再回调 m3log_pool_cache_exit */
+    pthread_key_delete(pool->key);
+
+    m3log_pool_cache_t *cache = pool->caches;
+    while (cache) {
+        m3log_pool_cache_t *next = cache->next;
+        free(cache);
+        cache = next;
+    }
+    m3log_pool_chunk_t *chunk = pool->chunks;
+    while (chunk) {
+        m3log_pool_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+m3log_error_t m3log_pool_parse(m3log_pool_t *pool, const char *line, size_t len, m3log_entry_t **entry) {
+    if (!pool || !line || !entry) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    *entry = NULL;
+
+    /* 与 m3log_parse 相同：先零拷贝解析，标签过多时借用栈上的临时 arena，放不下再改用堆上成倍增长的 arena */
+    m3log_slice_t overflow[64];
+    m3log_arena_t arena;
+    m3log_arena_init(&arena, overflow, sizeof(overflow));
+    char *heap = NULL;
+
+    m3log_view_t view;
+    m3log_error_t err = m3log_parse_view(line, len, &view, &arena);
+    while (err == M3LOG_ERROR_BUFFER_TOO_SMALL) {
+        size_t capacity = arena.capacity * 2;
+        char *base = (char *)realloc(heap, capacity);
+        if (!base) {
+            free(heap);
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        heap = base;
+        m3log_arena_init(&arena, heap, capacity);
+        err = m3log_parse_view(line, len, &view, &arena);
+    }
+    if (err != M3LOG_SUCCESS) {
+        free(heap);
+        return err;
+    }
+
+    size_t need = view.tag_count * sizeof(char *) + view.content.len + 1;
+    if (view.time.ptr) {
+        need += view.time.len + 1;
+    }
+    for (size_t i = 0; i < view.tag_count; i++) {
+        need += view.tags[i].len + 1;
+    }
+
+    m3log_pool_block_t *block = m3log_pool_acquire(pool, need);
+    if (!block) {
+        free(heap);
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    m3log_entry_t *result = &block->entry;
+    char *cursor = (char *)(block + 1);
+    result->tags.count = view.tag_count;
+    result->tags.tags = NULL;
+    if (view.tag_count > 0) {
+        result->tags.tags = (char **)cursor;
+        cursor += view.tag_count * sizeof(char *);
+    }
+    result->time = view.time.ptr ? m3log_pool_copy(&cursor, view.time.ptr, view.time.len) : NULL;
+    for (size_t i = 0; i < view.tag_count; i++) {
+        result->tags.tags[i] = m3log_pool_copy(&cursor, view.tags[i].ptr, view.tags[i].len);
+    }
+    result->level = view.level;
+    result->content = m3log_pool_copy(&cursor, view.content.ptr ? view.content.ptr : "", view.content.len);
+    free(heap);
+
+    *entry = result;
+    return M3LOG_SUCCESS;
+}
+
+m3log_entry_t *m3log_pool_create_entry(m3log_pool_t *pool, const char *content, m3log_level_t level,
+                                       const char **tags, size_t tag_count) {
+    if (!pool || !content || (!tags && tag_count > 0)) {
+        return NULL;
+    }
+
+    /* 时间戳格式与 m3log_create_entry 相同 */
+    char timestamp[32];
+    time_t now = time(NULL);
+    struct tm tm_info;
+    gmtime_r(&now, &tm_info);
+    size_t time_len = strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tm_info);
+
+    size_t content_len = strlen(content);
+    size_t need = tag_count * sizeof(char *) + time_len + 1 + content_len + 1;
+    for (size_t i = 0; i < tag_count; i++) {
+        need += (tags[i] ? strlen(tags[i]) : 0) + 1;
+    }
+
+    m3log_pool_block_t *block = m3log_pool_acquire(pool, need);
+    if (!block) {
+        return NULL;
+    }
+
+    m3log_entry_t *entry = &block->entry;
+    char *cursor = (char *)(block + 1);
+    entry->tags.count = tag_count;
+    entry->tags.tags = NULL;
+    if (tag_count > 0) {
+        entry->tags.tags = (char **)cursor;
+        cursor += tag_count * sizeof(char *);
+    }
+    entry->time = m3log_pool_copy(&cursor, timestamp, time_len);
+    for (size_t i = 0; i < tag_count; i++) {
+        const char *tag = tags[i] ? tags[i] : "";
+        entry->tags.tags[i] = m3log_pool_copy(&cursor, tag, strlen(tag));
+    }
+    entry->level = level;
+    entry->content = m3log_pool_copy(&cursor, content, content_len);
+    return entry;
+}
+
+void m3log_pool_release(m3log_pool_t *pool, m3log_entry_t *entry) {
+    if (!pool || !entry) {
+        return;
+    }
+
+    m3log_pool_block_t *block =
+        (m3log_pool_block_t *)((char *)entry - offsetof(m3log_pool_block_t, entry));
+    if (block->size_class == M3LOG_POOL_OVERSIZE) {
+        free(block);
+        return;
+    }
+
+    unsigned size_class = block->size_class;
+    m3log_pool_cache_t *cache = m3log_pool_cache(pool);
+    if (!cache) {
+        pthread_mutex_lock(&pool->mutex);
+        block->next = pool->free[size_class];
+        pool->free[size_class] = block;
+        pool->free_count[size_class]++;
+        pthread_mutex_unlock(&pool->mutex);
+        return;
+    }
+
+    block->next = cache->free[size_class];
+    cache->free[size_class] = block;
+    cache->count[size_class]++;
+
+    /* 只在生产、另一线程归还的场景下缓存会持续增长，超出上限时移交一半 */
+    if (cache->count[size_class] > pool->thread_cache) {
+        pthread_mutex_lock(&pool->mutex);
+        m3log_pool_return_locked(pool, cache, size_class, cache->count[size_class] / 2);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+void m3log_pool_stats(m3log_pool_t *pool, m3log_pool_stats_t *stats) {
+    if (!pool || !stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(m3log_pool_stats_t));
+    pthread_mutex_lock(&pool->mutex);
+    stats->reserved_bytes = pool->reserved_bytes;
+    stats->chunks = pool->chunk_count;
+    for (unsigned i = 0; i < M3LOG_POOL_CLASSES; i++) {
+        stats->shared_free += pool->free_count[i];
+    }
+    stats->oversize = pool->oversize;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/* 内部辅助函数实现 */
+
+/* 取得当前线程在该池上的缓存，首次使用时创建；内存不足时返回 NULL，调用方改走共享链表 */
+static m3log_pool_cache_t *m3log_pool_cache(m3log_pool_t *pool) {
+    m3log_pool_cache_t *cache = (m3log_pool_cache_t *)pthread_getspecific(pool->key);
+    if (cache) {
+        return cache;
+    }
+
+    cache = (m3log_pool_cache_t *)calloc(1, sizeof(m3log_pool_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+    cache->pool = pool;
+    if (pthread_setspecific(pool->key, cache) != 0) {
+        free(cache);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    cache->next = pool->caches;
+    if (pool->caches) {
+        pool->caches->prev = cache;
+    }
+    pool->caches = cache;
+    pthread_mutex_unlock(&pool->mutex);
+    return cache;
+}
+
+/* 线程退出：缓存中的空闲条目全部移交给共享链表 */
+static void m3log_pool_cache_exit(void *arg) {
+    m3log_pool_cache_t *cache = (m3log_pool_cache_t *)arg;
+    m3log_pool_t *pool = cache->pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (unsigned i = 0; i < M3LOG_POOL_CLASSES; i++) {
+        m3log_pool_return_locked(pool, cache, i, cache->count[i]);
+    }
+    if (cache->prev) {
+        cache->prev->next = cache->next;
+    } else {
+        pool->caches = cache->next;
+    }
+    if (cache->next) {
+        cache->next->prev = cache->prev;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    free(cache);
+}
+
+static void m3log_pool_return_locked(m3log_pool_t *pool, m3log_pool_cache_t *cache, unsigned size_class,
+                                     size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        m3log_pool_block_t *block = cache->free[size_class];
+        cache->free[size_class] = block->next;
+        block->next = pool->free[size_class];
+        pool->free[size_class] = block;
+    }
+    cache->count[size_class] -= count;
+    pool->free_count[size_class] += count;
+}
+
+/* 从共享链表取出一批（最多线程缓存上限的一半）放入线程缓存，共享链表为空时先向系统申请一个内存块 */
+static int m3log_pool_refill(m3log_pool_t *pool, m3log_pool_cache_t *cache, unsigned size_class) {
+    pthread_mutex_lock(&pool->mutex);
+    if (!pool->free[size_class]) {
+        size_t block_size = (size_t)M3LOG_POOL_MIN_BLOCK << size_class;
+        size_t data_size = block_size * M3LOG_POOL_CHUNK_BLOCKS;
+        if (data_size < M3LOG_POOL_CHUNK_SIZE) {
+            data_size = M3LOG_POOL_CHUNK_SIZE;
+        }
+        m3log_pool_chunk_t *chunk = (m3log_pool_chunk_t *)malloc(sizeof(m3log_pool_chunk_t) + data_size);
+        if (!chunk) {
+            pthread_mutex_unlock(&pool->mutex);
+            return 0;
+        }
+        chunk->size = sizeof(m3log_pool_chunk_t) + data_size;
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->reserved_bytes += chunk->size;
+        pool->chunk_count++;
+
+        char *base = (char *)(chunk + 1);
+        for (size_t offset = 0; offset + block_size <= data_size; offset += block_size) {
+            m3log_pool_block_t *block = (m3log_pool_block_t *)(base + offset);
+            block->size_class = size_class;
+            block->capacity = block_size - sizeof(m3log_pool_block_t);
+            block->next = pool->free[size_class];
+            pool->free[size_class] = block;
+            pool->free_count[size_class]++;
+        }
+    }
+
+    size_t batch = pool->thread_cache / 2 ? pool->thread_cache / 2 : 1;
+    while (batch-- > 0 && pool->free[size_class]) {
+        m3log_pool_block_t *block = pool->free[size_class];
+        pool->free[size_class] = block->next;
+        pool->free_count[size_class]--;
+        block->next = cache->free[size_class];
+        cache->free[size_class] = block;
+        cache->count[size_class]++;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return 1;
+}
+
+static m3log_pool_block_t *m3log_pool_acquire(m3log_pool_t *pool, size_t need) {
+    unsigned size_class = 0;
+    while (size_class < M3LOG_POOL_CLASSES &&
+           ((size_t)M3LOG_POOL_MIN_BLOCK << size_class) - sizeof(m3log_pool_block_t) < need) {
+        size_class++;
+    }
+
+    if (size_class == M3LOG_POOL_CLASSES) {
+        m3log_pool_block_t *block = (m3log_pool_block_t *)malloc(sizeof(m3log_pool_block_t) + need);
+        if (!block) {
+            return NULL;
+        }
+        block->size_class = M3LOG_POOL_OVERSIZE;
+        block->capacity = need;
+        pthread_mutex_lock(&pool->mutex);
+        pool->oversize++;
+        pthread_mutex_unlock(&pool->mutex);
+        return block;
+    }
+
+    m3log_pool_cache_t *cache = m3log_pool_cache(pool);
+    if (!cache) {
+        return NULL;
+    }
+    if (!cache->free[size_class] && !m3log_pool_refill(pool, cache, size_class)) {
+        return NULL;
+    }
+
+    m3log_pool_block_t *block = cache->free[size_class];
+    cache->free[size_class] = block->next;
+    cache->count[size_class]--;
+    return block;
+}
+
+static char *m3log_pool_copy(char **cursor, const char *str, size_t len) {
+    char *copy = *cursor;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    *cursor += len + 1;
+    return copy;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file m3log_simd.c
+ * @brief m3log 字节扫描与换行转义内核实现
+ */
+
+#include "../include/m3log_simd.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define M3LOG_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/* 内核函数表 */
+typedef struct {
+    const char *(*find_byte)(const char *data, size_t len, char c);
+    size_t (*count_byte)(const char *data, size_t len, char c);
+    const char *name;
+} m3log_simd_ops_t;
+
+/* 标量实现 */
+
+static const char *scalar_find_byte(const char *data, size_t len, char c) {
+    return (const char *)memchr(data, c, len);
+}
+
+static size_t scalar_count_byte(const char *data, size_t len, char c) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        count += (data[i] == c);
+    }
+    return count;
+}
+
+static const m3log_simd_ops_t g_scalar_ops = {scalar_find_byte, scalar_count_byte, "scalar"};
+
+#ifdef M3LOG_SIMD_X86
+
+/*
+ * 向量内核要求 len >= M3LOG_SIMD_MIN_LEN（由调用方保证，短输入直接走标量路径，
+ * 同时避免短输入也触发 256 位寄存器的状态切换）。
+ * 长度不足整块时，用一次与前面重叠的末尾加载处理剩余字节，所有读取都不越界
+ */
+#define M3LOG_SIMD_MIN_LEN 32
+
+/* SSE2 实现：每次处理 16 字节 */
+
+__attribute__((target("sse2"))) static const char *sse2_find_byte(const char *data, size_t len, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask) {
+            return data + i + __builtin_ctz((unsigned)mask);
+        }
+    }
+    if (i < len) {
+        i = len - 16;
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), needle));
+        if (mask) {
+            return data + i + __builtin_ctz((unsigned)mask);
+        }
+    }
+    return NULL;
+}
+
+__attribute__((target("sse2"))) static size_t sse2_count_byte(const char *data, size_t len, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        count += (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+    }
+    if (i < len) {
+        /* 末尾重叠加载，丢弃已统计过的低位 */
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + len - 16)), needle));
+        count += (size_t)__builtin_popcount(mask >> (16 - (len - i)));
+    }
+    return count;
+}
+
+static const m3log_simd_ops_t g_sse2_ops = {sse2_find_byte, sse2_count_byte, "sse2"};
+
+/* AVX2 实现：主循环每次处理 64 字节 */
+
+__attribute__((target("avx2"))) static const char *avx2_find_byte(const char *data, size_t len, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), needle);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i + 32)), needle);
+        __m256i any = _mm256_or_si256(a, b);
+        if (!_mm256_testz_si256(any, any)) {
+            uint64_t mask = (uint32_t)_mm256_movemask_epi8(a) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(b) << 32);
+            return data + i + __builtin_ctzll(mask);
+        }
+    }
+    for (; i + 32 <= len; i += 32) {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), needle));
+        if (mask) {
+            return data + i + __builtin_ctz(mask);
+        }
+    }
+    if (i < len) {
+        i = len - 32;
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), needle));
+        if (mask) {
+            return data + i + __builtin_ctz(mask);
+        }
+    }
+    return NULL;
+}
+
+__attribute__((target("avx2"))) static size_t avx2_count_byte(const char *data, size_t len, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+        count += (size_t)__builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    }
+    if (i < len) {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + len - 32)), needle));
+        count += (size_t)__builtin_popcount(mask >> (32 - (len - i)));
+    }
+    return count;
+}
+
+static const m3log_simd_ops_t g_avx2_ops = {avx2_find_byte, avx2_count_byte, "avx2"};
+
+#else
+#define M3LOG_SIMD_MIN_LEN 0
+#endif /* M3LOG_SIMD_X86 */
+
+/* 运行时选择内核，可通过环境变量 M3LOG_SIMD=scalar|sse2|avx2 降级（用于基准对比） */
+static const m3log_simd_ops_t *m3log_simd_resolve(void) {
+    const char *forced = getenv("M3LOG_SIMD");
+
+    if (forced && strcmp(forced, "scalar") == 0) {
+        return &g_scalar_ops;
+    }
+
+#ifdef M3LOG_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && !(forced && strcmp(forced, "sse2") == 0)) {
+        return &g_avx2_ops;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return &g_sse2_ops;
+    }
+#endif
+
+    return &g_scalar_ops;
+}
+
+static const m3log_simd_ops_t *g_ops = NULL;
+
+static const m3log_simd_ops_t *m3log_simd_ops(void) {
+#if defined(__GNUC__)
+    const m3log_simd_ops_t *ops = __atomic_load_n(&g_ops, __ATOMIC_ACQUIRE);
+    if (!ops) {
+        ops = m3log_simd_resolve();
+        __atomic_store_n(&g_ops, ops, __ATOMIC_RELEASE);
+    }
+    return ops;
+#else
+    if (!g_ops) {
+        g_ops = m3log_simd_resolve();
+    }
+    return g_ops;
+#endif
+}
+
+static const char *m3log_simd_find_byte(const m3log_simd_ops_t *ops, const char *data, size_t len, char c) {
+    return len < M3LOG_SIMD_MIN_LEN ? scalar_find_byte(data, len, c) : ops->find_byte(data, len, c);
+}
+
+const char *m3log_find_newline(const char *data, size_t len) {
+    if (!data || len == 0) {
+        return NULL;
+    }
+    return m3log_simd_find_byte(m3log_simd_ops(), data, len, '\n');
+}
+
+size_t m3log_count_newlines(const char *data, size_t len) {
+    if (!data || len == 0) {
+        return 0;
+    }
+    if (len < M3LOG_SIMD_MIN_LEN) {
+        return scalar_count_byte(data, len, '\n');
+    }
+    return m3log_simd_ops()->count_byte(data, len, '\n');
+}
+
+size_t m3log_escape_newlines(const char *src, size_t len, char *dst) {
+    const m3log_simd_ops_t *ops = m3log_simd_ops();
+    size_t written = 0;
+    size_t start = 0;
+
+    while (start < len) {
+        const char *hit = m3log_simd_find_byte(ops, src + start, len - start, '\n');
+        size_t end = hit ? (size_t)(hit - src) : len;
+
+        memcpy(dst + written, src + start, end - start);
+        written += end - start;
+        if (!hit) {
+            break;
+        }
+
+        dst[written++] = '\\';
+        dst[written++] = 'n';
+        start = end + 1;
+    }
+
+    return written;
+}
+
+size_t m3log_unescape_newlines(const char *src, size_t len, char *dst) {
+    const m3log_simd_ops_t *ops = m3log_simd_ops();
+    size_t written = 0;
+    size_t start = 0;
+
+    while (start < len) {
+        const char *hit = m3log_simd_find_byte(ops, src + start, len - start, '\\');
+        size_t end = hit ? (size_t)(hit - src) : len;
+
+        memmove(dst + written, src + start, end - start);
+        written += end - start;
+        if (!hit) {
+            break;
+        }
+
+        if (end + 1 < len && src[end + 1] == 'n') {
+            dst[written++] = '\n';
+            start = end + 2;
+        } else {
+            dst[written++] = '\\';
+            start = end + 1;
+        }
+    }
+
+    return written;
+}
+
+const char *m3log_simd_name(void) {
+    return m3log_simd_ops()->name;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file m3log_stream.c
+ * @brief m3log 流式增量解析实现
+ */
+
+#include "../include/m3log_stream.h"
+#include "../include/m3log_simd.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define M3LOG_STREAM_INITIAL_ARENA 1024
+
+/*
+ * 暂存区 buf[0, pending) 保存当前逻辑行已收到的部分：已拼接的续行（断开处为转义 "\n"）
+ * 加上当前物理行的原始字节（可能以 '\r' 结尾）。容量为 max_line + 2，
+ * 多出的两个字节留给行尾的 '\r' 与续行插入的 'n'，保证 m3log_stream_buffer 总有可写空间。
+ */
+struct m3log_stream {
+    m3log_stream_callback_t callback;
+    void *user_data;
+    size_t max_line;
+
+    char *buf;
+    size_t capacity;
+    size_t pending;       /* 暂存的字节数 */
+    int continued;        /* 暂存内容以续行的 '\' 结尾，下一物理行到来时补上 'n' */
+    int discarding;       /* 当前逻辑行超长，丢弃到它结束为止 */
+    char tail[2];         /* 丢弃时当前物理行的最后两个字节，用于识别续行 */
+    uint64_t line_offset; /* 暂存行在输入流中的起始偏移 */
+    int stopped;
+
+    m3log_arena_t arena;
+    m3log_stream_stats_t stats;
+};
+
+/* 内部函数声明 */
+static m3log_error_t m3log_stream_process(m3log_stream_t *stream, const char *data, size_t len);
+static void m3log_stream_append(m3log_stream_t *stream, const char *src, size_t len);
+static m3log_error_t m3log_stream_end_line(m3log_stream_t *stream);
+static m3log_error_t m3log_stream_emit(m3log_stream_t *stream, const char *line, size_t len, uint64_t offset);
+static void m3log_stream_discard(m3log_stream_t *stream);
+static void m3log_stream_remember(m3log_stream_t *stream, const char *src, size_t len);
+
+m3log_error_t m3log_stream_create(const m3log_stream_options_t *options, m3log_stream_callback_t callback,
+                                  void *user_data, m3log_stream_t **stream) {
+    if (!callback || !stream) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    *stream = NULL;
+
+    size_t max_line = options && options->max_line ? options->max_line : M3LOG_STREAM_DEFAULT_MAX_LINE;
+    if (max_line > SIZE_MAX - 2) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    m3log_stream_t *result = (m3log_stream_t *)calloc(1, sizeof(m3log_stream_t));
+    if (!result) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+    result->callback = callback;
+    result->user_data = user_data;
+    result->max_line = max_line;
+    result->capacity = max_line + 2;
+    result->buf = (char *)malloc(result->capacity);
+    m3log_arena_init(&result->arena, malloc(M3LOG_STREAM_INITIAL_ARENA), M3LOG_STREAM_INITIAL_ARENA);
+    if (!result->buf || !result->arena.base) {
+        m3log_stream_destroy(result);
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    *stream = result;
+    return M3LOG_SUCCESS;
+}
+
+void m3log_stream_destroy(m3log_stream_t *stream) {
+    if (!stream) {
+        return;
+    }
+    free(stream->arena.base);
+    free(stream->buf);
+    free(stream);
+}
+
+m3log_error_t m3log_stream_feed(m3log_stream_t *stream, const char *data, size_t len) {
+    if (!stream || (!data && len > 0)) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    return m3log_stream_process(stream, data, len);
+}
+
+char *m3log_stream_buffer(m3log_stream_t *stream, size_t *capacity) {
+    /* 续行待补的 'n' 占用 buf[pending]，新数据从其后开始写入 */
+    size_t used = stream->pending + (stream->continued ? 1 : 0);
+    *capacity = stream->capacity - used;
+    return stream->buf + used;
+}
+
+m3log_error_t m3log_stream_commit(m3log_stream_t *stream, size_t len) {
+    size_t capacity;
+    char *data = m3log_stream_buffer(stream, &capacity);
+    if (len > capacity) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+    return m3log_stream_process(stream, data, len);
+}
+
+m3log_error_t m3log_stream_finish(m3log_stream_t *stream) {
+    if (stream->stopped) {
+        return M3LOG_ERROR_ABORTED;
+    }
+
+    m3log_error_t err = M3LOG_SUCCESS;
+    if (!stream->discarding && (stream->pending > 0 || stream->continued)) {
+        size_t len = stream->pending;
+        if (stream->continued) {
+            /* 最后一行以续行结尾但之后没有内容：去掉悬空的 '\' */
+            len--;
+        } else if (stream->buf[len - 1] == '\r') {
+            len--;
+        }
+        if (len > stream->max_line) {
+            stream->stats.oversize++;
+        } else {
+            stream->stats.carried++;
+            err = m3log_stream_emit(stream, stream->buf, len, stream->line_offset);
+        }
+    }
+    stream->pending = 0;
+    stream->continued = 0;
+    stream->discarding = 0;
+    return err;
+}
+
+void m3log_stream_reset(m3log_stream_t *stream) {
+    stream->pending = 0;
+    stream->continued = 0;
+    stream->discarding = 0;
+    stream->stopped = 0;
+    memset(&stream->stats, 0, sizeof(stream->stats));
+}
+
+void m3log_stream_stats(const m3log_stream_t *stream, m3log_stream_stats_t *stats) {
+    *stats = stream->stats;
+}
+
+/* 内部辅助函数实现 */
+
+static m3log_error_t m3log_stream_process(m3log_stream_t *stream, const char *data, size_t len) {
+    if (stream->stopped) {
+        return M3LOG_ERROR_ABORTED;
+    }
+
+    uint64_t base = stream->stats.bytes;
+    stream->stats.bytes += len;
+
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end) {
+        const char *newline = m3log_find_newline(p, (size_t)(end - p));
+        const char *line_end = newline ? newline : end;
+        size_t segment = (size_t)(line_end - p);
+
+        if (!stream->pending && !stream->continued && !stream->discarding) {
+            /* 快速路径：完整且不带续行的行直接在输入上解析 */
+            if (newline) {
+                size_t line_len = segment;
+                if (line_len > 0 && p[line_len - 1] == '\r') {
+                    line_len--;
+                }
+                if (line_len == 0 || p[line_len - 1] != '\\') {
+                    if (line_len > stream->max_line) {
+                        stream->stats.oversize++;
+                    } else {
+                        m3log_error_t err = m3log_stream_emit(stream, p, line_len, base + (uint64_t)(p - data));
+                        if (err != M3LOG_SUCCESS) {
+                            return err;
+                        }
+                    }
+                    p = newline + 1;
+                    continue;
+                }
+            }
+            stream->line_offset = base + (uint64_t)(p - data);
+        }
+
+        m3log_stream_append(stream, p, segment);
+        if (!newline) {
+            break;
+        }
+        m3log_error_t err = m3log_stream_end_line(stream);
+        if (err != M3LOG_SUCCESS) {
+            return err;
+        }
+        p = newline + 1;
+    }
+    return M3LOG_SUCCESS;
+}
+
+/* 把当前物理行的一段追加到暂存区；src 可能指向暂存区内部（commit 路径），此时位置不变或前移 */
+static void m3log_stream_append(m3log_stream_t *stream, const char *src, size_t len) {
+    if (stream->continued) {
+        stream->continued = 0;
+        stream->buf[stream->pending++] = 'n';
+    }
+    if (!stream->discarding && stream->pending + len > stream->max_line + 1) {
+        size_t kept = stream->pending;
+        m3log_stream_discard(stream);
+        m3log_stream_remember(stream, stream->buf, kept);
+    }
+    if (stream->discarding) {
+        m3log_stream_remember(stream, src, len);
+        return;
+    }
+    if (src != stream->buf + stream->pending) {
+        memmove(stream->buf + stream->pending, src, len);
+    }
+    stream->pending += len;
+}
+
+/* 暂存的物理行遇到换行：行尾为 '\' 时等待续行，否则交付整条逻辑行 */
+static m3log_error_t m3log_stream_end_line(m3log_stream_t *stream) {
+    if (stream->discarding) {
+        int more = stream->tail[1] == '\\' || (stream->tail[1] == '\r' && stream->tail[0] == '\\');
+        stream->tail[0] = stream->tail[1] = 0;
+        if (more) {
+            stream->stats.continued++;
+        } else {
+            stream->discarding = 0;
+        }
+        return M3LOG_SUCCESS;
+    }
+
+    size_t len = stream->pending;
+    if (len > 0 && stream->buf[len - 1] == '\r') {
+        len--;
+    }
+    if (len > 0 && stream->buf[len - 1] == '\\') {
+        stream->pending = len;
+        stream->stats.continued++;
+        if (len + 1 > stream->max_line) {
+            /* 补上 'n' 后必然超长，余下的续行一并丢弃 */
+            m3log_stream_discard(stream);
+        } else {
+            stream->continued = 1;
+        }
+        return M3LOG_SUCCESS;
+    }
+
+    stream->pending = 0;
+    if (len > stream->max_line) {
+        stream->stats.oversize++;
+        return M3LOG_SUCCESS;
+    }
+    stream->stats.carried++;
+    return m3log_stream_emit(stream, stream->buf, len, stream->line_offset);
+}
+
+static m3log_error_t m3log_stream_emit(m3log_stream_t *stream, const char *line, size_t len, uint64_t offset) {
+    /* 空行被忽略 */
+    if (len == 0) {
+        return M3LOG_SUCCESS;
+    }
+
+    m3log_view_t view;
+    m3log_arena_reset(&stream->arena);
+    m3log_error_t err = m3log_parse_view(line, len, &view, &stream->arena);
+    while (err == M3LOG_ERROR_BUFFER_TOO_SMALL) {
+        /* 标签数量受 max_line 限制，arena 只会增长到有限大小 */
+        size_t capacity = stream->arena.capacity * 2;
+        char *base = (char *)realloc(stream->arena.base, capacity);
+        if (!base) {
+            return M3LOG_ERROR_MEMORY_ALLOCATION;
+        }
+        m3log_arena_init(&stream->arena, base, capacity);
+        err = m3log_parse_view(line, len, &view, &stream->arena);
+    }
+    if (err != M3LOG_SUCCESS) {
+        stream->stats.invalid++;
+        return M3LOG_SUCCESS;
+    }
+
+    stream->stats.entries++;
+    if (stream->callback(&view, line, len, offset, stream->user_data) != 0) {
+        stream->stopped = 1;
+        return M3LOG_ERROR_ABORTED;
+    }
+    return M3LOG_SUCCESS;
+}
+
+static void m3log_stream_discard(m3log_stream_t *stream) {
+    stream->stats.oversize++;
+    stream->pending = 0;
+    stream->continued = 0;
+    stream->discarding = 1;
+    stream->tail[0] = stream->tail[1] = 0;
+}
+
+static void m3log_stream_remember(m3log_stream_t *stream, const char *src, size_t len) {
+    if (len >= 2) {
+        stream->tail[0] = src[len - 2];
+        stream->tail[1] = src[len - 1];
+    } else if (len == 1) {
+        stream->tail[0] = stream->tail[1];
+        stream->tail[1] = src[0];
+    }
+}
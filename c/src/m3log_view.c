@@ -0,0 +1,251 @@
+/**
+ * @file m3log_view.c
+ * @brief m3log 零拷贝解析与 arena 分配器实现
+ */
+
+#include "../include/m3log.h"
+#include <stdint.h>
+#include <string.h>
+
+/* 内部函数声明 */
+static int m3log_is_space(char c);
+static m3log_slice_t m3log_slice_trim(const char *start, const char *end);
+static m3log_level_t m3log_level_from_slice(m3log_slice_t slice);
+static m3log_error_t m3log_split_tags(m3log_slice_t text, m3log_view_t *view, m3log_arena_t *arena);
+static const char *m3log_find_byte(const char *start, const char *end, char c);
+
+void m3log_arena_init(m3log_arena_t *arena, void *buffer, size_t capacity) {
+    if (!arena) {
+        return;
+    }
+
+    arena->base = (char *)buffer;
+    arena->capacity = buffer ? capacity : 0;
+    arena->used = 0;
+}
+
+void m3log_arena_reset(m3log_arena_t *arena) {
+    if (arena) {
+        arena->used = 0;
+    }
+}
+
+void *m3log_arena_alloc(m3log_arena_t *arena, size_t size, size_t align) {
+    if (!arena || !arena->base) {
+        return NULL;
+    }
+    if (align == 0) {
+        align = 1;
+    }
+
+    uintptr_t current = (uintptr_t)(arena->base + arena->used);
+    size_t padding = (size_t)((align - (current & (align - 1))) & (align - 1));
+
+    if (padding > arena->capacity - arena->used || size > arena->capacity - arena->used - padding) {
+        return NULL;
+    }
+
+    void *result = arena->base + arena->used + padding;
+    arena->used += padding + size;
+    return result;
+}
+
+m3log_error_t m3log_parse_view(const char *line, size_t len, m3log_view_t *view, m3log_arena_t *arena) {
+    if (!line || !view) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    memset(view, 0, sizeof(m3log_view_t));
+    view->tags = view->inline_tags;
+    view->level = M3LOG_LEVEL_UNKNOWN;
+
+    const char *p = line;
+    const char *end = line + len;
+
+    /* 时间戳部分 (@2023-04-01T15:30:45Z) */
+    if (len > 0 && line[0] == '@') {
+        const char *time_end = m3log_find_byte(line + 1, end, ' ');
+        if (!time_end) {
+            return M3LOG_ERROR_INVALID_FORMAT;
+        }
+        view->time.ptr = line + 1;
+        view->time.len = (size_t)(time_end - line - 1);
+        p = time_end + 1;
+    }
+
+    /*
+     * 标签与级别都位于第一个冒号之前（标签内部的冒号除外）。规范格式中 '[' 紧跟时间戳、'#' 紧跟 ']' 之后的空白，
+     * 先直接检查这两个位置；不符合时才定位冒号，并只在这段头部中查找 '[' 与 '#'（'#' 在 '[' 之前时没有标签）
+     */
+    const char *colon = NULL;
+    const char *hash = NULL;
+    const char *open = p < end && *p == '[' ? p : NULL;
+    if (!open) {
+        colon = m3log_find_byte(p, end, ':');
+        const char *head_end = colon ? colon : end;
+        open = m3log_find_byte(p, head_end, '[');
+        hash = m3log_find_byte(p, open ? open : head_end, '#');
+    }
+
+    /* 标签部分 ([标签1 标签2 ...]) */
+    if (open && !hash) {
+        const char *tags_end = m3log_find_byte(open, end, ']');
+        if (!tags_end) {
+            return M3LOG_ERROR_INVALID_FORMAT;
+        }
+
+        view->tags_text.ptr = open + 1;
+        view->tags_text.len = (size_t)(tags_end - open - 1);
+        m3log_error_t err = m3log_split_tags(view->tags_text, view, arena);
+        if (err != M3LOG_SUCCESS) {
+            return err;
+        }
+        p = tags_end + 1;
+
+        const char *q = p;
+        while (q < end && m3log_is_space(*q)) {
+            q++;
+        }
+        if (q < end && *q == '#') {
+            /* ']' 与 '#' 之间只有空白，冒号在 '#' 之后 */
+            hash = q;
+            colon = m3log_find_byte(q, end, ':');
+        } else {
+            /* 尚未定位冒号，或冒号位于标签内部时重新定位 */
+            if (!colon || colon < tags_end) {
+                colon = m3log_find_byte(p, end, ':');
+            }
+            hash = m3log_find_byte(p, colon ? colon : end, '#');
+        }
+    }
+
+    /* 级别部分 (#INFO) */
+    if (hash) {
+        if (!colon) {
+            return M3LOG_ERROR_INVALID_FORMAT;
+        }
+        view->level = m3log_level_from_slice(m3log_slice_trim(hash + 1, colon));
+        p = colon + 1;
+    } else if (colon) {
+        /* 没有级别时，冒号直接分隔内容 */
+        p = colon + 1;
+    }
+
+    /* 内容部分 */
+    view->content = m3log_slice_trim(p, end);
+    return M3LOG_SUCCESS;
+}
+
+m3log_error_t m3log_view_copy(const m3log_view_t *src, m3log_arena_t *arena, m3log_view_t *dst) {
+    if (!src || !arena || !dst) {
+        return M3LOG_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* 先复制到局部变量，允许 src 与 dst 相同 */
+    m3log_view_t copy = *src;
+    size_t total = src->time.len + src->tags_text.len + src->content.len;
+    char *text = (char *)m3log_arena_alloc(arena, total ? total : 1, 1);
+    m3log_slice_t *tags = (m3log_slice_t *)m3log_arena_alloc(
+        arena, sizeof(m3log_slice_t) * (src->tag_count ? src->tag_count : 1), sizeof(void *));
+    if (!text || !tags) {
+        return M3LOG_ERROR_MEMORY_ALLOCATION;
+    }
+
+    /* 时间、标签文本与内容连续存放，标签切片重新指向复制后的标签文本 */
+    char *cursor = text;
+    memcpy(cursor, src->time.ptr ? src->time.ptr : "", src->time.len);
+    copy.time.ptr = src->time.len ? cursor : NULL;
+    cursor += src->time.len;
+
+    memcpy(cursor, src->tags_text.ptr ? src->tags_text.ptr : "", src->tags_text.len);
+    for (size_t i = 0; i < src->tag_count; i++) {
+        tags[i].ptr = cursor + (src->tags[i].ptr - src->tags_text.ptr);
+        tags[i].len = src->tags[i].len;
+    }
+    copy.tags_text.ptr = src->tags_text.len ? cursor : NULL;
+    cursor += src->tags_text.len;
+
+    memcpy(cursor, src->content.ptr ? src->content.ptr : "", src->content.len);
+    copy.content.ptr = src->content.len ? cursor : NULL;
+
+    copy.tags = tags;
+    *dst = copy;
+    return M3LOG_SUCCESS;
+}
+
+/* 内部辅助函数实现 */
+
+static int m3log_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static m3log_slice_t m3log_slice_trim(const char *start, const char *end) {
+    m3log_slice_t result;
+
+    while (start < end && m3log_is_space(*start)) {
+        start++;
+    }
+    while (end > start && m3log_is_space(*(end - 1))) {
+        end--;
+    }
+
+    result.ptr = start;
+    result.len = (size_t)(end - start);
+    return result;
+}
+
+static m3log_level_t m3log_level_from_slice(m3log_slice_t slice) {
+    static const char *const names[] = {"DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strlen(names[i]) == slice.len && memcmp(names[i], slice.ptr, slice.len) == 0) {
+            return (m3log_level_t)i;
+        }
+    }
+    return M3LOG_LEVEL_UNKNOWN;
+}
+
+static const char *m3log_find_byte(const char *start, const char *end, char c) {
+    /* 头部的每个分隔符通常就在几到几十字节之外：直接用 C 库已向量化的 memchr，不经过内核分派 */
+    return start < end ? (const char *)memchr(start, c, (size_t)(end - start)) : NULL;
+}
+
+static m3log_error_t m3log_split_tags(m3log_slice_t text, m3log_view_t *view, m3log_arena_t *arena) {
+    const char *p = text.ptr;
+    const char *end = text.ptr + text.len;
+    size_t capacity = M3LOG_VIEW_INLINE_TAGS;
+
+    view->tag_count = 0;
+    while (p < end) {
+        /* 跳过连续的空白 */
+        while (p < end && m3log_is_space(*p)) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+
+        const char *start = p;
+        while (p < end && !m3log_is_space(*p)) {
+            p++;
+        }
+
+        /* 内联数组已满时转移到 arena，容量按倍数增长 */
+        if (view->tag_count == capacity) {
+            m3log_slice_t *grown =
+                (m3log_slice_t *)m3log_arena_alloc(arena, sizeof(m3log_slice_t) * capacity * 2, sizeof(void *));
+            if (!grown) {
+                return M3LOG_ERROR_BUFFER_TOO_SMALL;
+            }
+            memcpy(grown, view->tags, sizeof(m3log_slice_t) * view->tag_count);
+            view->tags = grown;
+            capacity *= 2;
+        }
+
+        view->tags[view->tag_count].ptr = start;
+        view->tags[view->tag_count].len = (size_t)(p - start);
+        view->tag_count++;
+    }
+
+    return M3LOG_SUCCESS;
+}
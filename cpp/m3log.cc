@@ -1,15 +1,216 @@
 #include "m3log.hh"
-#include <iomanip>
-#include <sstream>
+#include "../c/include/m3log_simd.h"
 #include <algorithm>
-#include <regex>
+#include <array>
 
 namespace m3log {
 
-Logger::Logger() : consoleOutput_(true) {}
+namespace {
+
+// 每个线程复用的格式化缓冲区，容量增长后不再释放
+std::string& threadBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+// 已渲染好的标签前缀文本（"[a b] " 或空串）
+struct RenderedTags {
+    std::string_view text;
+};
+
+// 带类型参数的消息：格式串与编码后的参数，需要文本时才渲染
+struct FormatArgs {
+    std::string_view format;
+    std::string_view args;
+    mutable std::string_view text;  // 调用线程已渲染的结果，同一条日志只渲染一次
+};
+
+std::string_view messageText(std::string_view message) {
+    return message;
+}
+
+std::string_view messageText(const FormatArgs& message) {
+    if (message.text.data() == nullptr) {
+        thread_local std::string text;
+        text.clear();
+        binary::renderArgs(text, message.format, message.args);
+        message.text = text;
+    }
+    return message.text;
+}
+
+void appendTags(std::string& out, TagSet tags) {
+    out.append(tags.prefix());
+}
+
+void appendTags(std::string& out, RenderedTags tags) {
+    out.append(tags.text);
+}
+
+// 渲染标签数组为 "[a b] "，空数组不输出
+template <typename Range>
+void appendTags(std::string& out, const Range& tags) {
+    if (tags.size() == 0) {
+        return;
+    }
+    out.push_back('[');
+    bool first = true;
+    for (const auto& tag : tags) {
+        if (!first) {
+            out.push_back(' ');
+        }
+        out.append(tag);
+        first = false;
+    }
+    out.append("] ", 2);
+}
+
+// 共享对象的读取槽位（危险指针）：每个线程对每类对象一个槽位，记录该线程最近读取的对象，
+// 被替换下来的对象只在没有任何槽位指向它时释放
+enum ReaderSlot {
+    kLevelSlot,     // 标签级别表
+    kSinkSlot,      // sink 列表
+    kRateSlot,      // 限流规则表
+    kLimitSlot,     // 调用点限流器
+    kRecorderSlot,  // 飞行记录器
+    kShardSlot,     // 分片输出集合
+    kReaderSlotCount
+};
+
+using ReaderSlots = std::array<std::atomic<const void*>, kReaderSlotCount>;
+
+// 所有线程的槽位：只增不减，线程退出时清空后归还，由之后的线程复用。
+// 有意不释放：线程可能在静态对象析构之后才退出
+struct Readers {
+    std::mutex mutex;
+    std::vector<ReaderSlots*> all;
+    std::vector<ReaderSlots*> free;
+};
+
+Readers& readers() {
+    static Readers* instance = new Readers;
+    return *instance;
+}
+
+// 本线程的槽位；线程局部对象析构之后再读取时改用一组不归还的槽位
+thread_local ReaderSlots* threadSlots = nullptr;
+thread_local bool threadExited = false;
+
+// 线程退出时清空并归还槽位
+struct ReaderSlotsOwner {
+    ~ReaderSlotsOwner() {
+        for (auto& slot : *threadSlots) {
+            slot.store(nullptr, std::memory_order_release);
+        }
+        Readers& all = readers();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        all.free.push_back(threadSlots);
+        threadSlots = nullptr;
+        threadExited = true;
+    }
+};
+
+[[gnu::noinline]] ReaderSlots* acquireReaderSlots() {
+    {
+        Readers& all = readers();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        if (!all.free.empty() && !threadExited) {
+            threadSlots = all.free.back();
+            all.free.pop_back();
+        } else {
+            threadSlots = new ReaderSlots{};
+            all.all.push_back(threadSlots);
+        }
+    }
+    if (!threadExited) {
+        thread_local ReaderSlotsOwner owner;
+    }
+    return threadSlots;
+}
+
+std::atomic<const void*>& readerSlot(ReaderSlot index) {
+    ReaderSlots* slots = threadSlots;
+    if (!slots) [[unlikely]] {
+        slots = acquireReaderSlots();
+    }
+    return (*slots)[index];
+}
+
+// 读取 source 当前指向的对象：先在本线程的槽位中登记，再确认它仍是当前对象，之后替换方不会释放它。
+// 槽位一直保留到下一次读到不同的对象，对象未被替换时只需一次比较
+template <typename T>
+T* protect(const std::atomic<T*>& source, ReaderSlot index) {
+    T* current = source.load(std::memory_order_seq_cst);
+    if (!current) {
+        return nullptr;
+    }
+    std::atomic<const void*>& slot = readerSlot(index);
+    while (slot.load(std::memory_order_relaxed) != current) {
+        slot.store(current, std::memory_order_seq_cst);
+        T* again = source.load(std::memory_order_seq_cst);
+        if (again == current) {
+            break;
+        }
+        if (!again) {
+            return nullptr;
+        }
+        current = again;
+    }
+    return current;
+}
+
+// 各线程槽位中登记的对象（调用方已发布替换它们的新对象）
+std::vector<const void*> readingObjects(ReaderSlot index) {
+    std::vector<const void*> reading;
+    Readers& all = readers();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    for (const ReaderSlots* slots : all.all) {
+        reading.push_back((*slots)[index].load(std::memory_order_seq_cst));
+    }
+    return reading;
+}
+
+// 释放已没有槽位指向的旧对象；其余的留到下一次替换时再检查，数量不超过读取线程数
+template <typename Pointer>
+void reclaimRetired(std::vector<Pointer>& retired, ReaderSlot index) {
+    if (retired.empty()) {
+        return;
+    }
+    std::vector<const void*> reading = readingObjects(index);
+    std::erase_if(retired, [&](const Pointer& object) {
+        return std::find(reading.begin(), reading.end(), object.get()) == reading.end();
+    });
+}
+
+} // namespace
+
+Logger::Logger() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    consoleSink_ = addSinkLocked(std::make_shared<ConsoleSink>(flushPolicy_), SinkOptions());
+}
 
 Logger::~Logger() {
-    closeOutputFile();
+    stopWatchingLevelConfig();
+
+    // 关闭前输出限流汇总并排空异步队列，保证已提交的日志不会丢失
+    reportAllSuppressed();
+    stopWriter();
+    closeBinaryOutput();
+
+    // 各 sink 的写线程在 SinkWorker 析构时排空队列并刷新
+    std::lock_guard<std::mutex> lock(mutex_);
+    recorder_.store(nullptr, std::memory_order_release);
+    dedup_.store(nullptr, std::memory_order_release);
+    for (const auto& table : dedupTables_) {
+        sweepDedup(*table, true);
+    }
+    sinks_.store(nullptr, std::memory_order_release);
+    retiredSinkLists_.clear();
+    sinkList_.reset();
+    shards_.store(nullptr, std::memory_order_release);
+    if (shardSet_) {
+        shardSet_->close();
+    }
 }
 
 Logger& Logger::instance() {
@@ -17,42 +218,639 @@ Logger& Logger::instance() {
     return instance;
 }
 
-void Logger::setOutputFile(const std::string& filename) {
+SinkId Logger::addSink(std::shared_ptr<Sink> sink, const SinkOptions& options) {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (outputFile_.is_open()) {
-        outputFile_.close();
+    return addSinkLocked(std::move(sink), options);
+}
+
+bool Logger::removeSink(SinkId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return removeSinkLocked(id);
+}
+
+bool Logger::setSinkLevel(SinkId id, LogLevel level) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const SinkList* sinks = sinks_.load(std::memory_order_acquire);
+    if (sinks) {
+        for (const SinkEntry& entry : *sinks) {
+            if (entry.id == id) {
+                entry.worker->setMinLevel(level);
+                return true;
+            }
+        }
     }
-    outputFile_.open(filename, std::ios::app);
-    if (!outputFile_.is_open()) {
+    return false;
+}
+
+SinkId Logger::addSinkLocked(std::shared_ptr<Sink> sink, const SinkOptions& options) {
+    const SinkList* current = sinks_.load(std::memory_order_acquire);
+    if (!sink || (current && current->size() >= kMaxSinks)) {
+        return 0;
+    }
+
+    SinkList list = current ? *current : SinkList();
+    SinkEntry entry;
+    entry.id = nextSinkId_++;
+    entry.worker = std::make_shared<detail::SinkWorker>(std::move(sink), options.minLevel, options.queueCapacity,
+                                                        options.overflow == OverflowPolicy::Drop);
+    list.push_back(entry);
+    publishSinksLocked(std::move(list));
+    return entry.id;
+}
+
+bool Logger::removeSinkLocked(SinkId id) {
+    const SinkList* current = sinks_.load(std::memory_order_acquire);
+    if (!current || id == 0) {
+        return false;
+    }
+
+    SinkList list;
+    std::shared_ptr<detail::SinkWorker> removed;
+    for (const SinkEntry& entry : *current) {
+        if (entry.id == id) {
+            removed = entry.worker;
+        } else {
+            list.push_back(entry);
+        }
+    }
+    if (!removed) {
+        return false;
+    }
+
+    publishSinksLocked(std::move(list));
+    removed->stop();
+    return true;
+}
+
+void Logger::publishSinksLocked(SinkList list) {
+    auto published = std::make_unique<SinkList>(std::move(list));
+    sinks_.store(published.get(), std::memory_order_seq_cst);
+    if (sinkList_) {
+        retiredSinkLists_.push_back(std::move(sinkList_));
+    }
+    sinkList_ = std::move(published);
+
+    // 旧列表释放后其中已停止的 SinkWorker 随之析构，队列存储一并释放
+    reclaimRetired(retiredSinkLists_, kSinkSlot);
+}
+
+void Logger::setOutputFile(const std::string& filename) {
+    setOutputFile(filename, RotationPolicy());
+}
+
+void Logger::setOutputFile(const std::string& filename, const RotationPolicy& rotation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    removeSinkLocked(fileSink_);
+    fileSink_ = 0;
+
+    std::shared_ptr<Sink> sink = makeFileSinkLocked(filename, rotation);
+    if (!sink) {
         std::cerr << "Failed to open log file: " << filename << std::endl;
+        return;
     }
+    fileSink_ = addSinkLocked(std::move(sink), SinkOptions());
+    outputPath_ = filename;
+    rotation_ = rotation;
+}
+
+std::shared_ptr<Sink> Logger::makeFileSinkLocked(const std::string& filename, const RotationPolicy& rotation) {
+    if (rotation.enabled()) {
+        auto sink = std::make_shared<RotatingFileSink>(filename, rotation, flushPolicy_);
+        return sink->isOpen() ? sink : nullptr;
+    }
+    auto sink = std::make_shared<FileSink>(filename, flushPolicy_);
+    return sink->isOpen() ? sink : nullptr;
 }
 
 void Logger::closeOutputFile() {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (outputFile_.is_open()) {
-        outputFile_.close();
+    removeSinkLocked(fileSink_);
+    fileSink_ = 0;
+    outputPath_.clear();
+}
+
+void Logger::setShardedOutput(const std::string& path, const ShardOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publishShardsLocked(std::make_shared<detail::ShardSet>(path, options));
+}
+
+void Logger::closeShardedOutput() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publishShardsLocked(nullptr);
+}
+
+void Logger::publishShardsLocked(std::shared_ptr<detail::ShardSet> shards) {
+    shards_.store(shards.get(), std::memory_order_seq_cst);
+    if (shardSet_) {
+        shardSet_->close();
+        retiredShardSets_.push_back(std::move(shardSet_));
     }
+    shardSet_ = std::move(shards);
+
+    // 没有槽位指向的旧集合只剩各线程绑定持有的引用，最后一个绑定释放时析构
+    reclaimRetired(retiredShardSets_, kShardSlot);
+}
+
+std::vector<std::string> Logger::shardPaths() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    detail::ShardSet* shards = shards_.load(std::memory_order_acquire);
+    return shards ? shards->paths() : std::vector<std::string>();
 }
 
 void Logger::setConsoleOutput(bool enable) {
     std::lock_guard<std::mutex> lock(mutex_);
-    consoleOutput_ = enable;
+    if (enable && consoleSink_ == 0) {
+        consoleSink_ = addSinkLocked(std::make_shared<ConsoleSink>(flushPolicy_), SinkOptions());
+    } else if (!enable && consoleSink_ != 0) {
+        removeSinkLocked(consoleSink_);
+        consoleSink_ = 0;
+    }
+}
+
+void Logger::setAsyncMode(bool enable, size_t queueCapacity, OverflowPolicy policy) {
+    if (!enable) {
+        stopWriter();
+        return;
+    }
+    if (async_.load(std::memory_order_acquire)) {
+        return;
+    }
+    overflowPolicy_ = policy;
+    queue_ = std::make_unique<BoundedMpscQueue<LogRecord>>(queueCapacity);
+    stopping_.store(false, std::memory_order_relaxed);
+    writer_ = std::thread(&Logger::writerLoop, this);
+    async_.store(true, std::memory_order_release);
+}
+
+void Logger::flush() {
+    reportAllSuppressed();
+
+    if (async_.load(std::memory_order_acquire)) {
+        uint64_t target = enqueued_.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wakeCv_.notify_one();
+        flushedCv_.wait(lock, [&] {
+            return written_.load(std::memory_order_acquire) >= target ||
+                   !async_.load(std::memory_order_acquire);
+        });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 异步队列已排空，此时输出全部未完成的重复计数
+        detail::DedupTable* dedup = dedup_.load(std::memory_order_acquire);
+        if (dedup) {
+            sweepDedup(*dedup, true);
+        }
+        const SinkList* sinks = sinks_.load(std::memory_order_acquire);
+        if (sinks) {
+            for (const SinkEntry& entry : *sinks) {
+                entry.worker->flush();
+            }
+        }
+        detail::ShardSet* shards = shards_.load(std::memory_order_acquire);
+        if (shards) {
+            shards->flush();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(binaryMutex_);
+    if (binaryFile_.is_open()) {
+        binaryFile_.flush();
+    }
+}
+
+void Logger::setFlushPolicy(const FlushPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushPolicy_ = policy;
+
+    // 便捷 sink 在各自的写线程上运行，用新策略重新创建它们，而不是跨线程修改
+    if (consoleSink_ != 0) {
+        removeSinkLocked(consoleSink_);
+        consoleSink_ = addSinkLocked(std::make_shared<ConsoleSink>(flushPolicy_), SinkOptions());
+    }
+    if (fileSink_ != 0) {
+        removeSinkLocked(fileSink_);
+        std::shared_ptr<Sink> sink = makeFileSinkLocked(outputPath_, rotation_);
+        fileSink_ = sink ? addSinkLocked(std::move(sink), SinkOptions()) : 0;
+    }
+}
+
+FlushPolicy Logger::flushPolicy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flushPolicy_;
+}
+
+IoStats Logger::ioStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IoStats stats;
+    const SinkList* sinks = sinks_.load(std::memory_order_acquire);
+    if (sinks) {
+        for (const SinkEntry& entry : *sinks) {
+            IoStats sink = entry.worker->sink().ioStats();
+            stats.lines += sink.lines;
+            stats.writeCalls += sink.writeCalls;
+            stats.syncCalls += sink.syncCalls;
+            stats.bytes += sink.bytes;
+        }
+    }
+    detail::ShardSet* shards = shards_.load(std::memory_order_acquire);
+    if (shards) {
+        IoStats sharded = shards->ioStats();
+        stats.lines += sharded.lines;
+        stats.writeCalls += sharded.writeCalls;
+        stats.syncCalls += sharded.syncCalls;
+        stats.bytes += sharded.bytes;
+    }
+    return stats;
+}
+
+uint64_t Logger::droppedCount() const {
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    const SinkList* sinks = protect(sinks_, kSinkSlot);
+    if (sinks) {
+        for (const SinkEntry& entry : *sinks) {
+            dropped += entry.worker->droppedCount();
+        }
+    }
+    return dropped;
+}
+
+MetricsSnapshot Logger::metrics() {
+    MetricsSnapshot snapshot;
+    collectMetrics(snapshot, true);
+    return snapshot;
+}
+
+void Logger::collectMetrics(MetricsSnapshot& out, bool wait) {
+    detail::collectThreadMetrics(out);
+    out.dropped = dropped_.load(std::memory_order_relaxed);
+    out.suppressed = suppressedCount();
+    if (async_.load(std::memory_order_acquire)) {
+        out.queueDepth = queue_->size();
+        out.queueCapacity = queue_->capacity();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    if (wait) {
+        lock.lock();
+    } else if (!lock.try_lock()) {
+        return;
+    }
+    for (const auto& table : dedupTables_) {
+        out.collapsed += table->collapsedCount();
+    }
+    const SinkList* sinks = sinks_.load(std::memory_order_acquire);
+    if (sinks) {
+        for (const SinkEntry& entry : *sinks) {
+            SinkMetrics sink;
+            sink.id = entry.id;
+            sink.queueDepth = entry.worker->queueDepth();
+            sink.queueCapacity = entry.worker->queueCapacity();
+            sink.dropped = entry.worker->droppedCount();
+            sink.io = entry.worker->sink().ioStats();
+            out.dropped += sink.dropped;
+            out.sinks.push_back(sink);
+        }
+    }
+}
+
+void Logger::setMetricsReport(std::chrono::milliseconds interval) {
+    int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+    metricsInterval_.store(nanos, std::memory_order_relaxed);
+    metricsNext_.store(nanos > 0 ? timestamps_.now() + nanos : 0, std::memory_order_relaxed);
+}
+
+void Logger::reportMetrics(int64_t now) {
+    int64_t next = metricsNext_.load(std::memory_order_relaxed);
+    int64_t interval = metricsInterval_.load(std::memory_order_relaxed);
+    if (next == 0 || now < next || interval <= 0 ||
+        !metricsNext_.compare_exchange_strong(next, now + interval, std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(metricsMutex_);
+    MetricsSnapshot current;
+    collectMetrics(current, false);
+
+    // 统计行不经过限流、重复合并与飞行记录器，只经过各 sink 自己的级别过滤
+    std::string message;
+    std::string line;
+    auto emit = [&] {
+        line.clear();
+        formatInto(line, LogLevel::INFO, RenderedTags{"[m3log stats] "}, message, timestamps_.now());
+        writeSinks(line, LogLevel::INFO);
+    };
+
+    message = "lines=" + std::to_string(current.lines) + " bytes=" + std::to_string(current.bytes) +
+              " dropped=" + std::to_string(current.dropped) + " blocked=" + std::to_string(current.blocked) +
+              " contended=" + std::to_string(current.contended) +
+              " suppressed=" + std::to_string(current.suppressed) +
+              " collapsed=" + std::to_string(current.collapsed);
+    if (current.queueCapacity > 0) {
+        message += " queue=" + std::to_string(current.queueDepth) + "/" + std::to_string(current.queueCapacity);
+    }
+    emit();
+
+    const std::pair<const char*, HistogramSnapshot MetricsSnapshot::*> stages[] = {
+        {"format", &MetricsSnapshot::format},
+        {"enqueue", &MetricsSnapshot::enqueue},
+        {"write", &MetricsSnapshot::write},
+    };
+    for (const auto& [name, member] : stages) {
+        HistogramSnapshot delta = (current.*member).since(metricsPrevious_.*member);
+        message = std::string(name) + " count=" + std::to_string(delta.count) +
+                  " p50=" + std::to_string(delta.percentile(0.5)) + "ns p99=" +
+                  std::to_string(delta.percentile(0.99)) + "ns p999=" + std::to_string(delta.percentile(0.999)) +
+                  "ns max=" + std::to_string(delta.max) + "ns";
+        emit();
+    }
+
+    for (const SinkMetrics& sink : current.sinks) {
+        message = "sink=" + std::to_string(sink.id) + " queue=" + std::to_string(sink.queueDepth) + "/" +
+                  std::to_string(sink.queueCapacity) + " dropped=" + std::to_string(sink.dropped) +
+                  " lines=" + std::to_string(sink.io.lines) + " bytes=" + std::to_string(sink.io.bytes) +
+                  " writes=" + std::to_string(sink.io.writeCalls) + " syncs=" + std::to_string(sink.io.syncCalls);
+        emit();
+    }
+    metricsPrevious_ = std::move(current);
+}
+
+void Logger::enqueue(LogRecord&& record) {
+    bool blocked = false;
+    while (!queue_->tryPush(std::move(record))) {
+        if (overflowPolicy_ == OverflowPolicy::Drop) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (!blocked) {
+            blocked = true;
+            detail::ThreadMetrics& metrics = detail::threadMetrics();
+            detail::ThreadMetrics::add(metrics.blocked, 1);
+        }
+        // 队列已满：唤醒写线程并让出CPU
+        if (writerSleeping_.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wakeCv_.notify_one();
+        }
+        std::this_thread::yield();
+    }
+    enqueued_.fetch_add(1, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writerSleeping_.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        wakeCv_.notify_one();
+    }
+}
+
+void Logger::writerLoop() {
+    LogRecord record;
+    std::string line;
+    std::string text;
+    detail::ThreadMetrics& metrics = detail::threadMetrics();
+    for (;;) {
+        bool drained = true;
+        while (queue_->tryPop(record)) {
+            drained = false;
+            bool timed = metrics.sample();
+            int64_t start = timed ? detail::metricsClock() : 0;
+            // 带类型参数的日志在这里渲染，调用线程只负责编码参数
+            std::string_view message = record.message;
+            if (record.formatted) {
+                text.clear();
+                binary::renderArgs(text, record.format, record.message);
+                message = text;
+            }
+            line.clear();
+            if (record.tagSet.empty()) {
+                formatInto(line, record.level, RenderedTags{record.tagText}, message, record.time);
+            } else {
+                formatInto(line, record.level, record.tagSet, message, record.time);
+            }
+            int64_t formatted = timed ? detail::metricsClock() : 0;
+            writeLog(line, record.level);
+            if (timed) {
+                metrics.format.record(static_cast<uint64_t>(formatted - start));
+                metrics.enqueue.record(static_cast<uint64_t>(detail::metricsClock() - formatted));
+            }
+            metrics.addLine(line.size());
+            written_.fetch_add(1, std::memory_order_release);
+        }
+        if (!drained) {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            flushedCv_.notify_all();
+            continue;
+        }
+
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        // 队列为空：进入休眠，生产者入队后会唤醒；超时用于兜底
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        writerSleeping_.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue_->empty() && !stopping_.load(std::memory_order_acquire)) {
+            wakeCv_.wait_for(lock, std::chrono::milliseconds(50));
+        }
+        writerSleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::stopWriter() {
+    if (!async_.load(std::memory_order_acquire)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_.store(true, std::memory_order_release);
+        wakeCv_.notify_one();
+    }
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    async_.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        flushedCv_.notify_all();
+    }
+}
+
+void Logger::setClockSource(ClockSource source) {
+    timestamps_.setClockSource(source);
+}
+
+void Logger::setTimestampPrecision(TimestampPrecision precision) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timestamps_.setPrecision(precision);
+    detail::FlightRecorder* recorder = recorder_.load(std::memory_order_relaxed);
+    if (recorder) {
+        recorder->setPrecision(precision);
+    }
+}
+
+void Logger::appendTimestamp(std::string& out, int64_t time) {
+    size_t pos = out.size();
+    out.resize(pos + TimestampEngine::kMaxLength);
+    size_t length = timestamps_.format(time, out.data() + pos);
+    out.resize(pos + length);
+}
+
+void Logger::setMinLogLevel(LogLevel level) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    outputLevel_.store(static_cast<int>(level), std::memory_order_relaxed);
+    publishLevelsLocked();
+}
+
+LogLevel Logger::minLogLevel() const {
+    return static_cast<LogLevel>(outputLevel_.load(std::memory_order_relaxed));
+}
+
+void Logger::publishLevelsLocked() {
+    int level = outputLevel_.load(std::memory_order_relaxed);
+    const LevelRules* levels = levelRules_.load(std::memory_order_relaxed);
+    if (levels) {
+        level = std::min(level, levels->minLevel);
+    }
+    const detail::FlightRecorder* recorder = recorder_.load(std::memory_order_relaxed);
+    if (recorder) {
+        level = std::min(level, static_cast<int>(recorder->minLevel()));
+    }
+    minLevel_.store(level, std::memory_order_relaxed);
+}
+
+void Logger::setTagLevel(std::string_view tag, LogLevel level) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const LevelRules* current = levelRules_.load(std::memory_order_relaxed);
+    auto rules = current ? std::make_unique<LevelRules>(*current) : std::make_unique<LevelRules>();
+    rules->byTag.insert_or_assign(std::string(tag), static_cast<int>(level));
+    publishLevelRulesLocked(std::move(rules));
+}
+
+void Logger::clearTagLevel(std::string_view tag) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const LevelRules* current = levelRules_.load(std::memory_order_relaxed);
+    if (!current || current->byTag.find(tag) == current->byTag.end()) {
+        return;
+    }
+    auto rules = std::make_unique<LevelRules>(*current);
+    rules->byTag.erase(rules->byTag.find(tag));
+    publishLevelRulesLocked(std::move(rules));
+}
+
+void Logger::clearTagLevels() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (levelRules_.load(std::memory_order_relaxed)) {
+        publishLevelRulesLocked(std::make_unique<LevelRules>());
+    }
+}
+
+LogLevel Logger::tagLevel(std::string_view tag) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const LevelRules* rules = levelRules_.load(std::memory_order_relaxed);
+    if (rules) {
+        auto it = rules->byTag.find(tag);
+        if (it != rules->byTag.end()) {
+            return static_cast<LogLevel>(it->second);
+        }
+    }
+    return minLogLevel();
+}
+
+void Logger::publishLevelRulesLocked(std::unique_ptr<LevelRules> rules) {
+    // 代数变化使各 TagSet 缓存的查找结果失效
+    rules->generation = ++levelGeneration_;
+    rules->minLevel = static_cast<int>(LogLevel::FATAL);
+    rules->maxLevel = static_cast<int>(LogLevel::DEBUG);
+    for (const auto& [tag, level] : rules->byTag) {
+        rules->minLevel = std::min(rules->minLevel, level);
+        rules->maxLevel = std::max(rules->maxLevel, level);
+    }
+    if (rules->byTag.empty()) {
+        rules.reset();
+    }
+    levelRules_.store(rules.get(), std::memory_order_seq_cst);
+    if (levelRuleTable_) {
+        retiredLevelRules_.push_back(std::move(levelRuleTable_));
+    }
+    levelRuleTable_ = std::move(rules);
+    publishLevelsLocked();
+    reclaimRetired(retiredLevelRules_, kLevelSlot);
+}
+
+bool Logger::loadLevelConfig(const std::string& path) {
+    std::string text;
+    if (!detail::readFile(path, text)) {
+        std::cerr << "Failed to read level config: " << path << std::endl;
+        return false;
+    }
+    return applyLevelConfig(text, path);
+}
+
+bool Logger::applyLevelConfig(const std::string& text, const std::string& path) {
+    LevelConfig config;
+    std::string error;
+    if (!parseLevelConfig(text, config, error)) {
+        std::cerr << "Invalid level config " << path << ": " << error << std::endl;
+        return false;
+    }
+    auto rules = std::make_unique<LevelRules>();
+    for (auto& [tag, level] : config.tags) {
+        rules->byTag.insert_or_assign(std::move(tag), static_cast<int>(level));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (config.hasDefault) {
+        outputLevel_.store(static_cast<int>(config.defaultLevel), std::memory_order_relaxed);
+    }
+    publishLevelRulesLocked(std::move(rules));
+    return true;
+}
+
+bool Logger::watchLevelConfig(const std::string& path, const LevelWatchOptions& options) {
+    // 监视线程重新加载时只取 mutex_，因此可以在持有 watchMutex_ 时等待它退出
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    configWatcher_.reset();
+    bool loaded = loadLevelConfig(path);
+    configWatcher_ = std::make_unique<detail::ConfigWatcher>(
+        path, options, [this, path](const std::string& text) { applyLevelConfig(text, path); });
+    return loaded;
+}
+
+void Logger::stopWatchingLevelConfig() {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    configWatcher_.reset();
 }
 
-std::string Logger::generateTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-    
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time_t_now), "%Y-%m-%dT%H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count() << 'Z';
-    
-    return ss.str();
+void Logger::setFlightRecorder(const std::string& path, const FlightRecorderOptions& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto recorder = std::make_unique<detail::FlightRecorder>(path, options, timestamps_.precision());
+    if (!recorder->isOpen()) {
+        std::cerr << "Failed to open flight recorder: " << path << std::endl;
+        return;
+    }
+    publishRecorderLocked(std::move(recorder));
+}
+
+void Logger::closeFlightRecorder() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publishRecorderLocked(nullptr);
+}
+
+void Logger::publishRecorderLocked(std::unique_ptr<detail::FlightRecorder> recorder) {
+    recorder_.store(recorder.get(), std::memory_order_seq_cst);
+    if (flightRecorder_) {
+        retiredRecorders_.push_back(std::move(flightRecorder_));
+    }
+    flightRecorder_ = std::move(recorder);
+    publishLevelsLocked();
+
+    // 没有线程仍在写入的旧记录器在析构时解除映射并关闭文件
+    reclaimRetired(retiredRecorders_, kRecorderSlot);
 }
 
-std::string Logger::levelToString(LogLevel level) {
+std::string_view Logger::levelToString(LogLevel level) {
     switch (level) {
         case LogLevel::DEBUG: return "DEBUG";
         case LogLevel::INFO:  return "INFO";
@@ -63,43 +861,619 @@ std::string Logger::levelToString(LogLevel level) {
     }
 }
 
-std::string Logger::escapeMessage(const std::string& message) {
-    std::string result = message;
-    // 替换换行符为 \n 字符串
-    std::regex newlineRegex("\n");
-    result = std::regex_replace(result, newlineRegex, "\\n");
-    return result;
+void Logger::appendEscaped(std::string& out, std::string_view message) {
+    // 向量化扫描换行符，没有换行时整段追加
+    const char* data = message.data();
+    size_t length = message.size();
+    const char* hit = m3log_find_newline(data, length);
+    if (!hit) {
+        out.append(data, length);
+        return;
+    }
+
+    // 每个换行符替换为 \n 两个字符
+    size_t extra = m3log_count_newlines(hit, length - (hit - data));
+    size_t pos = out.size();
+    out.resize(pos + length + extra);
+    m3log_escape_newlines(data, length, out.data() + pos);
 }
 
-std::string Logger::format(LogLevel level, const std::vector<std::string>& tags, const std::string& message) {
-    std::stringstream ss;
-    
-    // 添加时间戳
-    ss << "@" << generateTimestamp() << " ";
-    
-    // 添加标签
-    if (!tags.empty()) {
-        ss << "[";
-        for (size_t i = 0; i < tags.size(); ++i) {
-            ss << tags[i];
-            if (i < tags.size() - 1) {
-                ss << " ";
+const std::vector<std::string>& TagSet::tags() const {
+    static const std::vector<std::string> kEmpty;
+    return data_ ? data_->tags : kEmpty;
+}
+
+TagSet Logger::internTags(std::initializer_list<std::string_view> tags) {
+    return internTags(std::span<const std::string_view>(tags.begin(), tags.size()));
+}
+
+TagSet Logger::internTags(std::span<const std::string_view> tags) {
+    if (tags.empty()) {
+        return TagSet();
+    }
+
+    std::string prefix;
+    appendTags(prefix, tags);
+
+    std::lock_guard<std::mutex> lock(tagMutex_);
+    auto it = tagRegistry_.find(prefix);
+    if (it != tagRegistry_.end()) {
+        return TagSet(it->second.get());
+    }
+
+    auto data = std::make_unique<TagSet::Data>();
+    data->tags.assign(tags.begin(), tags.end());
+    data->prefix = prefix;
+    TagSet handle(data.get());
+    tagRegistry_.emplace(std::move(prefix), std::move(data));
+    return handle;
+}
+
+TagSet Logger::internTags(const std::vector<std::string>& tags) {
+    std::vector<std::string_view> views(tags.begin(), tags.end());
+    return internTags(std::span<const std::string_view>(views));
+}
+
+std::string& Logger::argBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
+
+const CallSite& Logger::registerCallSite(LogLevel level, TagSet tags, std::string_view format) {
+    std::lock_guard<std::mutex> lock(callSiteMutex_);
+    uint32_t id = static_cast<uint32_t>(callSites_.size());
+    callSites_.push_back(std::unique_ptr<CallSite>(new CallSite(id, level, tags, format)));
+    return *callSites_.back();
+}
+
+void Logger::setBinaryOutput(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(binaryMutex_);
+    if (binaryFile_.is_open()) {
+        binaryFile_.close();
+    }
+    binaryFile_.open(filename, std::ios::app | std::ios::binary);
+    if (!binaryFile_.is_open()) {
+        std::cerr << "Failed to open binary log file: " << filename << std::endl;
+        binary_.store(false, std::memory_order_release);
+        return;
+    }
+
+    // 追加模式下每次打开都写入新的文件头，解码器遇到文件头时重置描述符表
+    binaryPrecision_ = timestamps_.precision();
+    char header[6] = {binary::kMagic[0], binary::kMagic[1], binary::kMagic[2], binary::kMagic[3],
+                      static_cast<char>(binary::kVersion), static_cast<char>(binaryPrecision_)};
+    binaryFile_.write(header, sizeof(header));
+    ++binaryGeneration_;
+    binaryLastTime_ = 0;
+    binary_.store(true, std::memory_order_release);
+}
+
+void Logger::closeBinaryOutput() {
+    std::lock_guard<std::mutex> lock(binaryMutex_);
+    binary_.store(false, std::memory_order_release);
+    if (binaryFile_.is_open()) {
+        binaryFile_.close();
+    }
+}
+
+void Logger::setRateLimit(std::string_view tag, const RateLimit& limit) {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    std::string label = "[" + std::string(tag) + "]";
+    RateLimiter& limiter = createRateLimiterLocked(limit, label, label + " ");
+
+    const RateRules* current = rateRules_.load(std::memory_order_relaxed);
+    auto rules = current ? std::make_unique<RateRules>(*current) : std::make_unique<RateRules>();
+    auto it = rules->byTag.find(tag);
+    if (it != rules->byTag.end()) {
+        // 替换规则时使用新的令牌桶，旧限流器不再被读取后输出未汇总的计数并释放
+        rules->limiters[it->second] = &limiter;
+    } else {
+        rules->byTag.emplace(std::string(tag), static_cast<uint32_t>(rules->limiters.size()));
+        rules->limiters.push_back(&limiter);
+    }
+    publishRateRulesLocked(std::move(rules));
+}
+
+void Logger::clearRateLimit(std::string_view tag) {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    const RateRules* current = rateRules_.load(std::memory_order_relaxed);
+    if (!current || current->byTag.find(tag) == current->byTag.end()) {
+        return;
+    }
+
+    auto rules = std::make_unique<RateRules>();
+    for (const auto& [name, index] : current->byTag) {
+        if (name != tag) {
+            rules->byTag.emplace(name, static_cast<uint32_t>(rules->limiters.size()));
+            rules->limiters.push_back(current->limiters[index]);
+        }
+    }
+    publishRateRulesLocked(std::move(rules));
+}
+
+void Logger::setRateLimit(const CallSite& site, const RateLimit& limit) {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    std::string label = "call site \"" + site.format_ + "\"";
+    RateLimiter& limiter = createRateLimiterLocked(limit, std::move(label), std::string(site.tags().prefix()));
+    RateLimiter* previous = site.limiter_.exchange(&limiter, std::memory_order_seq_cst);
+    if (previous) {
+        retiredSiteLimiters_.push_back(previous);
+        reclaimRateLimitersLocked();
+    } else {
+        sites_.push_back(&site);
+    }
+}
+
+RateLimiter& Logger::registerRateLimiter(const RateLimit& limit, std::string_view label) {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    rateLimiters_.push_back(std::make_unique<RateLimiter>(limit, std::string(label), std::string()));
+    return *rateLimiters_.back();
+}
+
+RateLimiter& Logger::createRateLimiterLocked(const RateLimit& limit, std::string label, std::string tagPrefix) {
+    ruleLimiters_.push_back(std::make_unique<RateLimiter>(limit, std::move(label), std::move(tagPrefix)));
+    return *ruleLimiters_.back();
+}
+
+void Logger::publishRateRulesLocked(std::unique_ptr<RateRules> rules) {
+    // 代数变化使各 TagSet 缓存的解析结果失效
+    rules->generation = ++rateGeneration_;
+    if (rules->limiters.empty()) {
+        rules.reset();
+    }
+    rateRules_.store(rules.get(), std::memory_order_seq_cst);
+    if (rateRuleTable_) {
+        retiredRateRules_.push_back(std::move(rateRuleTable_));
+    }
+    rateRuleTable_ = std::move(rules);
+    reclaimRateLimitersLocked();
+}
+
+void Logger::reclaimRateLimitersLocked() {
+    reclaimRetired(retiredRateRules_, kRateSlot);
+    if (!retiredSiteLimiters_.empty()) {
+        std::vector<const void*> reading = readingObjects(kLimitSlot);
+        std::erase_if(retiredSiteLimiters_, [&](const RateLimiter* limiter) {
+            return std::find(reading.begin(), reading.end(), limiter) == reading.end();
+        });
+    }
+
+    // 仍可能被读取的限流器：当前与未释放的规则表、调用点当前的和仍被登记的限流器
+    std::vector<const RateLimiter*> live(retiredSiteLimiters_.begin(), retiredSiteLimiters_.end());
+    for (const CallSite* site : sites_) {
+        live.push_back(site->limiter_.load(std::memory_order_relaxed));
+    }
+    auto addTable = [&](const std::unique_ptr<RateRules>& rules) {
+        if (rules) {
+            live.insert(live.end(), rules->limiters.begin(), rules->limiters.end());
+        }
+    };
+    addTable(rateRuleTable_);
+    std::for_each(retiredRateRules_.begin(), retiredRateRules_.end(), addTable);
+
+    // 其余的已没有读取方，输出未汇总的丢弃计数后释放
+    int64_t now = RateLimiter::now();
+    std::erase_if(ruleLimiters_, [&](const std::unique_ptr<RateLimiter>& limiter) {
+        if (std::find(live.begin(), live.end(), limiter.get()) != live.end()) {
+            return false;
+        }
+        if (limiter->hasSuppressed()) {
+            reportSuppressed(*limiter, now, true);
+        }
+        return true;
+    });
+}
+
+void Logger::setSuppressionReportInterval(std::chrono::milliseconds interval) {
+    reportInterval_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count(),
+                          std::memory_order_relaxed);
+}
+
+uint64_t Logger::suppressedCount() {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    uint64_t total = suppressedReported_.load(std::memory_order_relaxed);
+    for (const auto& limiter : rateLimiters_) {
+        total += limiter->pendingSuppressed();
+    }
+    for (const auto& limiter : ruleLimiters_) {
+        total += limiter->pendingSuppressed();
+    }
+    return total;
+}
+
+RateLimiter* Logger::findTagLimiter(const RateRules& rules, TagSet tags) {
+    if (tags.empty()) {
+        return nullptr;
+    }
+    // 驻留标签集合缓存解析结果，规则表不变时只需一次原子读取
+    uint64_t cached = tags.data_->rateCache.load(std::memory_order_relaxed);
+    if (static_cast<uint32_t>(cached >> 32) != rules.generation) {
+        uint32_t slot = 0;
+        for (const std::string& tag : tags.data_->tags) {
+            auto it = rules.byTag.find(std::string_view(tag));
+            if (it != rules.byTag.end()) {
+                slot = it->second + 1;
+                break;
+            }
+        }
+        cached = (static_cast<uint64_t>(rules.generation) << 32) | slot;
+        tags.data_->rateCache.store(cached, std::memory_order_relaxed);
+    }
+    uint32_t slot = static_cast<uint32_t>(cached);
+    return slot ? rules.limiters[slot - 1] : nullptr;
+}
+
+template <typename Range>
+RateLimiter* Logger::findTagLimiter(const RateRules& rules, const Range& tags) {
+    for (const auto& tag : tags) {
+        auto it = rules.byTag.find(std::string_view(tag));
+        if (it != rules.byTag.end()) {
+            return rules.limiters[it->second];
+        }
+    }
+    return nullptr;
+}
+
+int Logger::findTagLevel(const LevelRules& rules, TagSet tags) {
+    if (tags.empty()) {
+        return -1;
+    }
+    // 与限流规则相同：驻留标签集合缓存查找结果，级别表不变时只需一次原子读取
+    uint64_t cached = tags.data_->levelCache.load(std::memory_order_relaxed);
+    if (static_cast<uint32_t>(cached >> 32) != rules.generation) {
+        uint32_t slot = 0;
+        for (const std::string& tag : tags.data_->tags) {
+            auto it = rules.byTag.find(std::string_view(tag));
+            if (it != rules.byTag.end()) {
+                slot = static_cast<uint32_t>(it->second) + 1;
+                break;
             }
         }
-        ss << "] ";
+        cached = (static_cast<uint64_t>(rules.generation) << 32) | slot;
+        tags.data_->levelCache.store(cached, std::memory_order_relaxed);
+    }
+    return static_cast<int>(static_cast<uint32_t>(cached)) - 1;
+}
+
+template <typename Range>
+int Logger::findTagLevel(const LevelRules& rules, const Range& tags) {
+    for (const auto& tag : tags) {
+        auto it = rules.byTag.find(std::string_view(tag));
+        if (it != rules.byTag.end()) {
+            return it->second;
+        }
+    }
+    return -1;
+}
+
+template <typename Tags>
+bool Logger::isOutputLevel(LogLevel level, const Tags& tags) {
+    const LevelRules* rules = protect(levelRules_, kLevelSlot);
+    if (!rules) {
+        return isOutputLevel(level);
+    }
+    // 全局级别与所有标签级别结论相同时不需要查找
+    int value = static_cast<int>(level);
+    int output = outputLevel_.load(std::memory_order_relaxed);
+    if (value >= std::max(output, rules->maxLevel)) {
+        return true;
+    }
+    if (value < std::min(output, rules->minLevel)) {
+        return false;
+    }
+    int tagLevel = -1;
+    if constexpr (!std::is_same_v<Tags, RenderedTags>) {
+        tagLevel = findTagLevel(*rules, tags);
+    }
+    return value >= (tagLevel >= 0 ? tagLevel : output);
+}
+
+bool Logger::isOutputLevel(LogLevel level, TagSet tags) {
+    return isOutputLevel<TagSet>(level, tags);
+}
+
+bool Logger::acceptsLevel(LogLevel level, TagSet tags) {
+    if (isOutputLevel(level, tags)) {
+        return true;
+    }
+    const detail::FlightRecorder* recorder = protect(recorder_, kRecorderSlot);
+    return recorder && recorder->accepts(level);
+}
+
+bool Logger::acceptsLevel(LogLevel level, std::span<const std::string_view> tags) {
+    if (isOutputLevel(level, tags)) {
+        return true;
+    }
+    const detail::FlightRecorder* recorder = protect(recorder_, kRecorderSlot);
+    return recorder && recorder->accepts(level);
+}
+
+bool Logger::admit(RateLimiter& limiter, LogLevel level) {
+    // FATAL 与只写入飞行记录器的级别不受限流
+    if (level == LogLevel::FATAL || !isOutputLevel(level)) {
+        return true;
+    }
+    return admitOutput(limiter);
+}
+
+bool Logger::admitOutput(RateLimiter& limiter) {
+    if (!limiter.allow()) {
+        return false;
     }
-    
+    if (limiter.hasSuppressed()) {
+        reportSuppressed(limiter, RateLimiter::now(), false);
+    }
+    return true;
+}
+
+bool Logger::admitCallSite(const CallSite& site) {
+    if (site.level() == LogLevel::FATAL) {
+        return true;
+    }
+    RateLimiter* limiter = protect(site.limiter_, kLimitSlot);
+    if (limiter && !admitOutput(*limiter)) {
+        return false;
+    }
+    const RateRules* rules = protect(rateRules_, kRateSlot);
+    if (rules) {
+        limiter = findTagLimiter(*rules, site.tags());
+        if (limiter && !admitOutput(*limiter)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Logger::reportSuppressed(RateLimiter& limiter, int64_t now, bool force) {
+    if (!force && !limiter.claimReport(now, reportInterval_.load(std::memory_order_relaxed))) {
+        return;
+    }
+    uint64_t count = limiter.takeSuppressed();
+    if (count == 0) {
+        return;
+    }
+    suppressedReported_.fetch_add(count, std::memory_order_relaxed);
+
+    // 汇总行不受运行期最低级别与限流影响，只经过各 sink 自己的级别过滤
+    std::string message = "suppressed " + std::to_string(count) + " lines for " + limiter.label();
+    int64_t time = timestamps_.now();
+    record(LogLevel::WARN, RenderedTags{limiter.tagPrefix()}, message, time);
+    dispatch(LogLevel::WARN, RenderedTags{limiter.tagPrefix()}, message, time);
+}
+
+void Logger::reportAllSuppressed() {
+    std::lock_guard<std::mutex> lock(rateMutex_);
+    int64_t now = RateLimiter::now();
+    for (const auto* limiters : {&rateLimiters_, &ruleLimiters_}) {
+        for (const auto& limiter : *limiters) {
+            if (limiter->hasSuppressed()) {
+                reportSuppressed(*limiter, now, true);
+            }
+        }
+    }
+}
+
+void Logger::writeDeferred(const CallSite& site, std::string_view args) {
+    int64_t time = timestamps_.now();
+    int64_t next = metricsNext_.load(std::memory_order_relaxed);
+    if (next != 0 && time >= next) {
+        reportMetrics(time);
+    }
+    bool output = isOutputLevel(site.level(), site.tags());
+    detail::FlightRecorder* recorder = protect(recorder_, kRecorderSlot);
+    bool recording = recorder && recorder->accepts(site.level());
+
+    if (output && binary_.load(std::memory_order_acquire)) {
+        detail::ThreadMetrics& metrics = detail::threadMetrics();
+        std::unique_lock<std::mutex> lock(binaryMutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            detail::ThreadMetrics::add(metrics.contended, 1);
+            lock.lock();
+        }
+        if (binaryFile_.is_open()) {
+            std::string& record = threadBuffer();
+            record.clear();
+
+            // 调用点第一次写入当前文件时先输出描述符
+            if (site.binaryGeneration_ != binaryGeneration_) {
+                const std::vector<std::string>& tags = site.tags().tags();
+                record.push_back(binary::kDescriptorRecord);
+                binary::putVarint(record, site.id());
+                record.push_back(static_cast<char>(site.level()));
+                binary::putVarint(record, tags.size());
+                for (const auto& tag : tags) {
+                    binary::putVarint(record, tag.size());
+                    record.append(tag);
+                }
+                binary::putVarint(record, site.format().size());
+                record.append(site.format());
+                site.binaryGeneration_ = binaryGeneration_;
+            }
+
+            TimestampPrecision precision = timestamps_.precision();
+            if (precision != binaryPrecision_) {
+                record.push_back(binary::kPrecisionRecord);
+                record.push_back(static_cast<char>(precision));
+                binaryPrecision_ = precision;
+            }
+
+            record.push_back(binary::kEventRecord);
+            binary::putVarint(record, site.id());
+            binary::putVarint(record, binary::zigzag(time - binaryLastTime_));
+            binary::putVarint(record, args.size());
+            record.append(args);
+            binaryLastTime_ = time;
+
+            binaryFile_.write(record.data(), static_cast<std::streamsize>(record.size()));
+            metrics.addLine(record.size());
+            output = false;
+        }
+    }
+    if (!output && !recording) {
+        return;
+    }
+
+    // 文本回退（以及飞行记录器）：与解码工具使用相同的渲染函数，输出与二进制解码结果一致；
+    // 异步模式下由写线程渲染
+    FormatArgs message{site.format(), args, {}};
+    if (recording) {
+        record(site.level(), site.tags(), message, time);
+    }
+    if (output) {
+        dispatch(site.level(), site.tags(), message, time);
+    }
+}
+
+template <typename Tags>
+void Logger::formatInto(std::string& out, LogLevel level, const Tags& tags, std::string_view message, int64_t time) {
+    // 添加时间戳
+    out.push_back('@');
+    appendTimestamp(out, time);
+    out.push_back(' ');
+
+    // 添加标签
+    appendTags(out, tags);
+
     // 添加日志级别
-    ss << "#" << levelToString(level) << ": ";
-    
+    out.push_back('#');
+    out.append(levelToString(level));
+    out.append(": ", 2);
+
     // 添加消息（转义特殊字符）
-    ss << escapeMessage(message);
-    
-    return ss.str();
+    appendEscaped(out, message);
+}
+
+template <typename Tags, typename Message>
+void Logger::logImpl(LogLevel level, const Tags& tags, const Message& message) {
+    if (!shouldLog(level)) {
+        return;
+    }
+
+    // 低于输出级别（含标签级别）、只需写入飞行记录器的日志不经过限流
+    if (!isOutputLevel(level, tags)) {
+        record(level, tags, message, timestamps_.now());
+        return;
+    }
+
+    // 限流在格式化之前检查；没有规则时只多一次原子读取
+    const RateRules* rules = protect(rateRules_, kRateSlot);
+    if (rules && level != LogLevel::FATAL) {
+        RateLimiter* limiter = findTagLimiter(*rules, tags);
+        if (limiter && !admitOutput(*limiter)) {
+            return;
+        }
+    }
+
+    int64_t time = timestamps_.now();
+    record(level, tags, message, time);
+    dispatch(level, tags, message, time);
+
+    int64_t next = metricsNext_.load(std::memory_order_relaxed);
+    if (next != 0 && time >= next) {
+        reportMetrics(time);
+    }
+}
+
+template <typename Tags, typename Message>
+void Logger::record(LogLevel level, const Tags& tags, const Message& message, int64_t time) {
+    detail::FlightRecorder* recorder = protect(recorder_, kRecorderSlot);
+    if (!recorder || !recorder->accepts(level)) {
+        return;
+    }
+    if constexpr (std::is_same_v<Tags, TagSet>) {
+        recorder->record(level, time, tags.prefix(), messageText(message));
+    } else if constexpr (std::is_same_v<Tags, RenderedTags>) {
+        recorder->record(level, time, tags.text, messageText(message));
+    } else {
+        thread_local std::string tagText;
+        tagText.clear();
+        appendTags(tagText, tags);
+        recorder->record(level, time, tagText, messageText(message));
+    }
+}
+
+template <typename Tags, typename Message>
+void Logger::dispatch(LogLevel level, const Tags& tags, const Message& message, int64_t time) {
+    detail::ThreadMetrics& metrics = detail::threadMetrics();
+    bool timed = metrics.sample();
+    int64_t start = timed ? detail::metricsClock() : 0;
+    if (async_.load(std::memory_order_acquire)) {
+        // 异步模式：只拷贝参数入队，格式化与I/O交给后台线程
+        LogRecord record;
+        record.level = level;
+        if constexpr (std::is_same_v<Tags, TagSet>) {
+            record.tagSet = tags;
+        } else {
+            appendTags(record.tagText, tags);
+        }
+        if constexpr (std::is_same_v<Message, FormatArgs>) {
+            // 已在调用线程渲染过（飞行记录器需要文本）时直接传递文本
+            if (message.text.data() == nullptr) {
+                record.message.assign(message.args);
+                record.format = message.format;
+                record.formatted = true;
+            } else {
+                record.message.assign(message.text);
+            }
+        } else {
+            record.message.assign(message);
+        }
+        record.time = time;
+        enqueue(std::move(record));
+        if (timed) {
+            metrics.enqueue.record(static_cast<uint64_t>(detail::metricsClock() - start));
+        }
+        return;
+    }
+
+    std::string& logEntry = threadBuffer();
+    logEntry.clear();
+    formatInto(logEntry, level, tags, messageText(message), time);
+    int64_t formatted = timed ? detail::metricsClock() : 0;
+    writeLog(logEntry, level);
+    if (timed) {
+        metrics.format.record(static_cast<uint64_t>(formatted - start));
+        metrics.enqueue.record(static_cast<uint64_t>(detail::metricsClock() - formatted));
+    }
+    metrics.addLine(logEntry.size());
+}
+
+std::string Logger::format(LogLevel level, const std::vector<std::string>& tags, const std::string& message) {
+    std::string& buffer = threadBuffer();
+    buffer.clear();
+    formatInto(buffer, level, tags, message, timestamps_.now());
+    return buffer;
+}
+
+std::string Logger::format(LogLevel level, TagSet tags, std::string_view message) {
+    std::string& buffer = threadBuffer();
+    buffer.clear();
+    formatInto(buffer, level, tags, message, timestamps_.now());
+    return buffer;
+}
+
+void Logger::formatTo(std::string& out, LogLevel level, const std::vector<std::string>& tags,
+                      std::string_view message) {
+    out.clear();
+    formatInto(out, level, tags, message, timestamps_.now());
+}
+
+void Logger::formatTo(std::string& out, LogLevel level, TagSet tags, std::string_view message) {
+    out.clear();
+    formatInto(out, level, tags, message, timestamps_.now());
+}
+
+void Logger::formatTo(std::string& out, LogLevel level, TagSet tags, std::string_view message, int64_t time) {
+    out.clear();
+    formatInto(out, level, tags, message, time);
 }
 
 std::string Logger::format(LogLevel level, const std::string& tag, const std::string& message) {
-    return format(level, std::vector<std::string>{tag}, message);
+    std::string_view view(tag);
+    std::string& buffer = threadBuffer();
+    buffer.clear();
+    formatInto(buffer, level, std::span<const std::string_view>(&view, 1), message, timestamps_.now());
+    return buffer;
 }
 
 std::string Logger::format(const std::vector<std::string>& tags, const std::string& message) {
@@ -107,37 +1481,147 @@ std::string Logger::format(const std::vector<std::string>& tags, const std::stri
 }
 
 std::string Logger::format(const std::string& tag, const std::string& message) {
-    return format(LogLevel::INFO, std::vector<std::string>{tag}, message);
+    return format(LogLevel::INFO, tag, message);
+}
+
+void Logger::writeLog(std::string_view logEntry, LogLevel level) {
+    detail::DedupTable* dedup = dedup_.load(std::memory_order_acquire);
+    if (dedup) {
+        // 比较时跳过 "@时间戳 "，同一行在不同时间出现视为重复
+        std::string_view key = logEntry;
+        if (!key.empty() && key[0] == '@') {
+            size_t space = key.find(' ');
+            key.remove_prefix(space == std::string_view::npos ? key.size() : space + 1);
+        }
+
+        thread_local std::string pendingText;
+        LogLevel pendingLevel = level;
+        uint64_t pendingCount = 0;
+        int64_t now = RateLimiter::now();
+        bool write = dedup->admit(key, level, now, pendingText, pendingLevel, pendingCount);
+        if (pendingCount > 0) {
+            writeRepeated(pendingText, pendingLevel, pendingCount);
+        }
+        if (dedup->claimSweep(now)) {
+            sweepDedup(*dedup, false);
+        }
+        if (!write) {
+            return;
+        }
+    }
+    writeSinks(logEntry, level);
+}
+
+void Logger::writeRepeated(std::string_view text, LogLevel level, uint64_t count) {
+    thread_local std::string line;
+    line.clear();
+    line.push_back('@');
+    appendTimestamp(line, timestamps_.now());
+    line.push_back(' ');
+    line.append(text);
+    line.append(" (repeated ");
+    line.append(std::to_string(count));
+    line.append(" times)");
+    writeSinks(line, level);
+}
+
+void Logger::sweepDedup(detail::DedupTable& table, bool force) {
+    table.sweep(RateLimiter::now(), force, [this](std::string_view text, LogLevel level, uint64_t count) {
+        writeRepeated(text, level, count);
+    });
+}
+
+void Logger::setDedup(const DedupPolicy& policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dedupTables_.push_back(std::make_unique<detail::DedupTable>(policy));
+    detail::DedupTable* previous = dedup_.exchange(dedupTables_.back().get(), std::memory_order_acq_rel);
+    if (previous) {
+        sweepDedup(*previous, true);
+    }
 }
 
-void Logger::writeLog(const std::string& logEntry) {
+void Logger::disableDedup() {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (consoleOutput_) {
-        std::cout << logEntry << std::endl;
+    detail::DedupTable* previous = dedup_.exchange(nullptr, std::memory_order_acq_rel);
+    if (previous) {
+        sweepDedup(*previous, true);
     }
-    
-    if (outputFile_.is_open()) {
-        outputFile_ << logEntry << std::endl;
-        outputFile_.flush();
+}
+
+uint64_t Logger::collapsedCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t total = 0;
+    for (const auto& table : dedupTables_) {
+        total += table->collapsedCount();
+    }
+    return total;
+}
+
+void Logger::writeSinks(std::string_view logEntry, LogLevel level) {
+    // 分片输出在调用线程直接写入自己的分片
+    detail::ShardSet* shards = protect(shards_, kShardSlot);
+    if (shards && shards->accepts(level)) {
+        shards->write(logEntry, level);
+    }
+
+    const SinkList* sinks = protect(sinks_, kSinkSlot);
+    if (!sinks) {
+        return;
+    }
+
+    // 先确定接受该级别的 sink，再按数量设置引用计数，整行只复制一次
+    uint64_t mask = 0;
+    uint32_t refs = 0;
+    for (size_t i = 0; i < sinks->size(); ++i) {
+        if ((*sinks)[i].worker->accepts(level)) {
+            mask |= uint64_t(1) << i;
+            ++refs;
+        }
+    }
+    if (refs == 0) {
+        return;
+    }
+
+    detail::SharedLine* line = detail::SharedLine::create(logEntry, level, refs);
+    for (size_t i = 0; i < sinks->size(); ++i) {
+        if (mask & (uint64_t(1) << i)) {
+            (*sinks)[i].worker->submit(line);
+        }
     }
 }
 
 void Logger::log(LogLevel level, const std::vector<std::string>& tags, const std::string& message) {
-    std::string logEntry = format(level, tags, message);
-    writeLog(logEntry);
+    logImpl(level, tags, message);
 }
 
 void Logger::log(LogLevel level, const std::string& tag, const std::string& message) {
-    log(level, std::vector<std::string>{tag}, message);
+    // 单个标签以视图形式传递，不构造标签数组
+    std::string_view view(tag);
+    logImpl(level, std::span<const std::string_view>(&view, 1), message);
+}
+
+void Logger::logArgs(LogLevel level, TagSet tags, std::string_view format, std::string_view args) {
+    logImpl(level, tags, FormatArgs{format, args, {}});
+}
+
+void Logger::logArgs(LogLevel level, std::span<const std::string_view> tags, std::string_view format,
+                     std::string_view args) {
+    logImpl(level, tags, FormatArgs{format, args, {}});
+}
+
+void Logger::log(LogLevel level, TagSet tags, std::string_view message) {
+    logImpl(level, tags, message);
+}
+
+void Logger::log(LogLevel level, std::span<const std::string_view> tags, std::string_view message) {
+    logImpl(level, tags, message);
 }
 
 void Logger::log(const std::vector<std::string>& tags, const std::string& message) {
     log(LogLevel::INFO, tags, message);
 }
-
 void Logger::log(const std::string& tag, const std::string& message) {
-    log(LogLevel::INFO, std::vector<std::string>{tag}, message);
+    log(LogLevel::INFO, tag, message);
 }
 
 // 便捷日志函数实现
@@ -163,23 +1647,23 @@ void Logger::fatal(const std::vector<std::string>& tags, const std::string& mess
 
 // 单标签便捷日志函数实现
 void Logger::debug(const std::string& tag, const std::string& message) {
-    debug(std::vector<std::string>{tag}, message);
+    log(LogLevel::DEBUG, tag, message);
 }
 
 void Logger::info(const std::string& tag, const std::string& message) {
-    info(std::vector<std::string>{tag}, message);
+    log(LogLevel::INFO, tag, message);
 }
 
 void Logger::warn(const std::string& tag, const std::string& message) {
-    warn(std::vector<std::string>{tag}, message);
+    log(LogLevel::WARN, tag, message);
 }
 
 void Logger::error(const std::string& tag, const std::string& message) {
-    error(std::vector<std::string>{tag}, message);
+    log(LogLevel::ERROR, tag, message);
 }
 
 void Logger::fatal(const std::string& tag, const std::string& message) {
-    fatal(std::vector<std::string>{tag}, message);
+    log(LogLevel::FATAL, tag, message);
 }
 
 } // namespace m3log
\ No newline at end of file
@@ -2,42 +2,338 @@
 #define M3LOG_HH
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <span>
+#include <initializer_list>
+#include <type_traits>
+#include <unordered_map>
 #include <chrono>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+#include "m3log_binary.hh"
+#include "m3log_config.hh"
+#include "m3log_dedup.hh"
+#include "m3log_level.hh"
+#include "m3log_limit.hh"
+#include "m3log_metrics.hh"
+#include "m3log_queue.hh"
+#include "m3log_recorder.hh"
+#include "m3log_shard.hh"
+#include "m3log_sink.hh"
+#include "m3log_timestamp.hh"
+#include "m3log_writer.hh"
+
+// 编译期日志级别阈值（0=DEBUG, 1=INFO, 2=WARN, 3=ERROR, 4=FATAL）
+// 低于该级别的 M3LOG_* 宏调用在编译期被整体移除
+#ifndef M3LOG_ACTIVE_LEVEL
+#define M3LOG_ACTIVE_LEVEL 0
+#endif
 
 namespace m3log {
 
-enum class LogLevel {
-    DEBUG,
-    INFO,
-    WARN,
-    ERROR,
-    FATAL
+// 异步模式下队列已满时的处理策略
+enum class OverflowPolicy {
+    Block,  // 生产者自旋等待直到有空位
+    Drop    // 直接丢弃该条日志
+};
+
+// 输出目标编号，由 Logger::addSink 返回，0 表示无效
+using SinkId = uint64_t;
+
+// 添加输出目标时的选项
+struct SinkOptions {
+    LogLevel minLevel = LogLevel::DEBUG;              // 低于该级别的日志不进入此 sink
+    size_t queueCapacity = 8192;                      // 该 sink 的队列容量
+    OverflowPolicy overflow = OverflowPolicy::Block;  // 队列已满时阻塞生产者或丢弃
+};
+
+// 驻留（intern）后的标签集合句柄
+// 由 Logger::internTags 创建，生命周期与 Logger 相同；"[a b c] " 前缀预先渲染好，
+// 按值传递只复制一个指针。默认构造表示没有标签
+class TagSet {
+public:
+    TagSet() = default;
+
+    bool empty() const { return data_ == nullptr; }
+    const std::vector<std::string>& tags() const;
+
+    // 预渲染的标签前缀 "[a b c] "，无标签时为空
+    std::string_view prefix() const { return data_ ? std::string_view(data_->prefix) : std::string_view(); }
+
+    bool operator==(const TagSet& other) const { return data_ == other.data_; }
+
+private:
+    friend class Logger;
+
+    struct Data {
+        std::vector<std::string> tags;
+        std::string prefix;
+        // 限流规则解析缓存：高 32 位为规则表代数，低 32 位为限流器序号加一（0 表示无规则）
+        mutable std::atomic<uint64_t> rateCache{0};
+        // 标签级别解析缓存：高 32 位为级别表代数，低 32 位为级别加一（0 表示没有标签设置级别）
+        mutable std::atomic<uint64_t> levelCache{0};
+    };
+
+    explicit TagSet(const Data* data) : data_(data) {}
+
+    const Data* data_ = nullptr;
+};
+
+// 延迟格式化日志的调用点描述符
+// 由 Logger::registerCallSite 创建，生命周期与 Logger 相同；通常由 M3LOG_DEFERRED 宏在
+// 调用点以静态局部变量的形式注册一次
+class CallSite {
+public:
+    uint32_t id() const { return id_; }
+    LogLevel level() const { return level_; }
+    TagSet tags() const { return tags_; }
+    std::string_view format() const { return format_; }
+
+private:
+    friend class Logger;
+
+    CallSite(uint32_t id, LogLevel level, TagSet tags, std::string_view format)
+        : id_(id), level_(level), tags_(tags), format_(format) {}
+
+    uint32_t id_;
+    LogLevel level_;
+    TagSet tags_;
+    std::string format_;
+    // 已写入描述符的二进制文件代数，由 Logger::binaryMutex_ 保护
+    mutable uint64_t binaryGeneration_ = 0;
+    // 调用点限流器，由 Logger::setRateLimit 设置
+    mutable std::atomic<RateLimiter*> limiter_{nullptr};
+};
+
+// 可隐式转换为 std::string_view 的消息类型（const char*、std::string 等）
+template <typename T>
+concept MessageLike = std::is_convertible_v<const T&, std::string_view>;
+
+namespace detail {
+// 只有声明没有定义：在常量求值中调用它使编译失败，函数名即错误提示
+void format_placeholder_count_does_not_match_arguments();
+} // namespace detail
+
+// 带类型参数日志的格式串：只能由字符串字面量构造（生命周期为整个程序，可以交给写线程），
+// 构造时在编译期检查 "{}" 占位符个数与参数个数是否一致
+template <typename... Args>
+class FormatString {
+    // 解码时参数在栈上展开，超出的参数不会被还原
+    static_assert(sizeof...(Args) <= binary::kMaxArgs, "m3log: too many log arguments (max binary::kMaxArgs)");
+
+public:
+    template <size_t N>
+    consteval FormatString(const char (&text)[N]) : text_(text, N - 1) {
+        if (binary::countPlaceholders(text_) != sizeof...(Args)) {
+            detail::format_placeholder_count_does_not_match_arguments();
+        }
+    }
+
+    constexpr std::string_view view() const { return text_; }
+
+private:
+    std::string_view text_;
 };
 
+// 参数类型由实参推导，格式串不参与推导
+template <typename... Args>
+using FormatFor = FormatString<std::type_identity_t<Args>...>;
+
 class Logger {
 public:
     // 获取单例实例
     static Logger& instance();
 
-    // 设置输出文件
+    // 添加输出目标：每个 sink 拥有独立的队列与写线程，最多 kMaxSinks 个，失败返回 0
+    SinkId addSink(std::shared_ptr<Sink> sink, const SinkOptions& options = SinkOptions());
+
+    // 移除输出目标：写出其队列中已有的日志后停止写线程；与移除并发提交的日志可能被丢弃
+    bool removeSink(SinkId id);
+
+    // 调整某个输出目标的最低级别
+    bool setSinkLevel(SinkId id, LogLevel level);
+
+    static constexpr size_t kMaxSinks = 64;
+
+    // 设置输出文件（替换之前由本函数添加的 FileSink）
     void setOutputFile(const std::string& filename);
 
+    // 设置按大小或时间轮转的输出文件（rotation 未开启任何条件时等同于上一个重载）
+    void setOutputFile(const std::string& filename, const RotationPolicy& rotation);
+
     // 关闭输出文件
     void closeOutputFile();
 
-    // 设置是否输出到控制台
+    // 按线程分片输出：每个写日志的线程写自己的文件 path.shard0、path.shard1 ...，与其他 sink 同时生效。
+    // 写入在调用线程完成，不经过 sink 队列，线程之间不共享锁与文件偏移；之后用 m3log_merge 工具
+    // 按时间戳合并为一个全局有序的文件。异步模式下所有日志由后台线程写出，只会产生一个分片。
+    // 替换之前的分片输出时先写出并关闭旧的分片
+    void setShardedOutput(const std::string& path, const ShardOptions& options = ShardOptions());
+    void closeShardedOutput();
+
+    // 当前分片输出已创建的分片文件
+    std::vector<std::string> shardPaths();
+
+    // 设置是否输出到控制台（添加或移除默认的 ConsoleSink）
     void setConsoleOutput(bool enable);
 
+    // 开启/关闭异步格式化：日志参数进入有界无锁队列，由后台线程格式化后分发给各 sink
+    // 应在初始化阶段调用，不要与日志调用并发切换
+    void setAsyncMode(bool enable, size_t queueCapacity = 8192,
+                      OverflowPolicy policy = OverflowPolicy::Block);
+
+    // 设置 setOutputFile / setConsoleOutput 所用 sink 的刷新策略
+    // （默认：64KB / 100ms 批量写出，ERROR 及以上立即写出）
+    void setFlushPolicy(const FlushPolicy& policy);
+    FlushPolicy flushPolicy();
+
+    // 等待调用前提交的所有日志写出，并刷新所有 sink（按策略决定是否 fdatasync）
+    void flush();
+
+    // 所有 sink 的 I/O 统计之和
+    IoStats ioStats();
+
+    // 因异步队列或 sink 队列已满而丢弃的日志数量
+    uint64_t droppedCount() const;
+
+    // 自身运行统计：行数、字节、丢弃与等待次数、各级队列深度，以及格式化、入队、sink 写入三段耗时的直方图。
+    // 计数与直方图按线程分别累加、读取时汇总，热路径上不写共享的缓存行
+    MetricsSnapshot metrics();
+
+    // 每隔 interval 输出一组标签为 "[m3log stats]" 的 INFO 级统计行：计数为累计值，耗时分位数为本周期内的值。
+    // 由记录日志的线程顺带检查，没有日志时不输出；0 表示关闭（默认）
+    void setMetricsReport(std::chrono::milliseconds interval);
+
+    // 设置时间戳的时钟来源与小数精度
+    void setClockSource(ClockSource source);
+    void setTimestampPrecision(TimestampPrecision precision);
+
+    // 设置运行期最低输出级别，低于该级别的日志在格式化和分配之前被丢弃
+    // （飞行记录器的级别更低时，这些日志只写入记录器）
+    void setMinLogLevel(LogLevel level);
+    LogLevel minLogLevel() const;
+
+    // 判断某级别当前是否需要处理：输出或写入飞行记录器（一次 relaxed 原子读取）
+    static bool shouldLog(LogLevel level) {
+        return static_cast<int>(level) >= minLevel_.load(std::memory_order_relaxed);
+    }
+
+    // 按标签设置输出级别，覆盖 setMinLogLevel：例如只为 "auth" 开启 DEBUG，或把嘈杂的标签提高到 WARN。
+    // 一组标签中有多个标签设置了级别时使用第一个。检查在格式化与入队之前，级别表只读、修改时整体替换，
+    // 查找无锁；驻留标签集合（含延迟格式化的调用点）缓存查找结果，级别表不变时只需一次原子读取。
+    // 标签级别低于全局级别时，其他标签的该级别日志也会通过 shouldLog，再多一次级别表查找
+    void setTagLevel(std::string_view tag, LogLevel level);
+    void clearTagLevel(std::string_view tag);
+    void clearTagLevels();
+
+    // 对某个标签生效的输出级别（没有设置时为全局级别）
+    LogLevel tagLevel(std::string_view tag);
+
+    // 从配置文件加载级别（格式见 LevelConfig）：文件中的标签级别整体替换当前的标签级别表，
+    // 有 "*" 行时同时设置全局级别；没有 "*" 行时全局级别保持不变（删除该行后重新加载不会恢复默认级别）。
+    // 读取或解析失败时保留原有配置，错误输出到 std::cerr
+    bool loadLevelConfig(const std::string& path);
+
+    // 加载配置文件，并在文件变化或收到 SIGHUP 时自动重新加载（后台线程），替换之前的监视
+    bool watchLevelConfig(const std::string& path, const LevelWatchOptions& options = LevelWatchOptions());
+    void stopWatchingLevelConfig();
+
+    // 限流与采样：按标签限制日志行数，在格式化与入队之前检查，FATAL 不受限制。
+    // 一组标签中有多个标签设置了规则时使用第一个；同一标签的所有调用共享一个令牌桶。
+    // 被丢弃的行数以 WARN 级汇总输出，例如 "[db] #WARN: suppressed 48213 lines for [db]"
+    void setRateLimit(std::string_view tag, const RateLimit& limit);
+    void clearRateLimit(std::string_view tag);
+
+    // 为延迟格式化日志的调用点设置限流规则（与标签规则同时生效）
+    void setRateLimit(const CallSite& site, const RateLimit& limit);
+
+    // 注册调用点限流器（供 M3LOG_LOG_LIMITED 宏使用），label 为汇总行中的调用点名称
+    RateLimiter& registerRateLimiter(const RateLimit& limit, std::string_view label);
+
+    // 判断限流器是否放行一行；放行且有未汇总的丢弃行时先输出汇总行
+    bool admit(RateLimiter& limiter, LogLevel level);
+
+    // 同一限流器两次汇总之间的最短间隔（默认 10 秒）；flush 与 Logger 析构时输出全部未汇总的计数
+    void setSuppressionReportInterval(std::chrono::milliseconds interval);
+
+    // 因限流与采样被丢弃的行数累计
+    uint64_t suppressedCount();
+
+    // 重复日志合并：分发给 sink 之前比较整行（不含时间戳），窗口内的重复行只计数，
+    // 之后输出一行 "... (repeated N times)"。替换或关闭时先输出未完成的计数
+    void setDedup(const DedupPolicy& policy);
+    void disableDedup();
+
+    // 因重复而被合并的行数累计
+    uint64_t collapsedCount();
+
+    // 飞行记录器：最近的日志以原始形式写入 mmap(MAP_SHARED) 的环形文件，进程崩溃或被信号杀死后
+    // 由 m3log_recorder 工具按顺序还原为文本。记录在调用线程无锁写入，不经过异步队列与 sink，
+    // 内容为限流之后、重复合并之前的日志；options.minLevel 可以低于 setMinLogLevel，
+    // 例如常开 DEBUG 记录而只输出 INFO 及以上。替换或关闭后，旧的映射在没有线程仍在写入时解除并关闭文件
+    void setFlightRecorder(const std::string& path, const FlightRecorderOptions& options = FlightRecorderOptions());
+    void closeFlightRecorder();
+
+    // 开启二进制输出：延迟格式化日志（M3LOG_DEFERRED）只追加调用点编号、原始时间和二进制参数，
+    // 由 m3log_decode 工具离线还原为与 format 完全相同的文本行。
+    // 未开启时延迟格式化日志在调用线程渲染，按普通日志输出到控制台和文本文件
+    void setBinaryOutput(const std::string& filename);
+    void closeBinaryOutput();
+
+    // 注册调用点描述符（格式串中以 "{}" 作为参数占位符）
+    const CallSite& registerCallSite(LogLevel level, TagSet tags, std::string_view format);
+
+    // 按调用点记录一条延迟格式化日志；参数支持整数、浮点、bool、char 与字符串
+    template <typename... Args>
+    void logDeferred(const CallSite& site, const Args&... args) {
+        static_assert(sizeof...(Args) <= binary::kMaxArgs, "m3log: too many log arguments (max binary::kMaxArgs)");
+        if (!shouldLog(site.level())) {
+            return;
+        }
+        // 标签级别在编码参数之前检查
+        if (levelRules_.load(std::memory_order_relaxed) != nullptr && !acceptsLevel(site.level(), site.tags())) {
+            return;
+        }
+        // 只写入飞行记录器的级别不经过限流
+        if ((site.limiter_.load(std::memory_order_relaxed) != nullptr ||
+             rateRules_.load(std::memory_order_relaxed) != nullptr) &&
+            isOutputLevel(site.level(), site.tags())) {
+            if (!admitCallSite(site)) {
+                return;
+            }
+        }
+        std::string& buffer = argBuffer();
+        buffer.clear();
+        binary::encodeArgs(buffer, args...);
+        writeDeferred(site, buffer);
+    }
+
+    // 驻留标签集合：同一组标签只创建一次，返回的句柄可长期保存并在热路径上复用
+    TagSet internTags(std::initializer_list<std::string_view> tags);
+    TagSet internTags(std::span<const std::string_view> tags);
+    TagSet internTags(const std::vector<std::string>& tags);
+
     // 格式化日志（返回格式化后的字符串，不输出）
     std::string format(LogLevel level, const std::vector<std::string>& tags, const std::string& message);
     std::string format(LogLevel level, const std::string& tag, const std::string& message);
     std::string format(const std::vector<std::string>& tags, const std::string& message);
     std::string format(const std::string& tag, const std::string& message);
+    std::string format(LogLevel level, TagSet tags, std::string_view message);
+
+    // 格式化到调用方提供的缓冲区（先清空 out 再写入），复用 out 的容量时不产生堆分配
+    void formatTo(std::string& out, LogLevel level, const std::vector<std::string>& tags,
+                  std::string_view message);
+    void formatTo(std::string& out, LogLevel level, TagSet tags, std::string_view message);
+
+    // 按给定时间（自 Unix 纪元以来的纳秒数）格式化，供离线解码等场景还原原始时间
+    void formatTo(std::string& out, LogLevel level, TagSet tags, std::string_view message, int64_t time);
 
     // 记录并输出日志
     void log(LogLevel level, const std::vector<std::string>& tags, const std::string& message);
@@ -45,6 +341,30 @@ public:
     void log(const std::vector<std::string>& tags, const std::string& message);
     void log(const std::string& tag, const std::string& message);
 
+    // 无分配的标签接口：驻留标签集合、标签视图数组或花括号列表
+    void log(LogLevel level, TagSet tags, std::string_view message);
+    void log(LogLevel level, std::span<const std::string_view> tags, std::string_view message);
+    template <MessageLike Message>
+    void log(LogLevel level, std::initializer_list<std::string_view> tags, const Message& message) {
+        log(level, std::span<const std::string_view>(tags.begin(), tags.size()), std::string_view(message));
+    }
+
+    // 带类型参数的日志：参数按值编码为紧凑的二进制形式随记录入队，异步模式下由写线程渲染为文本，
+    // 调用线程不做 to_string 与字符串拼接。格式串以 "{}" 为占位符，占位符个数在编译期检查；
+    // 参数支持整数、浮点、bool、char 与字符串。同步模式或需要写入飞行记录器时在调用线程渲染
+    // 用法：logger.log(LogLevel::INFO, tags, "user={} latency_us={}", id, latency);
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void log(LogLevel level, TagSet tags, FormatFor<Args...> format, const Args&... args) {
+        logFormat(level, tags, format.view(), args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void log(LogLevel level, std::initializer_list<std::string_view> tags, FormatFor<Args...> format,
+             const Args&... args) {
+        logFormat(level, std::span<const std::string_view>(tags.begin(), tags.size()), format.view(), args...);
+    }
+
     // 便捷日志函数
     void debug(const std::vector<std::string>& tags, const std::string& message);
     void info(const std::vector<std::string>& tags, const std::string& message);
@@ -59,7 +379,102 @@ public:
     void error(const std::string& tag, const std::string& message);
     void fatal(const std::string& tag, const std::string& message);
 
+    // 驻留标签集合的便捷函数
+    void debug(TagSet tags, std::string_view message) { log(LogLevel::DEBUG, tags, message); }
+    void info(TagSet tags, std::string_view message) { log(LogLevel::INFO, tags, message); }
+    void warn(TagSet tags, std::string_view message) { log(LogLevel::WARN, tags, message); }
+    void error(TagSet tags, std::string_view message) { log(LogLevel::ERROR, tags, message); }
+    void fatal(TagSet tags, std::string_view message) { log(LogLevel::FATAL, tags, message); }
+
+    // 花括号标签列表的便捷函数，例如 logger.info({"db", "query"}, "ok")，不分配内存
+    template <MessageLike Message>
+    void debug(std::initializer_list<std::string_view> tags, const Message& message) {
+        log(LogLevel::DEBUG, tags, message);
+    }
+    template <MessageLike Message>
+    void info(std::initializer_list<std::string_view> tags, const Message& message) {
+        log(LogLevel::INFO, tags, message);
+    }
+    template <MessageLike Message>
+    void warn(std::initializer_list<std::string_view> tags, const Message& message) {
+        log(LogLevel::WARN, tags, message);
+    }
+    template <MessageLike Message>
+    void error(std::initializer_list<std::string_view> tags, const Message& message) {
+        log(LogLevel::ERROR, tags, message);
+    }
+    template <MessageLike Message>
+    void fatal(std::initializer_list<std::string_view> tags, const Message& message) {
+        log(LogLevel::FATAL, tags, message);
+    }
+
+    // 带类型参数的便捷函数，例如 logger.info(kDbTags, "query {} took {} us", id, elapsed)
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void debug(TagSet tags, FormatFor<Args...> format, const Args&... args) {
+        logFormat(LogLevel::DEBUG, tags, format.view(), args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void debug(std::initializer_list<std::string_view> tags, FormatFor<Args...> format, const Args&... args) {
+        log(LogLevel::DEBUG, tags, format, args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void info(TagSet tags, FormatFor<Args...> format, const Args&... args) {
+        logFormat(LogLevel::INFO, tags, format.view(), args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void info(std::initializer_list<std::string_view> tags, FormatFor<Args...> format, const Args&... args) {
+        log(LogLevel::INFO, tags, format, args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void warn(TagSet tags, FormatFor<Args...> format, const Args&... args) {
+        logFormat(LogLevel::WARN, tags, format.view(), args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void warn(std::initializer_list<std::string_view> tags, FormatFor<Args...> format, const Args&... args) {
+        log(LogLevel::WARN, tags, format, args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void error(TagSet tags, FormatFor<Args...> format, const Args&... args) {
+        logFormat(LogLevel::ERROR, tags, format.view(), args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void error(std::initializer_list<std::string_view> tags, FormatFor<Args...> format, const Args&... args) {
+        log(LogLevel::ERROR, tags, format, args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void fatal(TagSet tags, FormatFor<Args...> format, const Args&... args) {
+        logFormat(LogLevel::FATAL, tags, format.view(), args...);
+    }
+    template <typename... Args>
+        requires(sizeof...(Args) > 0)
+    void fatal(std::initializer_list<std::string_view> tags, FormatFor<Args...> format, const Args&... args) {
+        log(LogLevel::FATAL, tags, format, args...);
+    }
+
 private:
+    // 异步模式下在队列中传递的日志记录
+    // 驻留的标签集合直接传递句柄，其余标签在入队时预渲染为 "[a b] " 文本
+    struct LogRecord {
+        LogLevel level = LogLevel::INFO;
+        TagSet tagSet;
+        std::string tagText;
+        std::string message;
+        int64_t time = 0;  // 自 Unix 纪元以来的纳秒数
+        // 带类型参数的日志：message 为二进制编码的参数，由写线程按 format 渲染；
+        // format 指向字符串字面量或调用点描述符，生命周期足够长
+        std::string_view format;
+        bool formatted = false;
+    };
+
     Logger();
     ~Logger();
     
@@ -69,23 +484,303 @@ private:
     Logger(Logger&&) = delete;
     Logger& operator=(Logger&&) = delete;
 
-    // 实际输出日志的函数
-    void writeLog(const std::string& logEntry);
-    
+    // 已注册的输出目标；列表只读，修改时整体替换
+    struct SinkEntry {
+        SinkId id;
+        std::shared_ptr<detail::SinkWorker> worker;
+    };
+    using SinkList = std::vector<SinkEntry>;
+
+    // 格式化好的一行经过重复合并后交给 writeSinks
+    void writeLog(std::string_view logEntry, LogLevel level);
+
+    // 将一行分发给所有接受该级别的 sink
+    void writeSinks(std::string_view logEntry, LogLevel level);
+
+    // 输出合并窗口内的重复次数（text 为不含时间戳的整行）
+    void writeRepeated(std::string_view text, LogLevel level, uint64_t count);
+    void sweepDedup(detail::DedupTable& table, bool force);
+
+    // sink 列表的增删（调用方持有 mutex_）
+    SinkId addSinkLocked(std::shared_ptr<Sink> sink, const SinkOptions& options);
+    bool removeSinkLocked(SinkId id);
+    std::shared_ptr<Sink> makeFileSinkLocked(const std::string& filename, const RotationPolicy& rotation);
+    void publishSinksLocked(SinkList list);
+
+    // 替换分片输出集合（shards 为空表示关闭），关闭旧集合（调用方持有 mutex_）
+    void publishShardsLocked(std::shared_ptr<detail::ShardSet> shards);
+
+    // 按给定时间点将日志追加格式化到 out；Tags 可以是 TagSet、标签数组或预渲染文本
+    template <typename Tags>
+    void formatInto(std::string& out, LogLevel level, const Tags& tags, std::string_view message, int64_t time);
+
+    // 所有 log 重载的公共实现：级别与限流检查后写入飞行记录器并交给 dispatch。
+    // Message 为消息文本，或格式串加编码后的参数（需要文本时才渲染）
+    template <typename Tags, typename Message>
+    void logImpl(LogLevel level, const Tags& tags, const Message& message);
+
+    // 同步模式下格式化并分发，异步模式下入队；time 为日志时间（自 Unix 纪元以来的纳秒数）
+    template <typename Tags, typename Message>
+    void dispatch(LogLevel level, const Tags& tags, const Message& message, int64_t time);
+
+    // 写入飞行记录器（未开启或级别不足时只有一次原子读取）
+    template <typename Tags, typename Message>
+    void record(LogLevel level, const Tags& tags, const Message& message, int64_t time);
+
+    // 带类型参数的日志：在调用线程编码参数，之后与普通日志走相同的路径
+    template <typename Tags, typename... Args>
+    void logFormat(LogLevel level, const Tags& tags, std::string_view format, const Args&... args) {
+        if (!shouldLog(level)) {
+            return;
+        }
+        if (levelRules_.load(std::memory_order_relaxed) != nullptr && !acceptsLevel(level, tags)) {
+            return;
+        }
+        std::string& buffer = argBuffer();
+        buffer.clear();
+        binary::encodeArgs(buffer, args...);
+        logArgs(level, tags, format, buffer);
+    }
+    void logArgs(LogLevel level, TagSet tags, std::string_view format, std::string_view args);
+    void logArgs(LogLevel level, std::span<const std::string_view> tags, std::string_view format,
+                 std::string_view args);
+
+    // 是否达到输出级别（shouldLog 还包含只写入飞行记录器的级别）
+    static bool isOutputLevel(LogLevel level) {
+        return static_cast<int>(level) >= outputLevel_.load(std::memory_order_relaxed);
+    }
+
+    // 考虑标签级别后是否达到输出级别
+    bool isOutputLevel(LogLevel level, TagSet tags);
+
+    // 考虑标签级别后是否需要处理（输出或写入飞行记录器），供带参数的日志在编码参数之前检查
+    bool acceptsLevel(LogLevel level, TagSet tags);
+    bool acceptsLevel(LogLevel level, std::span<const std::string_view> tags);
+    template <typename Tags>
+    bool isOutputLevel(LogLevel level, const Tags& tags);
+
+    // 按输出级别、标签级别与飞行记录器级别重新计算 minLevel_（调用方持有 mutex_）
+    void publishLevelsLocked();
+
+    // 替换飞行记录器（recorder 为空表示关闭），释放已没有写入方的旧记录器（调用方持有 mutex_）
+    void publishRecorderLocked(std::unique_ptr<detail::FlightRecorder> recorder);
+
+    // 限流规则表：只读，修改时整体替换；没有任何标签规则时为空指针
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view text) const { return std::hash<std::string_view>()(text); }
+    };
+    struct RateRules {
+        uint32_t generation = 0;
+        std::vector<RateLimiter*> limiters;
+        std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> byTag;  // 标签 -> 序号
+    };
+
+    // 查找一组标签对应的限流器，没有规则时返回空指针
+    RateLimiter* findTagLimiter(const RateRules& rules, TagSet tags);
+    template <typename Range>
+    RateLimiter* findTagLimiter(const RateRules& rules, const Range& tags);
+
+    // 标签级别表：只读，修改时整体替换；没有任何标签级别时为空指针
+    struct LevelRules {
+        uint32_t generation = 0;
+        int minLevel = static_cast<int>(LogLevel::FATAL);  // 各标签级别中最低的一个
+        int maxLevel = static_cast<int>(LogLevel::DEBUG);  // 各标签级别中最高的一个
+        std::unordered_map<std::string, int, StringHash, std::equal_to<>> byTag;  // 标签 -> 级别
+    };
+
+    // 一组标签中第一个设置了级别的标签的级别，没有时返回 -1
+    int findTagLevel(const LevelRules& rules, TagSet tags);
+    template <typename Range>
+    int findTagLevel(const LevelRules& rules, const Range& tags);
+
+    void publishLevelRulesLocked(std::unique_ptr<LevelRules> rules);
+    bool applyLevelConfig(const std::string& text, const std::string& path);
+
+    // 到达统计输出时间时输出统计行；只有一个线程能占用本次输出
+    void reportMetrics(int64_t now);
+
+    // 汇总统计；wait 为 false 时不等待 mutex_，取不到锁则跳过 sink 状态与重复合并计数
+    void collectMetrics(MetricsSnapshot& out, bool wait);
+
+    // 已确认需要输出的日志经过限流器；放行且有未汇总的丢弃行时先输出汇总行
+    bool admitOutput(RateLimiter& limiter);
+    bool admitCallSite(const CallSite& site);
+    void reportSuppressed(RateLimiter& limiter, int64_t now, bool force);
+    void reportAllSuppressed();
+    void publishRateRulesLocked(std::unique_ptr<RateRules> rules);
+    RateLimiter& createRateLimiterLocked(const RateLimit& limit, std::string label, std::string tagPrefix);
+    void reclaimRateLimitersLocked();
+
+    // 延迟格式化日志：写入二进制文件，或在本地渲染后按普通日志输出
+    void writeDeferred(const CallSite& site, std::string_view args);
+    static std::string& argBuffer();
+
+    // 异步模式：入队与后台写线程
+    void enqueue(LogRecord&& record);
+    void writerLoop();
+    void stopWriter();
+
     // 将日志级别转换为字符串
-    std::string levelToString(LogLevel level);
+    static std::string_view levelToString(LogLevel level);
     
-    // 生成ISO 8601格式的时间戳
-    std::string generateTimestamp();
+    // 追加ISO 8601格式的时间戳
+    void appendTimestamp(std::string& out, int64_t time);
     
-    // 转义消息中的特殊字符
-    std::string escapeMessage(const std::string& message);
+    // 转义消息中的特殊字符并追加到 out
+    static void appendEscaped(std::string& out, std::string_view message);
 
-    std::ofstream outputFile_;
-    bool consoleOutput_;
+    // 当前 sink 列表：生产者在线程槽位中登记正在使用的列表，被替换的列表在没有读取方后释放，
+    // 因此读取方无需引用计数（由 mutex_ 保护）
+    std::atomic<const SinkList*> sinks_{nullptr};
+    std::unique_ptr<SinkList> sinkList_;
+    std::vector<std::unique_ptr<SinkList>> retiredSinkLists_;
+
+    // 以下由 mutex_ 保护
     std::mutex mutex_;
+    SinkId nextSinkId_ = 1;
+    SinkId consoleSink_ = 0;
+    SinkId fileSink_ = 0;
+    std::string outputPath_;
+    RotationPolicy rotation_;
+    FlushPolicy flushPolicy_;
+    TimestampEngine timestamps_;
+
+    // 运行期最低处理级别与输出级别（Logger 为单例，静态存储使 shouldLog 无需取实例）；
+    // minLevel_ 为输出级别与飞行记录器级别中较低的一个
+    static inline std::atomic<int> minLevel_{static_cast<int>(LogLevel::DEBUG)};
+    static inline std::atomic<int> outputLevel_{static_cast<int>(LogLevel::DEBUG)};
+
+    // 异步模式状态
+    std::atomic<bool> async_{false};
+    OverflowPolicy overflowPolicy_ = OverflowPolicy::Block;
+    std::unique_ptr<BoundedMpscQueue<LogRecord>> queue_;
+    std::thread writer_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> writerSleeping_{false};
+    std::atomic<uint64_t> enqueued_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    std::condition_variable flushedCv_;
+
+    // 分片输出：Logger 只持有当前集合，写入方在线程槽位中登记正在使用的集合；被替换的集合在没有
+    // 槽位指向后由各线程的分片绑定持有，最后一个绑定释放时析构（由 mutex_ 保护）
+    std::atomic<detail::ShardSet*> shards_{nullptr};
+    std::shared_ptr<detail::ShardSet> shardSet_;
+    std::vector<std::shared_ptr<detail::ShardSet>> retiredShardSets_;
+
+    // 标签驻留表，以渲染后的前缀为键；条目在 Logger 生命周期内不会释放
+    std::mutex tagMutex_;
+    std::unordered_map<std::string, std::unique_ptr<TagSet::Data>> tagRegistry_;
+
+    // 重复合并表：被替换的表保留到 Logger 析构（由 mutex_ 保护）
+    std::atomic<detail::DedupTable*> dedup_{nullptr};
+    std::vector<std::unique_ptr<detail::DedupTable>> dedupTables_;
+
+    // 飞行记录器：写入方在线程槽位中登记正在使用的记录器，被替换或关闭的记录器在没有写入方后释放
+    // （由 mutex_ 保护）
+    std::atomic<detail::FlightRecorder*> recorder_{nullptr};
+    std::unique_ptr<detail::FlightRecorder> flightRecorder_;
+    std::vector<std::unique_ptr<detail::FlightRecorder>> retiredRecorders_;
+
+    // 标签级别表：读取方在线程槽位中登记正在使用的表，被替换的表在没有读取方后释放（由 mutex_ 保护）
+    std::atomic<const LevelRules*> levelRules_{nullptr};
+    std::unique_ptr<LevelRules> levelRuleTable_;
+    std::vector<std::unique_ptr<LevelRules>> retiredLevelRules_;
+    uint32_t levelGeneration_ = 0;
+
+    // 级别配置文件的监视线程（由 watchMutex_ 保护，重新加载时取 mutex_，因此停止监视时不能持有 mutex_）
+    std::mutex watchMutex_;
+    std::unique_ptr<detail::ConfigWatcher> configWatcher_;
+
+    // 限流状态（由 rateMutex_ 保护）：读取方在线程槽位中登记正在使用的规则表与调用点限流器，
+    // 被替换的规则表在没有读取方后释放；规则限流器不再被任何表、调用点或槽位引用时，
+    // 输出未汇总的计数后释放。rateLimiters_ 为宏注册的限流器，在 Logger 生命周期内不会释放
+    std::atomic<const RateRules*> rateRules_{nullptr};
+    std::mutex rateMutex_;
+    std::unique_ptr<RateRules> rateRuleTable_;
+    std::vector<std::unique_ptr<RateRules>> retiredRateRules_;
+    std::vector<std::unique_ptr<RateLimiter>> rateLimiters_;
+    std::vector<std::unique_ptr<RateLimiter>> ruleLimiters_;
+    std::vector<const CallSite*> sites_;                    // 设置了限流器的调用点
+    std::vector<const RateLimiter*> retiredSiteLimiters_;  // 被替换、可能仍被读取的调用点限流器
+    uint32_t rateGeneration_ = 0;
+    std::atomic<int64_t> reportInterval_{10'000'000'000};  // 纳秒
+    std::atomic<uint64_t> suppressedReported_{0};
+
+    // 周期统计输出：metricsNext_ 为下次输出的时间（纳秒），0 表示关闭；
+    // metricsPrevious_ 为上次输出时的快照，由 metricsMutex_ 保护
+    std::atomic<int64_t> metricsInterval_{0};
+    std::atomic<int64_t> metricsNext_{0};
+    std::mutex metricsMutex_;
+    MetricsSnapshot metricsPrevious_;
+
+    // 调用点描述符，编号即下标；条目在 Logger 生命周期内不会释放
+    std::mutex callSiteMutex_;
+    std::vector<std::unique_ptr<CallSite>> callSites_;
+
+    // 二进制输出状态，binaryGeneration_ 每打开一次文件加一，用于判断描述符是否已写入
+    std::atomic<bool> binary_{false};
+    std::mutex binaryMutex_;
+    std::ofstream binaryFile_;
+    uint64_t binaryGeneration_ = 0;
+    int64_t binaryLastTime_ = 0;
+    TimestampPrecision binaryPrecision_ = TimestampPrecision::Milliseconds;
 };
 
 } // namespace m3log
 
+// 日志宏：级别低于 M3LOG_ACTIVE_LEVEL 时整条语句在编译期移除；
+// 运行期级别未开启时只有一次原子读取，标签与消息参数都不会被求值
+// 用法：M3LOG_INFO({"app", "init"}, "启动完成, pid=" + std::to_string(pid));
+#define M3LOG_LOG(level, ...)                                                  \
+    do {                                                                       \
+        if constexpr (static_cast<int>(level) >= M3LOG_ACTIVE_LEVEL) {         \
+            if (::m3log::Logger::shouldLog(level)) {                           \
+                ::m3log::Logger::instance().log(level, __VA_ARGS__);           \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+// 延迟格式化日志宏：调用点描述符在第一次执行时注册，之后每次只编码参数
+// 用法：M3LOG_DEFERRED(::m3log::LogLevel::INFO, dbTags, "query {} took {} ms", id, elapsed);
+// tags 为 TagSet 表达式，只在注册时求值一次
+#define M3LOG_DEFERRED(level, tags, format, ...)                                                 \
+    do {                                                                                         \
+        if constexpr (static_cast<int>(level) >= M3LOG_ACTIVE_LEVEL) {                           \
+            if (::m3log::Logger::shouldLog(level)) {                                             \
+                static const ::m3log::CallSite& m3logCallSite_ =                                 \
+                    ::m3log::Logger::instance().registerCallSite(level, tags, format);           \
+                ::m3log::Logger::instance().logDeferred(m3logCallSite_ __VA_OPT__(, ) __VA_ARGS__);\
+            }                                                                                    \
+        }                                                                                        \
+    } while (0)
+
+#define M3LOG_STRINGIFY_IMPL(x) #x
+#define M3LOG_STRINGIFY(x) M3LOG_STRINGIFY_IMPL(x)
+
+// 带调用点限流的日志宏：limit 为 RateLimit 表达式，只在第一次执行时求值；
+// 汇总行以 "文件:行号" 标识调用点。标签规则同样生效
+// 用法：M3LOG_LOG_LIMITED(::m3log::LogLevel::ERROR, ::m3log::RateLimit::perSecond(10), {"db"}, "query failed");
+#define M3LOG_LOG_LIMITED(level, limit, ...)                                                    \
+    do {                                                                                        \
+        if constexpr (static_cast<int>(level) >= M3LOG_ACTIVE_LEVEL) {                          \
+            if (::m3log::Logger::shouldLog(level)) {                                            \
+                static ::m3log::RateLimiter& m3logLimiter_ = ::m3log::Logger::instance()        \
+                    .registerRateLimiter(limit, __FILE__ ":" M3LOG_STRINGIFY(__LINE__));        \
+                if (::m3log::Logger::instance().admit(m3logLimiter_, level)) {                  \
+                    ::m3log::Logger::instance().log(level, __VA_ARGS__);                        \
+                }                                                                               \
+            }                                                                                   \
+        }                                                                                       \
+    } while (0)
+
+#define M3LOG_DEBUG(...) M3LOG_LOG(::m3log::LogLevel::DEBUG, __VA_ARGS__)
+#define M3LOG_INFO(...)  M3LOG_LOG(::m3log::LogLevel::INFO, __VA_ARGS__)
+#define M3LOG_WARN(...)  M3LOG_LOG(::m3log::LogLevel::WARN, __VA_ARGS__)
+#define M3LOG_ERROR(...) M3LOG_LOG(::m3log::LogLevel::ERROR, __VA_ARGS__)
+#define M3LOG_FATAL(...) M3LOG_LOG(::m3log::LogLevel::FATAL, __VA_ARGS__)
+
 #endif // M3LOG_HH
\ No newline at end of file
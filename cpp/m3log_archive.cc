@@ -0,0 +1,299 @@
+#include "m3log_archive.hh"
+#include "m3log_writer.hh"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include <fcntl.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(M3LOG_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace m3log {
+namespace detail {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kRotatingInfix = ".rotating.";
+
+// 把当前线程降到最低 CPU 优先级与空闲 I/O 调度类，压缩不与业务线程争抢资源
+void lowerThreadPriority() {
+#if defined(__linux__)
+    pid_t tid = static_cast<pid_t>(::syscall(SYS_gettid));
+    ::setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 19);
+
+    constexpr int kIoprioWhoProcess = 1;
+    constexpr int kIoprioClassIdle = 3;
+    constexpr int kIoprioClassShift = 13;
+    ::syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, kIoprioClassIdle << kIoprioClassShift);
+#endif
+}
+
+#if defined(M3LOG_HAVE_ZLIB)
+// 将 from 压缩为 gzip 文件 to，成功返回 true
+bool gzipFile(const std::string& from, const std::string& to) {
+    int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    gzFile out = gzopen(to.c_str(), "wb6");
+    if (!out) {
+        ::close(in);
+        return false;
+    }
+
+    std::vector<char> buffer(256 * 1024);
+    bool ok = true;
+    off_t done = 0;
+    for (;;) {
+        ssize_t n = ::read(in, buffer.data(), buffer.size());
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        if (gzwrite(out, buffer.data(), static_cast<unsigned>(n)) != static_cast<int>(n)) {
+            ok = false;
+            break;
+        }
+#if defined(POSIX_FADV_DONTNEED)
+        // 已压缩的数据不会再读，及时释放页缓存，避免挤掉业务进程的热数据
+        ::posix_fadvise(in, done, n, POSIX_FADV_DONTNEED);
+#endif
+        done += n;
+    }
+
+    ::close(in);
+    return gzclose(out) == Z_OK && ok;
+}
+#endif
+
+} // namespace
+
+LogArchiver::LogArchiver(const std::string& path, size_t maxFiles, bool compress, uint64_t preallocateBytes)
+    : path_(path),
+      nextPath_(path + ".next"),
+      maxFiles_(maxFiles),
+#if defined(M3LOG_HAVE_ZLIB)
+      compress_(compress),
+#else
+      compress_(false),
+#endif
+      preallocateBytes_(preallocateBytes) {
+    (void)compress;
+#if defined(_WIN32)
+    // Windows 下不预先创建文件：已打开的文件无法被重命名
+    preallocateBytes_ = 0;
+#endif
+    prepareRequested_ = preallocateBytes_ > 0;
+    thread_ = std::thread(&LogArchiver::run, this);
+}
+
+LogArchiver::~LogArchiver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+
+    if (nextFd_ >= 0) {
+#if !defined(_WIN32)
+        ::close(nextFd_);
+#endif
+        std::error_code ec;
+        fs::remove(nextPath_, ec);
+    }
+}
+
+std::string LogArchiver::rotatedName() const {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return path_ + kRotatingInfix + std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void LogArchiver::submit(const std::string& rotatedPath) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(rotatedPath);
+    }
+    cv_.notify_one();
+}
+
+int LogArchiver::takeNextFile() {
+    int fd;
+    {
+        // 在锁内完成重命名，后台线程不会在此之前重新创建 nextPath_
+        std::lock_guard<std::mutex> lock(mutex_);
+        fd = nextFd_;
+        nextFd_ = -1;
+        prepareRequested_ = preallocateBytes_ > 0;
+#if !defined(_WIN32)
+        if (fd >= 0 && std::rename(nextPath_.c_str(), path_.c_str()) != 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+    cv_.notify_one();
+    return fd;
+}
+
+void LogArchiver::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idleCv_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+}
+
+void LogArchiver::run() {
+    lowerThreadPriority();
+    recover();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    busy_ = false;
+    for (;;) {
+        cv_.wait(lock, [this] { return stopping_ || prepareRequested_ || !jobs_.empty(); });
+
+        // 先准备下一个文件，保证下次轮转尽快可用；退出时剩余的归档任务仍会完成
+        if (prepareRequested_ && !stopping_) {
+            prepareRequested_ = false;
+            busy_ = true;
+            lock.unlock();
+            prepareNext();
+            lock.lock();
+        } else if (!jobs_.empty()) {
+            std::string job = std::move(jobs_.front());
+            jobs_.pop_front();
+            busy_ = true;
+            lock.unlock();
+            archive(job);
+            lock.lock();
+        } else if (stopping_) {
+            break;
+        }
+
+        busy_ = false;
+        if (jobs_.empty()) {
+            idleCv_.notify_all();
+        }
+    }
+}
+
+void LogArchiver::prepareNext() {
+#if !defined(_WIN32)
+    int fd = ::open(nextPath_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    preallocateFile(fd, preallocateBytes_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (nextFd_ >= 0) {
+        ::close(nextFd_);
+    }
+    nextFd_ = fd;
+#endif
+}
+
+void LogArchiver::archive(const std::string& rotatedPath) {
+    std::error_code ec;
+    if (maxFiles_ == 0) {
+        fs::remove(rotatedPath, ec);
+        return;
+    }
+
+    // 释放预分配但未写入的尾部空间
+    if (preallocateBytes_ > 0) {
+        uintmax_t size = fs::file_size(rotatedPath, ec);
+        if (!ec) {
+            fs::resize_file(rotatedPath, size, ec);
+        }
+    }
+
+    std::string source = rotatedPath;
+    bool gz = false;
+#if defined(M3LOG_HAVE_ZLIB)
+    if (compress_) {
+        std::string compressed = rotatedPath + ".gz";
+        if (gzipFile(rotatedPath, compressed)) {
+            source = compressed;
+            gz = true;
+        } else {
+            fs::remove(compressed, ec);
+        }
+    }
+#endif
+
+    // path.N 被删除，path.N-1 -> path.N ... path.1 -> path.2（压缩与未压缩的文件分别移动）
+    for (size_t i = maxFiles_; i >= 1; --i) {
+        for (bool variant : {false, true}) {
+            std::string from = chainPath(i, variant);
+            if (i == maxFiles_) {
+                fs::remove(from, ec);
+            } else {
+                fs::rename(from, chainPath(i + 1, variant), ec);
+            }
+        }
+    }
+    fs::rename(source, chainPath(1, gz), ec);
+    if (gz) {
+        fs::remove(rotatedPath, ec);
+    }
+}
+
+void LogArchiver::recover() {
+    // 进程上次退出前未归档的文件：按轮转时间顺序重新归档；残留的半成品压缩文件与预创建文件直接删除
+    std::error_code ec;
+    fs::path path(path_);
+    fs::path dir = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    std::string prefix = path.filename().string() + kRotatingInfix;
+
+    std::vector<std::string> leftovers;
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) {
+            fs::remove(entry.path(), ec);
+        } else {
+            leftovers.push_back(entry.path().string());
+        }
+    }
+    std::sort(leftovers.begin(), leftovers.end());
+
+    fs::remove(nextPath_, ec);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 本进程启动后已提交的任务也会被扫描到，跳过它们
+    leftovers.erase(std::remove_if(leftovers.begin(), leftovers.end(),
+                                   [this](const std::string& name) {
+                                       return std::find(jobs_.begin(), jobs_.end(), name) != jobs_.end();
+                                   }),
+                    leftovers.end());
+    jobs_.insert(jobs_.begin(), leftovers.begin(), leftovers.end());
+}
+
+std::string LogArchiver::chainPath(size_t index, bool gz) const {
+    return path_ + "." + std::to_string(index) + (gz ? ".gz" : "");
+}
+
+} // namespace detail
+} // namespace m3log
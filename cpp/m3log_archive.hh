@@ -0,0 +1,68 @@
+#ifndef M3LOG_ARCHIVE_HH
+#define M3LOG_ARCHIVE_HH
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace m3log {
+namespace detail {
+
+// 轮转日志的后台归档线程（以最低 CPU / I/O 优先级运行）
+// 负责：按保留数量移动 path.1 ... path.N 链、压缩为 .gz、为下一个日志文件预先创建并预分配空间。
+// 轮转时写线程只需做两次 rename，耗时的工作都在这里完成
+class LogArchiver {
+public:
+    LogArchiver(const std::string& path, size_t maxFiles, bool compress, uint64_t preallocateBytes);
+    ~LogArchiver();
+
+    LogArchiver(const LogArchiver&) = delete;
+    LogArchiver& operator=(const LogArchiver&) = delete;
+
+    // 为刚轮转出的文件生成一个不会冲突的临时名称（path.rotating.<纳秒时间>）
+    std::string rotatedName() const;
+
+    // 提交已重命名为 rotatedName() 的文件，后台将其放入保留链
+    void submit(const std::string& rotatedPath);
+
+    // 将预先创建好的下一个文件重命名为 path 并返回其描述符（追加方式打开），尚未就绪时返回 -1
+    int takeNextFile();
+
+    // 是否启用了压缩（未以 M3LOG_HAVE_ZLIB 编译时始终为 false）
+    bool compressing() const { return compress_; }
+
+    // 等待已提交的归档任务全部完成
+    void waitIdle();
+
+private:
+    void run();
+    void archive(const std::string& rotatedPath);
+    void prepareNext();
+    void recover();
+    std::string chainPath(size_t index, bool gz) const;
+
+    std::string path_;
+    std::string nextPath_;
+    size_t maxFiles_;
+    bool compress_;
+    uint64_t preallocateBytes_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idleCv_;
+    std::deque<std::string> jobs_;
+    bool busy_ = true;  // 启动时的遗留文件扫描完成前视为忙
+    bool prepareRequested_ = true;
+    bool stopping_ = false;
+    int nextFd_ = -1;
+    std::thread thread_;
+};
+
+} // namespace detail
+} // namespace m3log
+
+#endif // M3LOG_ARCHIVE_HH
@@ -0,0 +1,111 @@
+#include "m3log_binary.hh"
+#include <charconv>
+
+namespace m3log::binary {
+
+namespace {
+
+void appendValue(std::string& out, const ArgValue& value) {
+    char buf[32];
+    std::to_chars_result result{buf, std::errc()};
+    switch (value.type) {
+        case ArgType::Int:    result = std::to_chars(buf, buf + sizeof(buf), value.i); break;
+        case ArgType::UInt:   result = std::to_chars(buf, buf + sizeof(buf), value.u); break;
+        case ArgType::Double: result = std::to_chars(buf, buf + sizeof(buf), value.d); break;
+        case ArgType::Bool:   out.append(value.u ? "true" : "false"); return;
+        case ArgType::Char:   out.push_back(static_cast<char>(value.u)); return;
+        case ArgType::String: out.append(value.s); return;
+    }
+    out.append(buf, result.ptr);
+}
+
+} // namespace
+
+bool getVarint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool decodeArgs(std::string_view data, std::span<ArgValue> values, size_t& count) {
+    const char* p = data.data();
+    const char* end = p + data.size();
+    count = 0;
+    while (p < end) {
+        if (count == values.size()) {
+            return false;
+        }
+        ArgValue& value = values[count];
+        value.type = static_cast<ArgType>(*p++);
+        uint64_t raw = 0;
+        switch (value.type) {
+            case ArgType::Int:
+                if (!getVarint(p, end, raw)) return false;
+                value.i = unzigzag(raw);
+                break;
+            case ArgType::UInt:
+                if (!getVarint(p, end, value.u)) return false;
+                break;
+            case ArgType::Double:
+                if (end - p < static_cast<ptrdiff_t>(sizeof(double))) return false;
+                std::memcpy(&value.d, p, sizeof(double));
+                p += sizeof(double);
+                break;
+            case ArgType::Bool:
+            case ArgType::Char:
+                if (p == end) return false;
+                value.u = static_cast<uint8_t>(*p++);
+                break;
+            case ArgType::String:
+                if (!getVarint(p, end, raw) || raw > static_cast<uint64_t>(end - p)) return false;
+                value.s = std::string_view(p, raw);
+                p += raw;
+                break;
+            default:
+                return false;
+        }
+        ++count;
+    }
+    return true;
+}
+
+void renderFormat(std::string& out, std::string_view format, std::span<const ArgValue> values) {
+    size_t next = 0;
+    size_t i = 0;
+    while (i < format.size()) {
+        size_t brace = format.find_first_of("{}", i);
+        if (brace == std::string_view::npos) {
+            out.append(format.substr(i));
+            break;
+        }
+        out.append(format.substr(i, brace - i));
+
+        char c = format[brace];
+        bool doubled = brace + 1 < format.size() && format[brace + 1] == c;
+        if (doubled) {
+            out.push_back(c);
+            i = brace + 2;
+        } else if (c == '{' && brace + 1 < format.size() && format[brace + 1] == '}' && next < values.size()) {
+            appendValue(out, values[next++]);
+            i = brace + 2;
+        } else {
+            out.push_back(c);
+            i = brace + 1;
+        }
+    }
+}
+
+void renderArgs(std::string& out, std::string_view format, std::string_view args) {
+    ArgValue values[kMaxArgs];
+    size_t count = 0;
+    decodeArgs(args, values, count);
+    renderFormat(out, format, std::span<const ArgValue>(values, count));
+}
+
+} // namespace m3log::binary
@@ -0,0 +1,142 @@
+#ifndef M3LOG_BINARY_HH
+#define M3LOG_BINARY_HH
+
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace m3log::binary {
+
+// 二进制日志文件格式
+//
+//   文件头:   "M3LB" 版本(1B) 时间戳精度(1B)
+//   描述符:   'D' id(varint) 级别(1B) 标签数(varint) {长度(varint) 字节}* 格式串长度(varint) 字节
+//   精度变更: 'P' 时间戳精度(1B)
+//   日志记录: 'E' id(varint) 时间差(zigzag varint, 纳秒) 参数长度(varint) 参数
+//
+// 描述符在某个调用点第一次写入当前文件时输出一次；时间差相对于同一文件的上一条记录
+inline constexpr char kMagic[4] = {'M', '3', 'L', 'B'};
+inline constexpr uint8_t kVersion = 1;
+inline constexpr char kDescriptorRecord = 'D';
+inline constexpr char kPrecisionRecord = 'P';
+inline constexpr char kEventRecord = 'E';
+
+// 参数类型标记，每个参数以 1 字节类型开头
+enum class ArgType : uint8_t {
+    Int = 1,    // 有符号整数，zigzag varint
+    UInt,       // 无符号整数，varint
+    Double,     // 8 字节 IEEE 754
+    Bool,       // 1 字节
+    Char,       // 1 字节
+    String      // 长度(varint) + 字节
+};
+
+// 解码后的参数，String 指向解码缓冲区
+struct ArgValue {
+    ArgType type = ArgType::Int;
+    int64_t i = 0;
+    uint64_t u = 0;
+    double d = 0;
+    std::string_view s;
+};
+
+// 格式串中允许的最大参数个数（文本回退路径在栈上解码）
+inline constexpr size_t kMaxArgs = 32;
+
+inline void putVarint(std::string& out, uint64_t value) {
+    char buf[10];
+    size_t n = 0;
+    while (value >= 0x80) {
+        buf[n++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = static_cast<char>(value);
+    out.append(buf, n);
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// 读取 varint，数据不完整时返回 false
+bool getVarint(const char*& p, const char* end, uint64_t& value);
+
+template <typename T>
+void encodeArg(std::string& out, const T& value) {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        out.push_back(static_cast<char>(ArgType::Bool));
+        out.push_back(value ? 1 : 0);
+    } else if constexpr (std::is_same_v<U, char>) {
+        out.push_back(static_cast<char>(ArgType::Char));
+        out.push_back(value);
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        out.push_back(static_cast<char>(ArgType::Int));
+        putVarint(out, zigzag(static_cast<int64_t>(value)));
+    } else if constexpr (std::is_integral_v<U> || std::is_enum_v<U>) {
+        if constexpr (std::is_enum_v<U>) {
+            encodeArg(out, static_cast<std::underlying_type_t<U>>(value));
+        } else {
+            out.push_back(static_cast<char>(ArgType::UInt));
+            putVarint(out, static_cast<uint64_t>(value));
+        }
+    } else if constexpr (std::is_floating_point_v<U>) {
+        double d = static_cast<double>(value);
+        char buf[sizeof(double)];
+        std::memcpy(buf, &d, sizeof(d));
+        out.push_back(static_cast<char>(ArgType::Double));
+        out.append(buf, sizeof(buf));
+    } else if constexpr (std::is_convertible_v<const U&, std::string_view>) {
+        std::string_view s(value);
+        out.push_back(static_cast<char>(ArgType::String));
+        putVarint(out, s.size());
+        out.append(s);
+    } else {
+        static_assert(sizeof(U) == 0, "m3log: unsupported deferred log argument type");
+    }
+}
+
+template <typename... Args>
+void encodeArgs(std::string& out, const Args&... args) {
+    (encodeArg(out, args), ...);
+}
+
+// 解码参数区，最多解码 values.size() 个；格式错误时返回 false
+bool decodeArgs(std::string_view data, std::span<ArgValue> values, size_t& count);
+
+// 按 "{}" 占位符依次代入参数追加到 out；"{{" 与 "}}" 输出单个花括号，
+// 多余的占位符原样保留，多余的参数被忽略
+void renderFormat(std::string& out, std::string_view format, std::span<const ArgValue> values);
+
+// 解码参数区并按 format 渲染，追加到 out
+void renderArgs(std::string& out, std::string_view format, std::string_view args);
+
+// 统计格式串中的 "{}" 占位符个数，规则与 renderFormat 相同，可在编译期求值
+constexpr size_t countPlaceholders(std::string_view format) {
+    size_t count = 0;
+    for (size_t i = 0; i < format.size(); ++i) {
+        char c = format[i];
+        if (c != '{' && c != '}') {
+            continue;
+        }
+        if (i + 1 < format.size() && format[i + 1] == c) {
+            ++i;
+        } else if (c == '{' && i + 1 < format.size() && format[i + 1] == '}') {
+            ++count;
+            ++i;
+        }
+    }
+    return count;
+}
+
+} // namespace m3log::binary
+
+#endif // M3LOG_BINARY_HH
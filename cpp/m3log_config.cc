@@ -0,0 +1,293 @@
+#include "m3log_config.hh"
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#if !defined(_WIN32)
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace m3log {
+
+namespace {
+
+// 没有 inotify 时检查文件的间隔
+constexpr int kPollIntervalMs = 1000;
+
+// 收到第一个事件后等待这么久没有新事件才读取文件：编辑器保存与符号链接切换会连续产生多个事件
+constexpr int kSettleMs = 50;
+
+std::string_view trim(std::string_view text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) {
+        ++begin;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+        --end;
+    }
+    return text.substr(begin, end - begin);
+}
+
+bool parseLevel(std::string_view text, LogLevel& level) {
+    static constexpr std::pair<std::string_view, LogLevel> kLevels[] = {
+        {"DEBUG", LogLevel::DEBUG}, {"INFO", LogLevel::INFO}, {"WARN", LogLevel::WARN},
+        {"ERROR", LogLevel::ERROR}, {"FATAL", LogLevel::FATAL},
+    };
+    for (const auto& [name, value] : kLevels) {
+        if (name.size() != text.size()) {
+            continue;
+        }
+        size_t i = 0;
+        while (i < text.size() && std::toupper(static_cast<unsigned char>(text[i])) == name[i]) {
+            ++i;
+        }
+        if (i == text.size()) {
+            level = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+#if !defined(_WIN32)
+// SIGHUP 处理函数只向监视线程的管道写一个字节（异步信号安全），之后调用原来的处理函数
+std::atomic<int> sighupFd{-1};
+struct sigaction previousSighup;
+
+void onSighup(int signal, siginfo_t* info, void* context) {
+    int savedErrno = errno;
+    int fd = sighupFd.load(std::memory_order_relaxed);
+    if (fd >= 0) {
+        char byte = 'h';
+        [[maybe_unused]] ssize_t written = ::write(fd, &byte, 1);
+    }
+    errno = savedErrno;
+
+    if (previousSighup.sa_flags & SA_SIGINFO) {
+        if (previousSighup.sa_sigaction) {
+            previousSighup.sa_sigaction(signal, info, context);
+        }
+    } else if (previousSighup.sa_handler != SIG_DFL && previousSighup.sa_handler != SIG_IGN) {
+        previousSighup.sa_handler(signal);
+    }
+}
+#endif
+
+} // namespace
+
+bool parseLevelConfig(std::string_view text, LevelConfig& out, std::string& error) {
+    out = LevelConfig();
+    size_t lineNumber = 0;
+    while (!text.empty()) {
+        ++lineNumber;
+        size_t newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            error = "line " + std::to_string(lineNumber) + ": expected \"tag = LEVEL\"";
+            return false;
+        }
+        std::string_view tag = trim(line.substr(0, equals));
+        std::string_view levelText = trim(line.substr(equals + 1));
+        bool validTag = !tag.empty();
+        for (char c : tag) {
+            validTag = validTag && !std::isspace(static_cast<unsigned char>(c)) && c != '[' && c != ']';
+        }
+        if (!validTag) {
+            error = "line " + std::to_string(lineNumber) + ": invalid tag \"" + std::string(tag) + "\"";
+            return false;
+        }
+        LogLevel level;
+        if (!parseLevel(levelText, level)) {
+            error = "line " + std::to_string(lineNumber) + ": unknown level \"" + std::string(levelText) + "\"";
+            return false;
+        }
+        if (tag == "*") {
+            out.hasDefault = true;
+            out.defaultLevel = level;
+        } else {
+            out.tags.emplace_back(std::string(tag), level);
+        }
+    }
+    return true;
+}
+
+namespace detail {
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+// ---- ConfigWatcher ----
+
+ConfigWatcher::ConfigWatcher(std::string path, const LevelWatchOptions& options, ReloadFn reload)
+    : path_(std::move(path)), options_(options), reload_(std::move(reload)) {
+    // 调用方已加载过当前内容，只有变化后才需要重新加载
+    loaded_ = readFile(path_, lastText_);
+
+#if !defined(_WIN32)
+    if (::pipe(wakeFds_) == 0) {
+        for (int fd : wakeFds_) {
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+    } else {
+        wakeFds_[0] = wakeFds_[1] = -1;
+    }
+#endif
+
+#if defined(__linux__)
+    if (options_.watchFile) {
+        // 监视所在目录而不是文件本身：原子替换（rename）后文件的 inode 已经变化
+        std::filesystem::path directory = std::filesystem::path(path_).parent_path();
+        inotifyFd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd_ >= 0 &&
+            ::inotify_add_watch(inotifyFd_, directory.empty() ? "." : directory.c_str(),
+                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+            ::close(inotifyFd_);
+            inotifyFd_ = -1;
+        }
+    }
+#endif
+
+#if !defined(_WIN32)
+    if (options_.reloadOnSighup && wakeFds_[1] >= 0) {
+        int expected = -1;
+        if (sighupFd.compare_exchange_strong(expected, wakeFds_[1])) {
+            struct sigaction action = {};
+            action.sa_sigaction = onSighup;
+            action.sa_flags = SA_SIGINFO | SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            ::sigaction(SIGHUP, &action, &previousSighup);
+        }
+    }
+#endif
+
+    thread_ = std::thread(&ConfigWatcher::run, this);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+#if !defined(_WIN32)
+    int fd = wakeFds_[1];
+    if (fd >= 0 && sighupFd.compare_exchange_strong(fd, -1)) {
+        ::sigaction(SIGHUP, &previousSighup, nullptr);
+    }
+#endif
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+#if !defined(_WIN32)
+    if (wakeFds_[1] >= 0) {
+        char byte = 'q';
+        [[maybe_unused]] ssize_t written = ::write(wakeFds_[1], &byte, 1);
+    }
+#endif
+    thread_.join();
+
+#if !defined(_WIN32)
+    for (int fd : {wakeFds_[0], wakeFds_[1], inotifyFd_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+void ConfigWatcher::run() {
+#if !defined(_WIN32)
+    if (wakeFds_[0] < 0) {
+        return;
+    }
+    for (;;) {
+        pollfd fds[2] = {{wakeFds_[0], POLLIN, 0}, {inotifyFd_, POLLIN, 0}};
+        nfds_t count = inotifyFd_ >= 0 ? 2 : 1;
+        int timeout = options_.watchFile && inotifyFd_ < 0 ? kPollIntervalMs : -1;
+        int ready = ::poll(fds, count, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        bool force = false;
+        if (fds[0].revents & POLLIN) {
+            char bytes[64];
+            ssize_t n = ::read(wakeFds_[0], bytes, sizeof(bytes));
+            for (ssize_t i = 0; i < n; ++i) {
+                if (bytes[i] == 'q') {
+                    return;
+                }
+                force = force || bytes[i] == 'h';
+            }
+        }
+
+        bool changed = ready == 0;  // 轮询超时
+#if defined(__linux__)
+        if (count == 2 && (fds[1].revents & POLLIN)) {
+            char events[4096];
+            pollfd settle = {inotifyFd_, POLLIN, 0};
+            do {
+                while (::read(inotifyFd_, events, sizeof(events)) > 0) {
+                }
+            } while (::poll(&settle, 1, kSettleMs) > 0);
+            changed = true;
+        }
+#endif
+        if (force || changed) {
+            check(force);
+        }
+    }
+#else
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cv_.wait_for(lock, std::chrono::milliseconds(kPollIntervalMs), [this] { return stopping_; })) {
+        if (options_.watchFile) {
+            lock.unlock();
+            check(false);
+            lock.lock();
+        }
+    }
+#endif
+}
+
+void ConfigWatcher::check(bool force) {
+    std::string text;
+    // 文件暂时不存在（正在被替换）时保留当前配置
+    if (!readFile(path_, text)) {
+        return;
+    }
+    if (!force && loaded_ && text == lastText_) {
+        return;
+    }
+    lastText_ = text;
+    loaded_ = true;
+    reload_(lastText_);
+}
+
+} // namespace detail
+} // namespace m3log
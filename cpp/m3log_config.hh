@@ -0,0 +1,79 @@
+#ifndef M3LOG_CONFIG_HH
+#define M3LOG_CONFIG_HH
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "m3log_level.hh"
+
+namespace m3log {
+
+// 运行期级别配置，文本格式为每行一条 "标签 = 级别"：
+//   # 注释
+//   * = INFO        全局输出级别（setMinLogLevel），可省略
+//   auth = DEBUG
+//   db = WARN
+// 级别不区分大小写，空行与 '#' 之后的内容被忽略
+struct LevelConfig {
+    bool hasDefault = false;
+    LogLevel defaultLevel = LogLevel::DEBUG;
+    std::vector<std::pair<std::string, LogLevel>> tags;
+};
+
+// 解析级别配置；失败时 error 为 "第 N 行: 原因"，out 不完整
+bool parseLevelConfig(std::string_view text, LevelConfig& out, std::string& error);
+
+// 配置文件的重新加载方式
+struct LevelWatchOptions {
+    bool watchFile = true;        // 文件变化时重新加载：Linux 上用 inotify 监视所在目录，其他平台每秒检查一次
+    bool reloadOnSighup = false;  // 收到 SIGHUP 时重新加载（安装进程级的信号处理函数，之前的处理函数仍会被调用）
+};
+
+namespace detail {
+
+// 配置文件监视线程：文件内容变化或收到 SIGHUP 时读取整个文件并交给 reload。
+// 目录被整体替换（编辑器的原子保存、符号链接切换）同样能感知；内容未变时不重复加载
+class ConfigWatcher {
+public:
+    using ReloadFn = std::function<void(const std::string& text)>;
+
+    ConfigWatcher(std::string path, const LevelWatchOptions& options, ReloadFn reload);
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+private:
+    void run();
+
+    // 读取文件，内容与上次不同（或 force）时调用 reload
+    void check(bool force);
+
+    std::string path_;
+    LevelWatchOptions options_;
+    ReloadFn reload_;
+    std::string lastText_;
+    bool loaded_ = false;
+
+    int wakeFds_[2] = {-1, -1};  // 停止与 SIGHUP 通知
+    int inotifyFd_ = -1;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// 读取整个文件，失败返回 false
+bool readFile(const std::string& path, std::string& out);
+
+} // namespace detail
+} // namespace m3log
+
+#endif // M3LOG_CONFIG_HH
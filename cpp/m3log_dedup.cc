@@ -0,0 +1,111 @@
+#include "m3log_dedup.hh"
+#include <functional>
+#include <thread>
+
+namespace m3log {
+namespace detail {
+
+namespace {
+
+size_t roundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+DedupTable::DedupTable(const DedupPolicy& policy)
+    : window_(std::chrono::duration_cast<std::chrono::nanoseconds>(policy.window).count()) {
+    // 容量不足一组时只用一组中的前几路；capacity 为 1 时即为“只合并连续重复”
+    size_t capacity = roundUpPowerOfTwo(policy.capacity > 0 ? policy.capacity : 1);
+    ways_ = capacity < 4 ? capacity : 4;
+    size_t buckets = capacity / ways_;
+    mask_ = buckets - 1;
+    buckets_ = std::make_unique<Bucket[]>(buckets);
+    texts_ = std::make_unique<std::string[]>(buckets * 4);
+}
+
+void DedupTable::lock(Bucket& bucket) {
+    while (bucket.lock.exchange(true, std::memory_order_acquire)) {
+        while (bucket.lock.load(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool DedupTable::takePending(Bucket& bucket, size_t way, std::string& text, LogLevel& level, uint64_t& count) {
+    Entry& entry = bucket.entries[way];
+    uint32_t pending = entry.count.load(std::memory_order_relaxed);
+    if (pending == 0) {
+        return false;
+    }
+    text.assign(texts_[static_cast<size_t>(&bucket - buckets_.get()) * 4 + way]);
+    level = entry.level;
+    count = pending;
+    entry.count.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+bool DedupTable::admit(std::string_view key, LogLevel level, int64_t now,
+                       std::string& pendingText, LogLevel& pendingLevel, uint64_t& pendingCount) {
+    pendingCount = 0;
+    if (key.size() > kMaxKeyLength) {
+        return true;
+    }
+
+    uint64_t hash = std::hash<std::string_view>()(key);
+    size_t index = static_cast<size_t>(hash) & mask_;
+    Bucket& bucket = buckets_[index];
+    std::string* texts = &texts_[index * 4];
+
+    lock(bucket);
+    size_t victim = 0;
+    for (size_t way = 0; way < ways_; ++way) {
+        Entry& entry = bucket.entries[way];
+        if (entry.used && entry.hash == hash && entry.level == level && texts[way] == key) {
+            if (now - entry.start < window_) {
+                entry.count.fetch_add(1, std::memory_order_relaxed);
+                unlock(bucket);
+                collapsed_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // 窗口已结束：输出上一窗口的重复次数，本行正常输出并开始新窗口
+            takePending(bucket, way, pendingText, pendingLevel, pendingCount);
+            entry.start = now;
+            unlock(bucket);
+            return true;
+        }
+        // 替换空条目或窗口开始最早的条目
+        if (!entry.used) {
+            victim = way;
+        } else if (bucket.entries[victim].used && entry.start < bucket.entries[victim].start) {
+            victim = way;
+        }
+    }
+
+    Entry& entry = bucket.entries[victim];
+    if (entry.used) {
+        takePending(bucket, victim, pendingText, pendingLevel, pendingCount);
+    }
+    entry.hash = hash;
+    entry.start = now;
+    entry.level = level;
+    entry.used = true;
+    texts[victim].assign(key);
+    unlock(bucket);
+    return true;
+}
+
+bool DedupTable::claimSweep(int64_t now) {
+    int64_t next = nextSweep_.load(std::memory_order_relaxed);
+    if (now < next) {
+        return false;
+    }
+    return nextSweep_.compare_exchange_strong(next, now + window_, std::memory_order_relaxed);
+}
+
+} // namespace detail
+} // namespace m3log
@@ -0,0 +1,128 @@
+#ifndef M3LOG_DEDUP_HH
+#define M3LOG_DEDUP_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "m3log_level.hh"
+
+namespace m3log {
+
+// 重复日志合并策略：窗口内与已输出的行完全相同（级别、标签、消息）的日志只计数，
+// 窗口结束或条目被替换时输出一行 "... (repeated N times)"
+struct DedupPolicy {
+    std::chrono::milliseconds window{1000};  // 合并窗口
+    size_t capacity = 4096;                  // 同时跟踪的不同日志行数（向上取整为 2 的幂）
+
+    // 只合并连续的重复行：出现不同的行时立即输出前一行的重复次数
+    static DedupPolicy consecutive(std::chrono::milliseconds window = std::chrono::milliseconds(1000)) {
+        DedupPolicy policy;
+        policy.window = window;
+        policy.capacity = 1;
+        return policy;
+    }
+
+    // 在窗口内合并最近 capacity 种不同的行
+    static DedupPolicy windowed(std::chrono::milliseconds window, size_t capacity = 4096) {
+        DedupPolicy policy;
+        policy.window = window;
+        policy.capacity = capacity;
+        return policy;
+    }
+};
+
+namespace detail {
+
+// 固定大小的组相联哈希表：每组 4 路，探测只访问一组的连续内存，组内以自旋锁保护。
+// 条目的文本缓冲在替换时复用容量，稳定状态下不分配内存
+class DedupTable {
+public:
+    // 超过该长度的行不参与合并，限制表的内存占用
+    static constexpr size_t kMaxKeyLength = 1024;
+
+    explicit DedupTable(const DedupPolicy& policy);
+
+    DedupTable(const DedupTable&) = delete;
+    DedupTable& operator=(const DedupTable&) = delete;
+
+    // 判断 key（不含时间戳的整行）是否需要输出；now 为单调时钟纳秒数。
+    // 该行替换了一个仍有未输出重复次数的条目，或自身的窗口已结束时，
+    // 把待输出的文本与次数写入 pendingText / pendingLevel / pendingCount
+    bool admit(std::string_view key, LogLevel level, int64_t now,
+               std::string& pendingText, LogLevel& pendingLevel, uint64_t& pendingCount);
+
+    // 是否到了周期检查的时间；返回 true 的调用方负责执行 sweep
+    bool claimSweep(int64_t now);
+
+    // 输出窗口已结束（force 时为全部）的重复次数，emit(text, level, count) 在组锁之外调用
+    template <typename Emit>
+    void sweep(int64_t now, bool force, Emit&& emit);
+
+    // 因重复而未输出的行数累计
+    uint64_t collapsedCount() const { return collapsed_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        int64_t start = 0;   // 当前窗口开始时间
+        std::atomic<uint32_t> count{0};  // 窗口内未输出的重复次数（加锁修改，sweep 可无锁粗查）
+        LogLevel level = LogLevel::INFO;
+        bool used = false;
+    };
+
+    struct alignas(64) Bucket {
+        std::atomic<bool> lock{false};
+        Entry entries[4];
+    };
+
+    void lock(Bucket& bucket);
+    static void unlock(Bucket& bucket) { bucket.lock.store(false, std::memory_order_release); }
+
+    // 取出条目的待输出次数；调用方持有组锁
+    bool takePending(Bucket& bucket, size_t way, std::string& text, LogLevel& level, uint64_t& count);
+
+    size_t ways_;
+    size_t mask_;
+    int64_t window_;
+    std::unique_ptr<Bucket[]> buckets_;
+    std::unique_ptr<std::string[]> texts_;  // 下标为 组号 * 4 + 路号
+    std::atomic<int64_t> nextSweep_{0};
+    std::atomic<uint64_t> collapsed_{0};
+};
+
+template <typename Emit>
+void DedupTable::sweep(int64_t now, bool force, Emit&& emit) {
+    thread_local std::string text;
+    for (size_t b = 0; b <= mask_; ++b) {
+        Bucket& bucket = buckets_[b];
+        for (size_t way = 0; way < ways_; ++way) {
+            // 先无锁粗查，只有可能需要输出的条目才加锁
+            if (bucket.entries[way].count.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            LogLevel level;
+            uint64_t count = 0;
+            lock(bucket);
+            bool due = force || now - bucket.entries[way].start >= window_;
+            bool pending = due && takePending(bucket, way, text, level, count);
+            if (pending) {
+                bucket.entries[way].start = now;
+            }
+            unlock(bucket);
+            if (pending) {
+                emit(std::string_view(text), level, count);
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+} // namespace m3log
+
+#endif // M3LOG_DEDUP_HH
@@ -0,0 +1,16 @@
+#ifndef M3LOG_LEVEL_HH
+#define M3LOG_LEVEL_HH
+
+namespace m3log {
+
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    FATAL
+};
+
+} // namespace m3log
+
+#endif // M3LOG_LEVEL_HH
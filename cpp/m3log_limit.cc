@@ -0,0 +1,131 @@
+#include "m3log_limit.hh"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace m3log {
+
+namespace {
+
+std::atomic<unsigned> nextStripe{0};
+
+// 每个线程固定使用一个计数槽
+size_t stripeIndex(size_t stripes) {
+    thread_local size_t index = nextStripe.fetch_add(1, std::memory_order_relaxed) % stripes;
+    return index;
+}
+
+// 线程私有的 xorshift64* 随机数，概率采样不需要共享状态
+uint64_t threadRandom() {
+    thread_local uint64_t state =
+        0x9E3779B97F4A7C15ull ^ (std::hash<std::thread::id>()(std::this_thread::get_id()) | 1);
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+} // namespace
+
+RateLimiter::RateLimiter(const RateLimit& limit, std::string label, std::string tagPrefix)
+    : sampleEvery_(limit.sampleEvery > 1 ? limit.sampleEvery : 0),
+      label_(std::move(label)),
+      tagPrefix_(std::move(tagPrefix)) {
+    if (limit.sampleProbability >= 1.0) {
+        sampleThreshold_ = std::numeric_limits<uint64_t>::max();
+    } else if (limit.sampleProbability <= 0.0) {
+        sampleThreshold_ = 0;
+    } else {
+        sampleThreshold_ = static_cast<uint64_t>(std::ldexp(limit.sampleProbability, 64));
+    }
+
+    if (limit.rate > 0) {
+        double burst = limit.burst > 0 ? limit.burst : limit.rate;
+        if (burst < 1) {
+            burst = 1;
+        }
+        interval_ = std::max<int64_t>(1, static_cast<int64_t>(1e9 / limit.rate));
+        tolerance_ = static_cast<int64_t>(burst * static_cast<double>(interval_));
+    }
+}
+
+int64_t RateLimiter::now() {
+#if defined(CLOCK_MONOTONIC_COARSE)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+bool RateLimiter::allow() {
+    Stripe& stripe = stripes_[stripeIndex(kStripes)];
+
+    if (sampleEvery_ != 0 && stripe.seen.fetch_add(1, std::memory_order_relaxed) % sampleEvery_ != 0) {
+        suppress(stripe);
+        return false;
+    }
+    if (sampleThreshold_ != std::numeric_limits<uint64_t>::max() && threadRandom() >= sampleThreshold_) {
+        suppress(stripe);
+        return false;
+    }
+
+    if (interval_ != 0) {
+        // GCRA：理论到达时间超出 now 的部分不能超过突发容量
+        int64_t now = RateLimiter::now();
+        int64_t tat = tat_.load(std::memory_order_relaxed);
+        for (;;) {
+            int64_t next = (tat > now ? tat : now) + interval_;
+            if (next - now > tolerance_) {
+                suppress(stripe);
+                return false;
+            }
+            if (tat_.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void RateLimiter::suppress(Stripe& stripe) {
+    stripe.suppressed.fetch_add(1, std::memory_order_relaxed);
+    if (!hasSuppressed_.load(std::memory_order_relaxed)) {
+        hasSuppressed_.store(true, std::memory_order_relaxed);
+    }
+}
+
+uint64_t RateLimiter::takeSuppressed() {
+    // 先清标志再取计数：之后的丢弃会重新置位，不会漏报
+    hasSuppressed_.store(false, std::memory_order_relaxed);
+    uint64_t total = 0;
+    for (Stripe& stripe : stripes_) {
+        total += stripe.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t RateLimiter::pendingSuppressed() const {
+    uint64_t total = 0;
+    for (const Stripe& stripe : stripes_) {
+        total += stripe.suppressed.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool RateLimiter::claimReport(int64_t now, int64_t interval) {
+    int64_t last = lastReport_.load(std::memory_order_relaxed);
+    if (last != 0 && now - last < interval) {
+        return false;
+    }
+    return lastReport_.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+} // namespace m3log
@@ -0,0 +1,103 @@
+#ifndef M3LOG_LIMIT_HH
+#define M3LOG_LIMIT_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace m3log {
+
+// 限流与采样规则：先采样，再经过令牌桶；FATAL 日志不受限制
+struct RateLimit {
+    double rate = 0;                 // 每秒允许的行数（令牌补充速率）；0 表示不限速
+    double burst = 0;                // 突发上限（桶容量）；0 表示与 rate 相同（至少为 1）
+    uint32_t sampleEvery = 0;        // 1/N 采样：每 N 行保留一行；0 或 1 表示不采样
+    double sampleProbability = 1.0;  // 概率采样：每行以该概率保留
+
+    // 令牌桶限速
+    static RateLimit perSecond(double rate, double burst = 0) {
+        RateLimit limit;
+        limit.rate = rate;
+        limit.burst = burst;
+        return limit;
+    }
+
+    // 每 n 行保留一行
+    static RateLimit oneIn(uint32_t n) {
+        RateLimit limit;
+        limit.sampleEvery = n;
+        return limit;
+    }
+
+    // 以概率 p 保留
+    static RateLimit sampled(double p) {
+        RateLimit limit;
+        limit.sampleProbability = p;
+        return limit;
+    }
+};
+
+// 无锁限流器：令牌桶以 GCRA（理论到达时间）实现，放行一行只需一次 CAS，被拒绝时只读不写；
+// 采样与丢弃计数按线程分散到多个缓存行，避免多核同时写同一个计数器。
+// 由 Logger 创建，生命周期与 Logger 相同
+class RateLimiter {
+public:
+    // label 用于汇总行（"suppressed N lines for <label>"），tagPrefix 为汇总行的标签前缀 "[a b] "
+    RateLimiter(const RateLimit& limit, std::string label, std::string tagPrefix);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    // 判断一行是否放行；不放行时计入丢弃数。只采样不限速时不读取时钟
+    bool allow();
+
+    // 限流使用的单调时钟（纳秒）；Linux 上为 CLOCK_MONOTONIC_COARSE，读取只需几纳秒，
+    // 毫秒级的精度对每秒数百到数万行的限速足够
+    static int64_t now();
+
+    // 是否有尚未汇总的丢弃行
+    bool hasSuppressed() const { return hasSuppressed_.load(std::memory_order_relaxed); }
+
+    // 取出并清零尚未汇总的丢弃行数
+    uint64_t takeSuppressed();
+
+    // 尚未汇总的丢弃行数（不清零）
+    uint64_t pendingSuppressed() const;
+
+    // 尝试占用本次汇总：距上次汇总不足 interval 纳秒时返回 false
+    bool claimReport(int64_t now, int64_t interval);
+
+    const std::string& label() const { return label_; }
+    std::string_view tagPrefix() const { return tagPrefix_; }
+
+private:
+    static constexpr size_t kStripes = 8;
+
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> seen{0};
+        std::atomic<uint64_t> suppressed{0};
+    };
+
+    void suppress(Stripe& stripe);
+
+    // 采样参数
+    uint32_t sampleEvery_;
+    uint64_t sampleThreshold_;  // 随机数小于该值时保留；UINT64_MAX 表示全部保留
+    // 令牌桶参数（纳秒），interval_ 为 0 表示不限速
+    int64_t interval_ = 0;
+    int64_t tolerance_ = 0;
+
+    std::string label_;
+    std::string tagPrefix_;
+
+    alignas(64) std::atomic<int64_t> tat_{0};
+    alignas(64) std::atomic<bool> hasSuppressed_{false};
+    std::atomic<int64_t> lastReport_{0};
+    Stripe stripes_[kStripes];
+};
+
+} // namespace m3log
+
+#endif // M3LOG_LIMIT_HH
@@ -0,0 +1,161 @@
+#include "m3log_metrics.hh"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+namespace m3log {
+
+namespace {
+
+constexpr unsigned kSubBits = 4;
+constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBits;
+
+// 已注册的线程计数器；已退出线程的计数并入 retired。
+// 有意不释放：线程可能在静态对象析构之后才退出
+struct Registry {
+    std::mutex mutex;
+    std::vector<detail::ThreadMetrics*> live;
+    detail::ThreadMetrics retired;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+// 线程局部的注册句柄，线程退出时注销
+struct ThreadHandle {
+    ThreadHandle() : metrics(new detail::ThreadMetrics) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.live.push_back(metrics);
+    }
+
+    ~ThreadHandle() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        detail::ThreadMetrics& retired = reg.retired;
+        detail::ThreadMetrics::add(retired.lines, metrics->lines.load(std::memory_order_relaxed));
+        detail::ThreadMetrics::add(retired.bytes, metrics->bytes.load(std::memory_order_relaxed));
+        detail::ThreadMetrics::add(retired.blocked, metrics->blocked.load(std::memory_order_relaxed));
+        detail::ThreadMetrics::add(retired.contended, metrics->contended.load(std::memory_order_relaxed));
+        retired.format.absorb(metrics->format);
+        retired.enqueue.absorb(metrics->enqueue);
+        retired.write.absorb(metrics->write);
+        reg.live.erase(std::find(reg.live.begin(), reg.live.end(), metrics));
+        delete metrics;
+    }
+
+    detail::ThreadMetrics* metrics;
+};
+
+void addThread(MetricsSnapshot& out, const detail::ThreadMetrics& metrics) {
+    out.lines += metrics.lines.load(std::memory_order_relaxed);
+    out.bytes += metrics.bytes.load(std::memory_order_relaxed);
+    out.blocked += metrics.blocked.load(std::memory_order_relaxed);
+    out.contended += metrics.contended.load(std::memory_order_relaxed);
+    metrics.format.addTo(out.format);
+    metrics.enqueue.addTo(out.enqueue);
+    metrics.write.addTo(out.write);
+}
+
+} // namespace
+
+// ---- HistogramSnapshot ----
+
+size_t HistogramSnapshot::bucketOf(uint64_t nanos) {
+    if (nanos < kSubBuckets) {
+        return static_cast<size_t>(nanos);
+    }
+    // 最高位为第 exponent 位，其后 kSubBits 位选择子桶
+    unsigned exponent = static_cast<unsigned>(std::bit_width(nanos)) - 1;
+    size_t index = (exponent - kSubBits + 1) * kSubBuckets + ((nanos >> (exponent - kSubBits)) - kSubBuckets);
+    return std::min(index, kBuckets - 1);
+}
+
+uint64_t HistogramSnapshot::bucketUpperBound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    unsigned shift = static_cast<unsigned>(index / kSubBuckets) - 1;
+    uint64_t top = kSubBuckets + index % kSubBuckets;
+    return ((top + 1) << shift) - 1;
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+HistogramSnapshot HistogramSnapshot::since(const HistogramSnapshot& earlier) const {
+    HistogramSnapshot delta;
+    delta.count = count - earlier.count;
+    delta.sum = sum - earlier.sum;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        delta.buckets[i] = buckets[i] - earlier.buckets[i];
+        if (delta.buckets[i] > 0) {
+            delta.max = std::min(bucketUpperBound(i), max);
+        }
+    }
+    return delta;
+}
+
+// ---- 线程计数器 ----
+
+namespace detail {
+
+void LatencyHistogram::addTo(HistogramSnapshot& out) const {
+    out.count += count_.load(std::memory_order_relaxed);
+    out.sum += sum_.load(std::memory_order_relaxed);
+    out.max = std::max(out.max, max_.load(std::memory_order_relaxed));
+    for (size_t i = 0; i < HistogramSnapshot::kBuckets; ++i) {
+        out.buckets[i] += buckets_[i].load(std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::absorb(const LatencyHistogram& other) {
+    bump(count_, other.count_.load(std::memory_order_relaxed));
+    bump(sum_, other.sum_.load(std::memory_order_relaxed));
+    max_.store(std::max(max_.load(std::memory_order_relaxed), other.max_.load(std::memory_order_relaxed)),
+               std::memory_order_relaxed);
+    for (size_t i = 0; i < HistogramSnapshot::kBuckets; ++i) {
+        bump(buckets_[i], other.buckets_[i].load(std::memory_order_relaxed));
+    }
+}
+
+ThreadMetrics& threadMetrics() {
+    thread_local ThreadHandle handle;
+    return *handle.metrics;
+}
+
+void collectThreadMetrics(MetricsSnapshot& out) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const ThreadMetrics* metrics : reg.live) {
+        addThread(out, *metrics);
+    }
+    addThread(out, reg.retired);
+}
+
+int64_t metricsClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace detail
+
+} // namespace m3log
@@ -0,0 +1,137 @@
+#ifndef M3LOG_METRICS_HH
+#define M3LOG_METRICS_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "m3log_sink.hh"
+
+namespace m3log {
+
+// 延迟直方图快照（纳秒）。按对数-线性分桶：小于 16ns 的值各占一桶，
+// 之后每个 2 倍区间分为 16 个子桶，相对误差不超过 1/16；超过约 18 分钟的值计入最后一桶
+struct HistogramSnapshot {
+    static constexpr size_t kBuckets = 592;
+
+    uint64_t count = 0;
+    uint64_t sum = 0;  // 所有样本之和
+    uint64_t max = 0;  // 最大样本（区间快照中为最高非空桶的上界）
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(kBuckets);
+
+    // 第 q 分位（0~1）的近似值：所在桶的上界，不超过 max；没有样本时为 0
+    uint64_t percentile(double q) const;
+
+    double mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+
+    // 相对于较早快照的增量，用于计算一个周期内的分位数
+    HistogramSnapshot since(const HistogramSnapshot& earlier) const;
+
+    static size_t bucketOf(uint64_t nanos);
+    static uint64_t bucketUpperBound(size_t index);
+};
+
+// 单个输出目标的状态
+struct SinkMetrics {
+    uint64_t id = 0;           // Logger::addSink 返回的编号
+    size_t queueDepth = 0;     // 队列中尚未写出的行数（近似）
+    size_t queueCapacity = 0;  // 队列容量
+    uint64_t dropped = 0;      // 因队列已满被丢弃的行数
+    IoStats io;
+};
+
+// Logger 自身的运行统计，由 Logger::metrics 汇总。计数均为自进程启动以来的累计值
+struct MetricsSnapshot {
+    uint64_t lines = 0;       // 格式化并分发给 sink 的行数（含二进制输出的事件）
+    uint64_t bytes = 0;       // 这些行的字节数
+    uint64_t dropped = 0;     // 因异步队列或 sink 队列已满被丢弃的行数
+    uint64_t blocked = 0;     // 生产者遇到已满队列而等待的次数（Block 策略）
+    uint64_t contended = 0;   // 获取二进制输出锁时发生争用的次数
+    uint64_t suppressed = 0;  // 被限流与采样丢弃的行数
+    uint64_t collapsed = 0;   // 被重复合并的行数
+
+    size_t queueDepth = 0;     // 异步队列中的记录数（近似），同步模式为 0
+    size_t queueCapacity = 0;  // 异步队列容量，同步模式为 0
+    std::vector<SinkMetrics> sinks;
+
+    // 耗时直方图按线程每 ThreadMetrics::kSampleEvery 行抽样计时一行，count 为样本数而非行数
+    HistogramSnapshot format;   // 渲染参数并格式化一行的耗时（同步模式在调用线程，异步模式在写线程）
+    HistogramSnapshot enqueue;  // 把一行交给下一级队列的耗时：调用线程入队或分发给各 sink，
+                                // 异步模式下还包括写线程分发给各 sink；含队列已满时的等待
+    HistogramSnapshot write;    // sink 写线程中单次 Sink::write 的耗时（含其中触发的 I/O）
+};
+
+namespace detail {
+
+// 单线程写入、任意线程读取的直方图：写入方以 relaxed 读改写更新，无原子 RMW 指令
+class LatencyHistogram {
+public:
+    void record(uint64_t nanos) {
+        bump(buckets_[HistogramSnapshot::bucketOf(nanos)], 1);
+        bump(count_, 1);
+        bump(sum_, nanos);
+        if (nanos > max_.load(std::memory_order_relaxed)) {
+            max_.store(nanos, std::memory_order_relaxed);
+        }
+    }
+
+    // 累加到快照
+    void addTo(HistogramSnapshot& out) const;
+
+    // 并入另一个直方图（调用方保证没有并发写入本直方图）
+    void absorb(const LatencyHistogram& other);
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+    std::atomic<uint64_t> buckets_[HistogramSnapshot::kBuckets] = {};
+};
+
+// 每个线程私有的计数器，只由所属线程写入；线程退出时并入全局的已退出线程汇总
+struct ThreadMetrics {
+    // 计数精确累加，耗时每 kSampleEvery 行抽样一行：读一次单调时钟约几十纳秒，抽样后摊薄到每行几纳秒
+    static constexpr uint32_t kSampleEvery = 16;
+
+    std::atomic<uint64_t> lines{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> blocked{0};
+    std::atomic<uint64_t> contended{0};
+    LatencyHistogram format;
+    LatencyHistogram enqueue;
+    LatencyHistogram write;
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void addLine(size_t length) {
+        add(lines, 1);
+        add(bytes, length);
+    }
+
+    // 本行是否计时
+    bool sample() { return (++ticks & (kSampleEvery - 1)) == 0; }
+
+    uint32_t ticks = 0;  // 只由所属线程访问
+};
+
+// 当前线程的计数器，第一次调用时注册
+ThreadMetrics& threadMetrics();
+
+// 汇总所有线程（含已退出线程）的计数与直方图
+void collectThreadMetrics(MetricsSnapshot& out);
+
+// 计时用的单调时钟（纳秒）
+int64_t metricsClock();
+
+} // namespace detail
+
+} // namespace m3log
+
+#endif // M3LOG_METRICS_HH
@@ -0,0 +1,116 @@
+#ifndef M3LOG_QUEUE_HH
+#define M3LOG_QUEUE_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace m3log {
+
+// 有界无锁多生产者队列（基于 Vyukov 的序号环形缓冲区）
+// 任意数量的线程可以并发 tryPush，tryPop 只允许单个消费者线程调用
+template <typename T>
+class BoundedMpscQueue {
+public:
+    // 容量会向上取整为 2 的幂
+    explicit BoundedMpscQueue(size_t capacity)
+        : mask_(roundUpPow2(capacity) - 1),
+          cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    ~BoundedMpscQueue() {
+        T item;
+        while (tryPop(item)) {
+        }
+    }
+
+    BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+    BoundedMpscQueue& operator=(const BoundedMpscQueue&) = delete;
+
+    // 尝试入队，队列已满时返回 false，item 保持不变
+    bool tryPush(T&& item) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (&cell.storage) T(std::move(item));
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 尝试出队（仅限单个消费者线程），队列为空时返回 false
+    bool tryPop(T& out) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) {
+            return false;
+        }
+        T* value = std::launder(reinterpret_cast<T*>(&cell.storage));
+        out = std::move(*value);
+        value->~T();
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 近似判断队列是否为空（仅供消费者线程参考）
+    bool empty() const {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        const Cell& cell = cells_[pos & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        return static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0;
+    }
+
+    // 近似的元素个数，可在任意线程调用（用于监控队列深度）
+    size_t size() const {
+        size_t head = dequeuePos_.load(std::memory_order_relaxed);
+        size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+        return tail > head ? std::min(tail - head, mask_ + 1) : 0;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static size_t roundUpPow2(size_t n) {
+        size_t v = 2;
+        while (v < n) {
+            v <<= 1;
+        }
+        return v;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    // 只由消费者线程写入，原子变量只是为了让 size 可以在其他线程读取
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+} // namespace m3log
+
+#endif // M3LOG_QUEUE_HH
@@ -0,0 +1,292 @@
+#include "m3log_recorder.hh"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace m3log {
+namespace detail {
+
+namespace {
+
+// 文件布局（本机字节序）：
+//   [0, 64)      文件头：魔数、版本、环形区偏移、时间戳精度、容量
+//   [64, 72)     写入位置（自创建以来预留的总字节数），单独占一个缓存行
+//   [4096, ...)  环形区，记录按 8 字节对齐，不跨越环尾
+// 每条记录：位置戳(8) 时间(8) 长度(4) 标签长度(2) 级别(1) 标志(1)，随后是标签前缀与消息
+constexpr char kMagic[4] = {'M', '3', 'F', 'R'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeadOffset = 64;
+constexpr size_t kDataOffset = 4096;
+constexpr uint64_t kMinCapacity = 64 << 10;
+constexpr size_t kRecordHeaderSize = 24;
+constexpr uint64_t kMaxRecord = 64 << 10;
+constexpr uint8_t kTruncated = 1;
+
+// 位置戳为绝对位置与该常量的异或，全零的新文件不会被误认为记录
+constexpr uint64_t kStampKey = 0x4D33465253544D50ull;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t dataOffset;
+    uint8_t precision;
+    uint8_t reserved[3];
+    uint64_t capacity;
+};
+
+struct RecordFields {
+    int64_t time;
+    uint32_t length;      // 标签与消息的总字节数
+    uint16_t tagLength;
+    uint8_t level;
+    uint8_t flags;
+};
+
+static_assert(sizeof(RecordFields) + 8 == kRecordHeaderSize, "record header layout");
+static_assert(std::atomic_ref<uint64_t>::is_always_lock_free, "record stamps need lock-free 64-bit atomics");
+
+uint64_t alignRecord(uint64_t size) {
+    return (size + 7) & ~uint64_t(7);
+}
+
+bool validHeader(const FileHeader& header) {
+    return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+           header.dataOffset == kDataOffset && header.capacity >= kMinCapacity &&
+           (header.capacity & (header.capacity - 1)) == 0;
+}
+
+#if !defined(_WIN32)
+bool readAt(int fd, void* buffer, size_t length, off_t offset) {
+    char* p = static_cast<char*>(buffer);
+    while (length > 0) {
+        ssize_t n = ::pread(fd, p, length, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+FlightRecorder::FlightRecorder(const std::string& path, const FlightRecorderOptions& options,
+                               TimestampPrecision precision)
+    : minLevel_(static_cast<int>(options.minLevel)) {
+#if defined(_WIN32)
+    (void)path;
+    (void)precision;
+#else
+    uint64_t capacity = kMinCapacity;
+    while (capacity < options.capacity) {
+        capacity <<= 1;
+    }
+    size_t total = kDataOffset + static_cast<size_t>(capacity);
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        return;
+    }
+
+    // 格式与容量都相同的已有文件原样保留，新记录接在上次运行的记录之后
+    FileHeader header{};
+    struct stat st;
+    bool reuse = ::fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) == total &&
+                 readAt(fd_, &header, sizeof(header), 0) && validHeader(header) && header.capacity == capacity;
+    if (!reuse && (::ftruncate(fd_, 0) != 0 || ::ftruncate(fd_, static_cast<off_t>(total)) != 0)) {
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+
+    // 预先分配全部磁盘块：之后通过映射写入时不会因磁盘已满而收到 SIGBUS
+    int error = ::posix_fallocate(fd_, 0, static_cast<off_t>(total));
+    if (error != 0 && error != EOPNOTSUPP && error != EINVAL) {
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;  // 预先建立页表，热路径上不产生缺页
+#endif
+    void* map = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, flags, fd_, 0);
+    if (map == MAP_FAILED) {
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+
+    map_ = static_cast<char*>(map);
+    mapSize_ = total;
+    head_ = reinterpret_cast<uint64_t*>(map_ + kHeadOffset);
+    if (!reuse) {
+        header = FileHeader{};
+        header.version = kVersion;
+        header.dataOffset = kDataOffset;
+        header.capacity = capacity;
+        std::memcpy(map_, &header, sizeof(header));
+        std::atomic_ref<uint64_t>(*head_).store(0, std::memory_order_relaxed);
+        // 魔数最后写入：初始化中途崩溃的文件下次打开时会被重新初始化
+        std::memcpy(map_, kMagic, sizeof(kMagic));
+    }
+
+    capacity_ = capacity;
+    mask_ = capacity - 1;
+    maxRecord_ = std::min(capacity / 16, kMaxRecord);
+    ring_ = map_ + kDataOffset;
+    setPrecision(precision);
+#endif
+}
+
+FlightRecorder::~FlightRecorder() {
+#if !defined(_WIN32)
+    if (map_) {
+        ::munmap(map_, mapSize_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+}
+
+void FlightRecorder::setPrecision(TimestampPrecision precision) {
+    if (map_) {
+        std::atomic_ref<uint8_t>(reinterpret_cast<FileHeader*>(map_)->precision)
+            .store(static_cast<uint8_t>(precision), std::memory_order_relaxed);
+    }
+}
+
+void FlightRecorder::record(LogLevel level, int64_t time, std::string_view tags, std::string_view message) {
+    // 标签前缀最多占记录的四分之一（上限来自运行期的 maxRecord_，编译器不会把复制展开成 rep movs）
+    uint8_t flags = 0;
+    size_t tagLimit = static_cast<size_t>(maxRecord_ / 4);
+    if (tags.size() > tagLimit) {
+        tags = tags.substr(0, tagLimit);
+    }
+    size_t room = static_cast<size_t>(maxRecord_) - kRecordHeaderSize - tags.size();
+    if (message.size() > room) {
+        message = message.substr(0, room);
+        flags |= kTruncated;
+    }
+
+    RecordFields fields;
+    fields.time = time;
+    fields.length = static_cast<uint32_t>(tags.size() + message.size());
+    fields.tagLength = static_cast<uint16_t>(tags.size());
+    fields.level = static_cast<uint8_t>(level);
+    fields.flags = flags;
+    uint64_t size = alignRecord(kRecordHeaderSize + fields.length);
+
+    // 跨越环尾的预留直接放弃，下一次预留必然从下一圈开头之后开始，最多重试一次
+    std::atomic_ref<uint64_t> head(*head_);
+    uint64_t position;
+    uint64_t offset;
+    do {
+        position = head.fetch_add(size, std::memory_order_relaxed);
+        offset = position & mask_;
+    } while (offset + size > capacity_);
+
+    char* p = ring_ + offset;
+    std::memcpy(p + 8, &fields, sizeof(fields));
+    std::memcpy(p + kRecordHeaderSize, tags.data(), tags.size());
+    std::memcpy(p + kRecordHeaderSize + tags.size(), message.data(), message.size());
+
+    // 位置戳最后写入，读取方据此判断记录已经完整
+    std::atomic_ref<uint64_t>(*reinterpret_cast<uint64_t*>(p)).store(position ^ kStampKey, std::memory_order_release);
+}
+
+bool FlightRecorder::extract(const std::string& path, std::string& storage, std::vector<Entry>& entries,
+                             TimestampPrecision& precision) {
+    entries.clear();
+#if defined(_WIN32)
+    (void)path;
+    (void)storage;
+    (void)precision;
+    return false;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    FileHeader header;
+    uint64_t head = 0;
+    uint64_t headAfter = 0;
+    struct stat st;
+    bool ok = readAt(fd, &header, sizeof(header), 0) && validHeader(header) && ::fstat(fd, &st) == 0 &&
+              static_cast<uint64_t>(st.st_size) >= kDataOffset + header.capacity &&
+              readAt(fd, &head, sizeof(head), kHeadOffset);
+    if (ok) {
+        // 文件可能仍在被写入：复制环形区后再读一次写入位置，
+        // 复制期间可能被新一圈覆盖的记录（位置低于 headAfter - capacity）不采用
+        storage.resize(static_cast<size_t>(header.capacity));
+        ok = readAt(fd, storage.data(), storage.size(), kDataOffset) &&
+             readAt(fd, &headAfter, sizeof(headAfter), kHeadOffset);
+    }
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+
+    precision = static_cast<TimestampPrecision>(header.precision);
+    uint64_t capacity = header.capacity;
+    uint64_t mask = capacity - 1;
+    uint64_t position = head > capacity ? head - capacity : 0;
+    uint64_t valid = headAfter > capacity ? headAfter - capacity : 0;
+    position = alignRecord(position);
+
+    // 从最旧的位置向后扫描；位置戳不匹配时按 8 字节前进，直到重新对齐到一条完整的记录
+    while (position + kRecordHeaderSize <= head) {
+        uint64_t offset = position & mask;
+        if (offset + kRecordHeaderSize > capacity) {
+            position += capacity - offset;
+            continue;
+        }
+        const char* p = storage.data() + offset;
+        uint64_t stamp;
+        RecordFields fields;
+        std::memcpy(&stamp, p, sizeof(stamp));
+        std::memcpy(&fields, p + 8, sizeof(fields));
+        uint64_t size = alignRecord(kRecordHeaderSize + fields.length);
+        if (stamp != (position ^ kStampKey) || fields.tagLength > fields.length || offset + size > capacity ||
+            position + size > head || fields.level > static_cast<uint8_t>(LogLevel::FATAL)) {
+            position += 8;
+            continue;
+        }
+
+        if (position >= valid) {
+            Entry entry;
+            entry.position = position;
+            entry.time = fields.time;
+            entry.level = static_cast<LogLevel>(fields.level);
+            entry.truncated = (fields.flags & kTruncated) != 0;
+            entry.tags = std::string_view(p + kRecordHeaderSize, fields.tagLength);
+            entry.message = std::string_view(p + kRecordHeaderSize + fields.tagLength,
+                                             fields.length - fields.tagLength);
+            entries.push_back(entry);
+        }
+        position += size;
+    }
+    return true;
+#endif
+}
+
+} // namespace detail
+} // namespace m3log
@@ -0,0 +1,80 @@
+#ifndef M3LOG_RECORDER_HH
+#define M3LOG_RECORDER_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "m3log_level.hh"
+#include "m3log_timestamp.hh"
+
+namespace m3log {
+
+// 飞行记录器选项
+struct FlightRecorderOptions {
+    size_t capacity = 16 << 20;           // 环形区大小（字节，向上取整为 2 的幂，至少 64KB）
+    LogLevel minLevel = LogLevel::DEBUG;  // 记录的最低级别，可以低于 setMinLogLevel 设置的输出级别
+};
+
+namespace detail {
+
+// 飞行记录器：最近的日志以原始形式（时间、级别、标签、消息）写入 mmap(MAP_SHARED) 的环形文件，
+// 数据直接进入页缓存，进程崩溃或被信号杀死时不会丢失，之后由 m3log_recorder 工具按顺序还原为文本。
+// 写入无锁：一次 fetch_add 预留空间，复制后以 release 写入记录的位置戳作为提交标记；
+// 位置戳不匹配的记录（未写完、已被覆盖）在读取时被跳过。写入线程在复制途中被挂起、
+// 期间其他线程写满一整圈时，迟到的写入会破坏新一圈的记录，两者都被丢弃，环形区应远大于一个调度时间片内的日志量
+class FlightRecorder {
+public:
+    // 打开或创建记录文件；已有文件的容量相同时从其写入位置继续，保留上次运行（崩溃前）的记录
+    FlightRecorder(const std::string& path, const FlightRecorderOptions& options, TimestampPrecision precision);
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    bool isOpen() const { return ring_ != nullptr; }
+
+    bool accepts(LogLevel level) const { return static_cast<int>(level) >= minLevel_; }
+    LogLevel minLevel() const { return static_cast<LogLevel>(minLevel_); }
+    size_t capacity() const { return static_cast<size_t>(capacity_); }
+
+    // 追加一条记录；tags 为渲染好的标签前缀 "[a b] "，消息过长时截断
+    void record(LogLevel level, int64_t time, std::string_view tags, std::string_view message);
+
+    // 更新文件头中的时间戳精度，供还原时使用
+    void setPrecision(TimestampPrecision precision);
+
+    // 从记录文件中取出的一条记录，tags 与 message 指向 extract 的 storage
+    struct Entry {
+        uint64_t position = 0;  // 写入顺序（环中的绝对位置）
+        int64_t time = 0;       // 自 Unix 纪元以来的纳秒数
+        LogLevel level = LogLevel::INFO;
+        bool truncated = false;
+        std::string_view tags;
+        std::string_view message;
+    };
+
+    // 读取记录文件中仍然完整的记录，按写入顺序排列；可用于仍在写入的文件。
+    // 文件不存在或不是记录文件时返回 false
+    static bool extract(const std::string& path, std::string& storage, std::vector<Entry>& entries,
+                        TimestampPrecision& precision);
+
+private:
+    int fd_ = -1;
+    char* map_ = nullptr;
+    size_t mapSize_ = 0;
+    char* ring_ = nullptr;
+    uint64_t* head_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t maxRecord_ = 0;
+    int minLevel_;
+};
+
+} // namespace detail
+
+} // namespace m3log
+
+#endif // M3LOG_RECORDER_HH
@@ -0,0 +1,171 @@
+#include "m3log_shard.hh"
+#include <algorithm>
+
+namespace m3log {
+namespace detail {
+
+// 线程局部的绑定持有分片集合的引用，集合被 Logger 替换后仍可安全归还分片
+struct ShardSet::Binding {
+    std::shared_ptr<ShardSet> set;
+    Shard* shard = nullptr;
+
+    ~Binding() { reset(); }
+
+    void reset() {
+        if (set && shard) {
+            set->release(shard);
+        }
+        set.reset();
+        shard = nullptr;
+    }
+};
+
+ShardSet::Binding& ShardSet::binding() {
+    thread_local Binding binding;
+    return binding;
+}
+
+ShardSet::ShardSet(std::string path, const ShardOptions& options) : path_(std::move(path)), options_(options) {
+    if (options_.flush.interval.count() > 0) {
+        flusher_ = std::thread(&ShardSet::runFlusher, this);
+    }
+}
+
+ShardSet::~ShardSet() {
+    close();
+}
+
+void ShardSet::write(std::string_view line, LogLevel level) {
+    Binding& local = binding();
+    if (local.set.get() != this) {
+        local.reset();
+        Shard* shard = acquire();
+        if (!shard) {
+            return;
+        }
+        local.set = shared_from_this();
+        local.shard = shard;
+    }
+
+    Shard& shard = *local.shard;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.writer.append(line);
+    shard.writer.append("\n");
+    ++shard.lines;
+
+    bool urgent = options_.flush.flushOnError && level >= LogLevel::ERROR;
+    if (urgent || shard.writer.pending() >= options_.flush.bufferBytes) {
+        flushShard(shard);
+    }
+}
+
+void ShardSet::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+        flushShard(*shard);
+    }
+}
+
+void ShardSet::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+    }
+    flusherCv_.notify_one();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+        flushShard(*shard);
+        shard->writer.close();
+    }
+}
+
+IoStats ShardSet::ioStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    IoStats stats;
+    for (const auto& shard : shards_) {
+        {
+            std::lock_guard<std::mutex> shardLock(shard->mutex);
+            stats.lines += shard->lines;
+        }
+        stats.writeCalls += shard->writer.writeCalls();
+        stats.syncCalls += shard->writer.syncCalls();
+        stats.bytes += shard->writer.bytesWritten();
+    }
+    return stats;
+}
+
+std::vector<std::string> ShardSet::paths() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> paths;
+    for (const auto& shard : shards_) {
+        paths.push_back(shard->path);
+    }
+    return paths;
+}
+
+Shard* ShardSet::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+        return nullptr;
+    }
+    if (!free_.empty()) {
+        Shard* shard = free_.back();
+        free_.pop_back();
+        return shard;
+    }
+
+    auto shard = std::make_unique<Shard>();
+    shard->index = shards_.size();
+    shard->path = path_ + ".shard" + std::to_string(shard->index);
+    if (!shard->writer.open(shard->path)) {
+        return nullptr;
+    }
+    shard->writer.reserve(std::max<size_t>(options_.flush.bufferBytes, 4096));
+    shard->lastFlush = std::chrono::steady_clock::now();
+    shards_.push_back(std::move(shard));
+    return shards_.back().get();
+}
+
+void ShardSet::release(Shard* shard) {
+    // 线程退出前写出自己的缓冲区，下一个领取者接着追加
+    {
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+        flushShard(*shard);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!closed_) {
+        free_.push_back(shard);
+    }
+}
+
+void ShardSet::flushShard(Shard& shard) {
+    shard.writer.flush(options_.flush.sync && shard.writer.pending() > 0);
+    shard.lastFlush = std::chrono::steady_clock::now();
+}
+
+void ShardSet::runFlusher() {
+    std::chrono::milliseconds interval = options_.flush.interval;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!flusherCv_.wait_for(lock, interval, [this] { return closed_; })) {
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& shard : shards_) {
+            // 写入方正持有分片时跳过，下一轮再检查
+            std::unique_lock<std::mutex> shardLock(shard->mutex, std::try_to_lock);
+            if (shardLock.owns_lock() && shard->writer.pending() > 0 && now - shard->lastFlush >= interval) {
+                flushShard(*shard);
+            }
+        }
+    }
+}
+
+} // namespace detail
+} // namespace m3log
@@ -0,0 +1,93 @@
+#ifndef M3LOG_SHARD_HH
+#define M3LOG_SHARD_HH
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "m3log_level.hh"
+#include "m3log_sink.hh"
+#include "m3log_writer.hh"
+
+namespace m3log {
+
+// 按线程分片输出的选项
+struct ShardOptions {
+    LogLevel minLevel = LogLevel::DEBUG;  // 低于该级别的日志不写入分片
+    FlushPolicy flush;                    // 每个分片各自的刷新策略，周期刷新由后台线程完成
+};
+
+namespace detail {
+
+// 一个分片文件：同一时刻只属于一个写日志的线程
+struct Shard {
+    size_t index = 0;
+    std::string path;
+    // 写入方与刷新线程、flush、close 之间的锁；不同的写入方之间没有共享的锁
+    std::mutex mutex;
+    FileWriter writer;
+    std::chrono::steady_clock::time_point lastFlush;
+    uint64_t lines = 0;
+};
+
+// 按线程分片的文件输出：每个写日志的线程第一次写入时领取一个分片 path.shardN，此后只写自己的分片，
+// 不同线程之间不共享缓冲区、锁与文件偏移。线程退出时分片被归还，由之后新出现的线程继续追加，
+// 分片数因此等于同时写日志的最大线程数。各分片内部按时间有序，用 m3log_merge 合并为一个全局有序的流
+class ShardSet : public std::enable_shared_from_this<ShardSet> {
+public:
+    ShardSet(std::string path, const ShardOptions& options);
+    ~ShardSet();
+
+    ShardSet(const ShardSet&) = delete;
+    ShardSet& operator=(const ShardSet&) = delete;
+
+    bool accepts(LogLevel level) const { return level >= options_.minLevel; }
+
+    // 写入调用线程自己的分片（不含结尾换行）
+    void write(std::string_view line, LogLevel level);
+
+    // 写出所有分片的缓冲区（按策略决定是否 fdatasync）
+    void flush();
+
+    // 写出并关闭所有分片，停止刷新线程；之后的写入被忽略
+    void close();
+
+    IoStats ioStats() const;
+
+    // 已创建的分片文件
+    std::vector<std::string> paths() const;
+
+private:
+    // 线程与分片的绑定，线程退出时归还分片
+    struct Binding;
+    static Binding& binding();
+
+    // 为调用线程领取一个分片（优先复用已退出线程的分片），失败返回空指针
+    Shard* acquire();
+    void release(Shard* shard);
+    void flushShard(Shard& shard);
+    void runFlusher();
+
+    std::string path_;
+    ShardOptions options_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<Shard*> free_;
+    bool closed_ = false;
+
+    std::condition_variable flusherCv_;
+    std::thread flusher_;
+};
+
+} // namespace detail
+} // namespace m3log
+
+#endif // M3LOG_SHARD_HH
@@ -0,0 +1,553 @@
+#include "m3log_sink.hh"
+#include "m3log_archive.hh"
+#include "m3log_metrics.hh"
+#include "../c/include/m3log_index.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace m3log {
+
+namespace {
+
+// 写线程每批最多处理的行数，保证持续写入时 onIdle 也能按时调用
+constexpr size_t kBatchLimit = 1024;
+
+// 队列刚变空时休眠前让出CPU的次数
+constexpr unsigned kIdleSpins = 16;
+
+std::chrono::milliseconds minInterval(std::chrono::milliseconds a, std::chrono::milliseconds b) {
+    return a.count() > 0 && a < b ? a : b;
+}
+
+} // namespace
+
+// ---- BufferedSink ----
+
+BufferedSink::BufferedSink(const FlushPolicy& policy)
+    : policy_(policy), lastFlush_(std::chrono::steady_clock::now()) {
+    writer_.reserve(std::max<size_t>(policy.bufferBytes, 4096));
+}
+
+void BufferedSink::write(std::string_view line, LogLevel level) {
+    writer_.append(line);
+    writer_.append("\n");
+    lines_.fetch_add(1, std::memory_order_relaxed);
+
+    bool urgent = policy_.flushOnError && level >= LogLevel::ERROR;
+    if (urgent || writer_.pending() >= policy_.bufferBytes) {
+        flushWriter();
+    }
+}
+
+void BufferedSink::flush() {
+    flushWriter();
+}
+
+void BufferedSink::onIdle(std::chrono::steady_clock::time_point now) {
+    if (writer_.pending() > 0 && policy_.interval.count() > 0 && now - lastFlush_ >= policy_.interval) {
+        flushWriter();
+    }
+}
+
+std::chrono::milliseconds BufferedSink::idleInterval() const {
+    return minInterval(policy_.interval, Sink::idleInterval());
+}
+
+IoStats BufferedSink::ioStats() const {
+    IoStats stats;
+    stats.lines = lines_.load(std::memory_order_relaxed);
+    stats.writeCalls = writer_.writeCalls();
+    stats.syncCalls = writer_.syncCalls();
+    stats.bytes = writer_.bytesWritten();
+    return stats;
+}
+
+void BufferedSink::flushWriter() {
+    writer_.flush(policy_.sync && writer_.pending() > 0);
+    lastFlush_ = std::chrono::steady_clock::now();
+}
+
+// ---- ConsoleSink / FileSink ----
+
+ConsoleSink::ConsoleSink(const FlushPolicy& policy, int fd) : BufferedSink(policy) {
+    policy_.sync = false;
+    writer_.attach(fd);
+}
+
+FileSink::FileSink(const std::string& path, const FlushPolicy& policy, const IndexPolicy& index)
+    : BufferedSink(policy) {
+    writer_.open(path);
+#if !defined(_WIN32)
+    // 打开时先为文件中已有的内容补齐索引，之后逐行跟随写入
+    if (index.enabled && writer_.isOpen()) {
+        m3log_index_options_t options{index.blockLines, index.bloomBytes};
+        if (m3log_index_builder_open(path.c_str(), nullptr, &options, &index_) != M3LOG_SUCCESS) {
+            index_ = nullptr;
+        }
+    }
+#else
+    (void)index;
+#endif
+}
+
+FileSink::~FileSink() {
+#if !defined(_WIN32)
+    if (index_) {
+        flushWriter();
+        m3log_index_builder_close(index_);
+    }
+#endif
+}
+
+void FileSink::write(std::string_view line, LogLevel level) {
+#if !defined(_WIN32)
+    if (index_) {
+        m3log_index_builder_add(index_, line.data(), line.size());
+    }
+#endif
+    BufferedSink::write(line, level);
+}
+
+// ---- RotatingFileSink ----
+
+RotatingFileSink::RotatingFileSink(const std::string& path, const RotationPolicy& rotation,
+                                   const FlushPolicy& policy)
+    : BufferedSink(policy),
+      path_(path),
+      rotation_(rotation),
+      archiver_(std::make_unique<detail::LogArchiver>(path, rotation.maxFiles, rotation.compress,
+                                                      rotation.preallocateBytes)) {
+    std::chrono::system_clock::time_point modified = open();
+    auto now = std::chrono::system_clock::now();
+    nextRotation_ = nextBoundary(now);
+
+    // 按时间轮转时，上次运行留下的文件若属于更早的周期，先将其轮转
+    if (rotation_.interval.count() > 0 && size_ > 0 && modified < nextRotation_ - rotation_.interval) {
+        rotate();
+    }
+}
+
+RotatingFileSink::RotatingFileSink(const std::string& path, uint64_t maxBytes, size_t maxFiles,
+                                   const FlushPolicy& policy)
+    : RotatingFileSink(path, RotationPolicy{maxBytes, std::chrono::seconds(0), maxFiles, 0, false}, policy) {
+}
+
+RotatingFileSink::~RotatingFileSink() = default;
+
+void RotatingFileSink::write(std::string_view line, LogLevel level) {
+    if (rotation_.maxBytes > 0 && size_ > 0 && size_ + line.size() + 1 > rotation_.maxBytes) {
+        rotate();
+    }
+    size_ += line.size() + 1;
+    BufferedSink::write(line, level);
+}
+
+void RotatingFileSink::onIdle(std::chrono::steady_clock::time_point now) {
+    BufferedSink::onIdle(now);
+    if (rotation_.interval.count() == 0) {
+        return;
+    }
+    // 每批日志之后检查一次，边界附近的一批日志可能仍写入旧文件
+    auto wall = std::chrono::system_clock::now();
+    if (wall >= nextRotation_) {
+        if (size_ > 0) {
+            rotate();
+        }
+        nextRotation_ = nextBoundary(wall);
+    }
+}
+
+void RotatingFileSink::waitArchived() {
+    archiver_->waitIdle();
+}
+
+std::chrono::system_clock::time_point RotatingFileSink::open() {
+    std::chrono::system_clock::time_point modified = std::chrono::system_clock::now();
+    size_ = 0;
+    if (!writer_.open(path_)) {
+        return modified;
+    }
+#if !defined(_WIN32)
+    struct stat st;
+    if (fstat(writer_.fd(), &st) == 0) {
+        size_ = static_cast<uint64_t>(st.st_size);
+        modified = std::chrono::system_clock::from_time_t(st.st_mtime);
+    }
+#endif
+    preallocateFile(writer_.fd(), rotation_.preallocateBytes);
+    return modified;
+}
+
+void RotatingFileSink::rotate() {
+    flushWriter();
+#if defined(_WIN32)
+    writer_.close();  // Windows 下无法重命名已打开的文件
+#endif
+
+    // 写线程只做 rename：path -> 临时名称，预先创建的文件 -> path；移动保留链与压缩交给后台
+    std::string rotated = archiver_->rotatedName();
+    if (std::rename(path_.c_str(), rotated.c_str()) != 0) {
+        // 文件被外部删除或无权限重命名：重新打开后继续写入，下个周期再尝试
+        writer_.close();
+        open();
+        size_ = 0;
+        return;
+    }
+
+    int next = archiver_->takeNextFile();
+    if (next >= 0) {
+        writer_.attach(next, true);
+        size_ = 0;
+    } else {
+        writer_.close();
+        open();
+    }
+    archiver_->submit(rotated);
+    rotations_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::chrono::system_clock::time_point RotatingFileSink::nextBoundary(std::chrono::system_clock::time_point now) const {
+    if (rotation_.interval.count() <= 0) {
+        return std::chrono::system_clock::time_point::max();
+    }
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    auto interval = rotation_.interval.count();
+    return std::chrono::system_clock::time_point(std::chrono::seconds((seconds / interval + 1) * interval));
+}
+
+// ---- UnixSocketSink ----
+
+UnixSocketSink::UnixSocketSink(const std::string& path, Mode mode, size_t bufferBytes)
+    : path_(path), mode_(mode), bufferBytes_(bufferBytes) {
+    buffer_.reserve(std::max<size_t>(bufferBytes, 4096));
+}
+
+UnixSocketSink::~UnixSocketSink() {
+    flush();
+    disconnect();
+}
+
+void UnixSocketSink::write(std::string_view line, LogLevel level) {
+    (void)level;
+    if (mode_ == Mode::Datagram) {
+        if (!ensureConnected() || !sendAll(line.data(), line.size())) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        lines_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer_.append(line);
+    buffer_.push_back('\n');
+    lines_.fetch_add(1, std::memory_order_relaxed);
+    if (buffer_.size() >= bufferBytes_) {
+        flush();
+    }
+}
+
+void UnixSocketSink::flush() {
+    if (buffer_.empty()) {
+        return;
+    }
+    if (!ensureConnected() || !sendAll(buffer_.data(), buffer_.size())) {
+        dropped_.fetch_add(static_cast<uint64_t>(std::count(buffer_.begin(), buffer_.end(), '\n')),
+                           std::memory_order_relaxed);
+    }
+    buffer_.clear();
+}
+
+void UnixSocketSink::onIdle(std::chrono::steady_clock::time_point now) {
+    (void)now;
+    flush();
+}
+
+IoStats UnixSocketSink::ioStats() const {
+    IoStats stats;
+    stats.lines = lines_.load(std::memory_order_relaxed);
+    stats.writeCalls = sendCalls_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+#if !defined(_WIN32)
+
+bool UnixSocketSink::ensureConnected() {
+    if (fd_ >= 0) {
+        return true;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextAttempt_) {
+        return false;
+    }
+    nextAttempt_ = now + std::chrono::seconds(1);
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path_.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+    int fd = ::socket(AF_UNIX, (mode_ == Mode::Datagram ? SOCK_DGRAM : SOCK_STREAM) | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    return true;
+}
+
+void UnixSocketSink::disconnect() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool UnixSocketSink::sendAll(const char* data, size_t length) {
+    // 非阻塞发送：对端读取过慢时丢弃，而不是让写线程无限期阻塞
+    bool partial = false;
+    while (length > 0) {
+        ssize_t sent = ::send(fd_, data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+        sendCalls_.fetch_add(1, std::memory_order_relaxed);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 流式连接已发出半行时断开，避免对端收到被截断后拼接的行
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || partial) {
+                disconnect();
+            }
+            return false;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+        partial = true;
+        bytes_.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+#else
+
+bool UnixSocketSink::ensureConnected() {
+    return false;
+}
+
+void UnixSocketSink::disconnect() {}
+
+bool UnixSocketSink::sendAll(const char*, size_t) {
+    return false;
+}
+
+#endif
+
+// ---- RingSink ----
+
+RingSink::RingSink(size_t capacity) : lines_(std::max<size_t>(capacity, 1)) {}
+
+void RingSink::write(std::string_view line, LogLevel level) {
+    (void)level;
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 复用槽位中字符串的容量，稳定后不再分配
+    lines_[next_ % lines_.size()].assign(line);
+    ++next_;
+}
+
+std::vector<std::string> RingSink::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = static_cast<size_t>(std::min<uint64_t>(next_, lines_.size()));
+    std::vector<std::string> result;
+    result.reserve(count);
+    for (uint64_t i = next_ - count; i < next_; ++i) {
+        result.push_back(lines_[i % lines_.size()]);
+    }
+    return result;
+}
+
+namespace detail {
+
+// ---- SharedLine ----
+
+SharedLine* SharedLine::create(std::string_view text, LogLevel level, uint32_t refs) {
+    void* memory = ::operator new(sizeof(SharedLine) + text.size());
+    SharedLine* line = new (memory) SharedLine(text.size(), level, refs);
+    std::memcpy(reinterpret_cast<char*>(line + 1), text.data(), text.size());
+    return line;
+}
+
+void SharedLine::release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        this->~SharedLine();
+        ::operator delete(this);
+    }
+}
+
+// ---- SinkWorker ----
+
+SinkWorker::SinkWorker(std::shared_ptr<Sink> sink, LogLevel minLevel, size_t queueCapacity, bool dropOnOverflow)
+    : sink_(std::move(sink)),
+      minLevel_(static_cast<int>(minLevel)),
+      dropOnOverflow_(dropOnOverflow),
+      queue_(queueCapacity) {
+    thread_ = std::thread(&SinkWorker::run, this);
+}
+
+SinkWorker::~SinkWorker() {
+    stop();
+
+    // 与 stop 并发提交、未被写线程取走的行在此释放
+    SharedLine* line = nullptr;
+    while (queue_.tryPop(line)) {
+        line->release();
+    }
+}
+
+void SinkWorker::submit(SharedLine* line) {
+    SharedLine* item = line;
+    bool blocked = false;
+    while (!queue_.tryPush(std::move(item))) {
+        if (dropOnOverflow_ || stopped_.load(std::memory_order_acquire)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            line->release();
+            return;
+        }
+        if (!blocked) {
+            blocked = true;
+            ThreadMetrics& metrics = threadMetrics();
+            ThreadMetrics::add(metrics.blocked, 1);
+        }
+        // 队列已满：唤醒写线程并让出CPU，只阻塞提交到本 sink 的生产者
+        wake();
+        std::this_thread::yield();
+    }
+
+    // 只有把休眠标志清掉的那个生产者负责唤醒，避免写线程尚未被调度时每行都触发一次 futex 调用
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_seq_cst) && sleeping_.exchange(false, std::memory_order_seq_cst)) {
+        wake();
+    }
+}
+
+void SinkWorker::flush() {
+    if (stopped_.load(std::memory_order_acquire)) {
+        return;
+    }
+    uint64_t target = flushRequested_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    wakeCv_.notify_one();
+    flushedCv_.wait(lock, [&] {
+        return flushCompleted_.load(std::memory_order_acquire) >= target ||
+               stopped_.load(std::memory_order_acquire);
+    });
+}
+
+void SinkWorker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_.store(true, std::memory_order_release);
+        wakeCv_.notify_one();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+        // 写线程已退出，立即释放 sink（例如关闭文件），不等待 SinkWorker 析构
+        sink_.reset();
+    }
+}
+
+void SinkWorker::wake() {
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    wakeCv_.notify_one();
+}
+
+size_t SinkWorker::drain(size_t limit) {
+    SharedLine* line = nullptr;
+    size_t count = 0;
+    ThreadMetrics& metrics = threadMetrics();
+    while (count < limit && queue_.tryPop(line)) {
+        if (metrics.sample()) {
+            int64_t start = metricsClock();
+            sink_->write(line->text(), line->level());
+            metrics.write.record(static_cast<uint64_t>(metricsClock() - start));
+        } else {
+            sink_->write(line->text(), line->level());
+        }
+        line->release();
+        ++count;
+    }
+    return count;
+}
+
+void SinkWorker::run() {
+    unsigned spins = kIdleSpins;
+    for (;;) {
+        size_t count = drain(kBatchLimit);
+
+        // 刷新请求：先排空请求之前提交的行，再刷新 sink
+        uint64_t requested = flushRequested_.load(std::memory_order_acquire);
+        if (requested != flushCompleted_.load(std::memory_order_relaxed)) {
+            while (drain(SIZE_MAX) > 0) {
+            }
+            sink_->flush();
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            flushCompleted_.store(requested, std::memory_order_release);
+            flushedCv_.notify_all();
+            continue;
+        }
+
+        sink_->onIdle(std::chrono::steady_clock::now());
+        if (count > 0) {
+            spins = 0;
+            continue;
+        }
+
+        // 刚处理完一批时先让出几次CPU再休眠，生产者持续写入时可以攒成更大的批次
+        if (spins < kIdleSpins) {
+            ++spins;
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        // 队列为空：进入休眠，生产者入队后会唤醒；超时用于按时间刷新
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        sleeping_.store(true, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue_.empty() && !stopping_.load(std::memory_order_acquire) &&
+            flushRequested_.load(std::memory_order_acquire) == flushCompleted_.load(std::memory_order_relaxed)) {
+            wakeCv_.wait_for(lock, sink_->idleInterval());
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    // 退出前写出剩余的行并刷新
+    while (drain(SIZE_MAX) > 0) {
+    }
+    sink_->flush();
+
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    stopped_.store(true, std::memory_order_release);
+    flushedCv_.notify_all();
+}
+
+} // namespace detail
+
+} // namespace m3log
@@ -0,0 +1,298 @@
+#ifndef M3LOG_SINK_HH
+#define M3LOG_SINK_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "m3log_level.hh"
+#include "m3log_queue.hh"
+#include "m3log_writer.hh"
+
+struct m3log_index_builder;
+
+namespace m3log {
+
+// 输出 I/O 统计
+struct IoStats {
+    uint64_t lines = 0;       // 写入的日志行数
+    uint64_t writeCalls = 0;  // write(2) / send(2) 调用次数
+    uint64_t syncCalls = 0;   // fdatasync 调用次数
+    uint64_t bytes = 0;       // 写出的字节数
+};
+
+// 日志输出目标
+// Logger 为每个 sink 分配独立的队列与写线程，write/flush/onIdle 只在该线程上调用，
+// 实现无需自行加锁；慢速 sink 只会积压自己的队列，不会阻塞其他 sink
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    // 写入一行格式化好的日志（不含结尾换行）
+    virtual void write(std::string_view line, LogLevel level) = 0;
+
+    // 写出缓冲中的数据，Logger::flush 与移除 sink 时调用
+    virtual void flush() {}
+
+    // 写线程处理完一批日志或空闲等待超时后调用，可在此按时间合并写出
+    virtual void onIdle(std::chrono::steady_clock::time_point now) { (void)now; }
+
+    // 写线程空闲时单次等待的最长时间
+    virtual std::chrono::milliseconds idleInterval() const { return std::chrono::milliseconds(50); }
+
+    // I/O 统计，可在任意线程调用
+    virtual IoStats ioStats() const { return IoStats(); }
+};
+
+// 基于 FileWriter 的缓冲 sink：按 FlushPolicy 合并写出
+class BufferedSink : public Sink {
+public:
+    explicit BufferedSink(const FlushPolicy& policy);
+
+    void write(std::string_view line, LogLevel level) override;
+    void flush() override;
+    void onIdle(std::chrono::steady_clock::time_point now) override;
+    std::chrono::milliseconds idleInterval() const override;
+    IoStats ioStats() const override;
+
+protected:
+    // 写出缓冲区，按策略决定是否 fdatasync
+    void flushWriter();
+
+    FileWriter writer_;
+    FlushPolicy policy_;
+    std::chrono::steady_clock::time_point lastFlush_;
+    std::atomic<uint64_t> lines_{0};
+};
+
+// 标准输出（或其他已打开的描述符），不做 fdatasync
+class ConsoleSink : public BufferedSink {
+public:
+    explicit ConsoleSink(const FlushPolicy& policy = FlushPolicy(), int fd = 1);
+};
+
+// 旁路索引（见 m3log_index.h）：写日志的同时在写线程上生成 path.m3ix，
+// 供 m3log_index_query 跳过不含目标级别、标签或时间范围的块
+struct IndexPolicy {
+    bool enabled = false;
+    size_t blockLines = 0;  // 每块行数，0 表示默认（1024）
+    size_t bloomBytes = 0;  // 每块布隆过滤器的字节数，0 表示默认（256）
+};
+
+// 以追加方式写入单个文件
+class FileSink : public BufferedSink {
+public:
+    explicit FileSink(const std::string& path, const FlushPolicy& policy = FlushPolicy(),
+                      const IndexPolicy& index = IndexPolicy());
+    ~FileSink() override;
+
+    void write(std::string_view line, LogLevel level) override;
+
+    bool isOpen() const { return writer_.isOpen(); }
+
+private:
+    ::m3log_index_builder* index_ = nullptr;
+};
+
+// 日志轮转策略：按大小或按时间（两者可同时开启，先满足者触发）
+struct RotationPolicy {
+    uint64_t maxBytes = 0;             // 文件达到该字节数时轮转；0 表示不按大小轮转
+    std::chrono::seconds interval{0};  // 按 UTC 对齐的时间间隔轮转（例如 86400 为每天零点）；0 表示不按时间轮转
+    size_t maxFiles = 5;               // 保留的历史文件数量 path.1 ... path.maxFiles；0 表示轮转后直接删除
+    uint64_t preallocateBytes = 0;     // 预先为下一个文件分配的磁盘空间（fallocate），0 表示不预分配
+    bool compress = false;             // 在后台线程将历史文件压缩为 .gz（需以 M3LOG_HAVE_ZLIB 编译）
+
+    bool enabled() const { return maxBytes > 0 || interval.count() > 0; }
+};
+
+namespace detail {
+class LogArchiver;
+}
+
+// 轮转日志文件：当前文件写入 path，轮转后依次为 path.1（最新）... path.maxFiles。
+// 写线程轮转时只做 rename，保留链的移动、压缩和下一个文件的预分配在低优先级后台线程完成
+class RotatingFileSink : public BufferedSink {
+public:
+    RotatingFileSink(const std::string& path, const RotationPolicy& rotation,
+                     const FlushPolicy& policy = FlushPolicy());
+    RotatingFileSink(const std::string& path, uint64_t maxBytes, size_t maxFiles,
+                     const FlushPolicy& policy = FlushPolicy());
+    ~RotatingFileSink() override;
+
+    void write(std::string_view line, LogLevel level) override;
+    void onIdle(std::chrono::steady_clock::time_point now) override;
+
+    bool isOpen() const { return writer_.isOpen(); }
+
+    // 已发生的轮转次数
+    uint64_t rotationCount() const { return rotations_.load(std::memory_order_relaxed); }
+
+    // 等待后台归档（移动、压缩）全部完成
+    void waitArchived();
+
+private:
+    // 打开 path 并预分配空间，返回文件的最后修改时间
+    std::chrono::system_clock::time_point open();
+    void rotate();
+    std::chrono::system_clock::time_point nextBoundary(std::chrono::system_clock::time_point now) const;
+
+    std::string path_;
+    RotationPolicy rotation_;
+    uint64_t size_ = 0;
+    std::chrono::system_clock::time_point nextRotation_;
+    std::atomic<uint64_t> rotations_{0};
+    std::unique_ptr<detail::LogArchiver> archiver_;
+};
+
+// Unix 域套接字：Datagram 模式每行一个数据报，Stream 模式以换行分隔并批量发送。
+// 对端不可用时丢弃日志，并每秒最多重连一次
+class UnixSocketSink : public Sink {
+public:
+    enum class Mode {
+        Datagram,
+        Stream
+    };
+
+    explicit UnixSocketSink(const std::string& path, Mode mode = Mode::Datagram, size_t bufferBytes = 64 * 1024);
+    ~UnixSocketSink() override;
+
+    void write(std::string_view line, LogLevel level) override;
+    void flush() override;
+    void onIdle(std::chrono::steady_clock::time_point now) override;
+    IoStats ioStats() const override;
+
+    // 因对端不可用而丢弃的行数
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    bool ensureConnected();
+    void disconnect();
+    bool sendAll(const char* data, size_t length);
+
+    std::string path_;
+    Mode mode_;
+    size_t bufferBytes_;
+    int fd_ = -1;
+    std::string buffer_;
+    std::chrono::steady_clock::time_point nextAttempt_;
+    std::atomic<uint64_t> lines_{0};
+    std::atomic<uint64_t> sendCalls_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// 内存环形缓冲：保留最近 capacity 行，可随时取快照（例如崩溃前输出最近日志）
+class RingSink : public Sink {
+public:
+    explicit RingSink(size_t capacity);
+
+    void write(std::string_view line, LogLevel level) override;
+
+    // 按时间顺序返回当前保留的日志行
+    std::vector<std::string> snapshot() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::string> lines_;
+    uint64_t next_ = 0;
+};
+
+// 用户回调，在 sink 的写线程上调用
+class CallbackSink : public Sink {
+public:
+    using Callback = std::function<void(std::string_view line, LogLevel level)>;
+
+    explicit CallbackSink(Callback callback) : callback_(std::move(callback)) {}
+
+    void write(std::string_view line, LogLevel level) override { callback_(line, level); }
+
+private:
+    Callback callback_;
+};
+
+namespace detail {
+
+// 多个 sink 共享的一行日志：格式化一次、分配一次，最后一个写线程释放
+class SharedLine {
+public:
+    static SharedLine* create(std::string_view text, LogLevel level, uint32_t refs);
+
+    std::string_view text() const { return std::string_view(reinterpret_cast<const char*>(this + 1), length_); }
+    LogLevel level() const { return level_; }
+
+    void release();
+
+private:
+    SharedLine(size_t length, LogLevel level, uint32_t refs) : refs_(refs), level_(level), length_(length) {}
+
+    std::atomic<uint32_t> refs_;
+    LogLevel level_;
+    size_t length_;
+};
+
+// 单个 sink 的队列与写线程
+class SinkWorker {
+public:
+    SinkWorker(std::shared_ptr<Sink> sink, LogLevel minLevel, size_t queueCapacity, bool dropOnOverflow);
+    ~SinkWorker();
+
+    SinkWorker(const SinkWorker&) = delete;
+    SinkWorker& operator=(const SinkWorker&) = delete;
+
+    bool accepts(LogLevel level) const {
+        return static_cast<int>(level) >= minLevel_.load(std::memory_order_relaxed);
+    }
+    void setMinLevel(LogLevel level) { minLevel_.store(static_cast<int>(level), std::memory_order_relaxed); }
+
+    // 提交一行，调用方转移一个引用；队列已满且策略为丢弃时立即释放
+    void submit(SharedLine* line);
+
+    // 等待此前提交的行全部写出，并在写线程上调用 sink 的 flush
+    void flush();
+
+    // 排空队列、刷新并结束写线程
+    void stop();
+
+    Sink& sink() { return *sink_; }
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // 队列中尚未写出的行数（近似）与队列容量
+    size_t queueDepth() const { return queue_.size(); }
+    size_t queueCapacity() const { return queue_.capacity(); }
+
+private:
+    void run();
+    size_t drain(size_t limit);
+    void wake();
+
+    std::shared_ptr<Sink> sink_;
+    std::atomic<int> minLevel_;
+    bool dropOnOverflow_;
+    BoundedMpscQueue<SharedLine*> queue_;
+    std::thread thread_;
+
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+    std::condition_variable flushedCv_;
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> stopped_{false};
+    std::atomic<uint64_t> flushRequested_{0};
+    std::atomic<uint64_t> flushCompleted_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace detail
+
+} // namespace m3log
+
+#endif // M3LOG_SINK_HH
@@ -0,0 +1,164 @@
+#include "m3log_timestamp.hh"
+#include <chrono>
+#include <cstring>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+namespace m3log {
+
+namespace {
+
+int64_t readClock(ClockSource source) {
+#if defined(__linux__)
+    clockid_t id = CLOCK_REALTIME;
+    switch (source) {
+        case ClockSource::Realtime:        id = CLOCK_REALTIME; break;
+        case ClockSource::RealtimeCoarse:  id = CLOCK_REALTIME_COARSE; break;
+        case ClockSource::Monotonic:       id = CLOCK_MONOTONIC; break;
+        case ClockSource::MonotonicCoarse: id = CLOCK_MONOTONIC_COARSE; break;
+    }
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#else
+    using namespace std::chrono;
+    if (source == ClockSource::Monotonic || source == ClockSource::MonotonicCoarse) {
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+#endif
+}
+
+bool isMonotonic(ClockSource source) {
+    return source == ClockSource::Monotonic || source == ClockSource::MonotonicCoarse;
+}
+
+inline void write2(char* p, unsigned v) {
+    p[0] = static_cast<char>('0' + v / 10);
+    p[1] = static_cast<char>('0' + v % 10);
+}
+
+// 将自纪元以来的天数转换为年月日（Howard Hinnant 的 civil_from_days 算法）
+void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+// 生成 "YYYY-MM-DDTHH:MM:SS" 共 19 个字符
+void formatSecondPrefix(int64_t seconds, char* out) {
+    int64_t days = seconds / 86400;
+    int64_t rem = seconds % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        --days;
+    }
+
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    unsigned y = static_cast<unsigned>(year < 0 ? 0 : (year > 9999 ? 9999 : year));
+    out[0] = static_cast<char>('0' + y / 1000);
+    out[1] = static_cast<char>('0' + y / 100 % 10);
+    out[2] = static_cast<char>('0' + y / 10 % 10);
+    out[3] = static_cast<char>('0' + y % 10);
+    out[4] = '-';
+    write2(out + 5, month);
+    out[7] = '-';
+    write2(out + 8, day);
+    out[10] = 'T';
+    write2(out + 11, static_cast<unsigned>(rem / 3600));
+    out[13] = ':';
+    write2(out + 14, static_cast<unsigned>(rem / 60 % 60));
+    out[16] = ':';
+    write2(out + 17, static_cast<unsigned>(rem % 60));
+}
+
+// 每线程缓存的秒级前缀
+struct SecondCache {
+    int64_t second = INT64_MIN;
+    char prefix[19];
+};
+
+thread_local SecondCache t_secondCache;
+
+} // namespace
+
+TimestampEngine::TimestampEngine(ClockSource source, TimestampPrecision precision)
+    : source_(source), precision_(precision), anchor_(0) {
+    reanchor();
+}
+
+void TimestampEngine::setClockSource(ClockSource source) {
+    source_.store(source, std::memory_order_relaxed);
+}
+
+ClockSource TimestampEngine::clockSource() const {
+    return source_.load(std::memory_order_relaxed);
+}
+
+void TimestampEngine::setPrecision(TimestampPrecision precision) {
+    precision_.store(precision, std::memory_order_relaxed);
+}
+
+TimestampPrecision TimestampEngine::precision() const {
+    return precision_.load(std::memory_order_relaxed);
+}
+
+void TimestampEngine::reanchor() {
+    int64_t realtime = readClock(ClockSource::Realtime);
+    int64_t monotonic = readClock(ClockSource::Monotonic);
+    anchor_.store(realtime - monotonic, std::memory_order_relaxed);
+}
+
+int64_t TimestampEngine::now() const {
+    ClockSource source = source_.load(std::memory_order_relaxed);
+    int64_t value = readClock(source);
+    if (isMonotonic(source)) {
+        value += anchor_.load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+size_t TimestampEngine::format(int64_t nanos, char* buf) const {
+    int64_t seconds = nanos / 1000000000LL;
+    int64_t fraction = nanos % 1000000000LL;
+    if (fraction < 0) {
+        fraction += 1000000000LL;
+        --seconds;
+    }
+
+    SecondCache& cache = t_secondCache;
+    if (cache.second != seconds) {
+        formatSecondPrefix(seconds, cache.prefix);
+        cache.second = seconds;
+    }
+    std::memcpy(buf, cache.prefix, sizeof(cache.prefix));
+
+    int digits = 3;
+    switch (precision_.load(std::memory_order_relaxed)) {
+        case TimestampPrecision::Milliseconds: digits = 3; fraction /= 1000000; break;
+        case TimestampPrecision::Microseconds: digits = 6; fraction /= 1000; break;
+        case TimestampPrecision::Nanoseconds:  digits = 9; break;
+    }
+
+    char* p = buf + sizeof(cache.prefix);
+    *p = '.';
+    for (int i = digits; i > 0; --i) {
+        p[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    p[digits + 1] = 'Z';
+    return sizeof(cache.prefix) + static_cast<size_t>(digits) + 2;
+}
+
+} // namespace m3log
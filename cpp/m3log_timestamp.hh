@@ -0,0 +1,62 @@
+#ifndef M3LOG_TIMESTAMP_HH
+#define M3LOG_TIMESTAMP_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace m3log {
+
+// 时间戳的时钟来源
+enum class ClockSource {
+    Realtime,         // 系统实时时钟，精度最高
+    RealtimeCoarse,   // 粗粒度实时时钟（Linux 下约 1-4ms 精度，开销最低）
+    Monotonic,        // 单调时钟 + 启动时锚定的墙钟偏移，不受系统校时影响
+    MonotonicCoarse   // 粗粒度单调时钟 + 锚定偏移
+};
+
+// 时间戳小数部分的精度
+enum class TimestampPrecision {
+    Milliseconds,  // 2023-04-01T15:30:45.123Z
+    Microseconds,  // 2023-04-01T15:30:45.123456Z
+    Nanoseconds    // 2023-04-01T15:30:45.123456789Z
+};
+
+// ISO 8601 时间戳生成器
+// 每个线程缓存当前秒的 "YYYY-MM-DDTHH:MM:SS" 前缀，同一秒内只改写小数位，
+// 直接写入调用方缓冲区，无堆分配、无全局锁
+class TimestampEngine {
+public:
+    // 格式化结果的最大长度（不含结尾的 '\0'）
+    static constexpr size_t kMaxLength = 30;
+
+    explicit TimestampEngine(ClockSource source = ClockSource::Realtime,
+                             TimestampPrecision precision = TimestampPrecision::Milliseconds);
+
+    void setClockSource(ClockSource source);
+    ClockSource clockSource() const;
+
+    void setPrecision(TimestampPrecision precision);
+    TimestampPrecision precision() const;
+
+    // 重新计算单调时钟与墙钟之间的偏移（系统校时后可调用）
+    void reanchor();
+
+    // 按当前时钟来源读取时间，返回自 Unix 纪元以来的纳秒数
+    int64_t now() const;
+
+    // 将纳秒时间格式化写入 buf（至少 kMaxLength 字节），返回写入长度，不写 '\0'
+    size_t format(int64_t nanos, char* buf) const;
+
+    // 读取当前时间并格式化
+    size_t formatNow(char* buf) const { return format(now(), buf); }
+
+private:
+    std::atomic<ClockSource> source_;
+    std::atomic<TimestampPrecision> precision_;
+    std::atomic<int64_t> anchor_;
+};
+
+} // namespace m3log
+
+#endif // M3LOG_TIMESTAMP_HH
@@ -0,0 +1,145 @@
+#include "m3log_writer.hh"
+#include <cerrno>
+#include <fcntl.h>
+
+#if defined(__linux__)
+#include <linux/falloc.h>
+#endif
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace m3log {
+
+namespace {
+
+#if defined(_WIN32)
+long writeFd(int fd, const char* data, size_t length) {
+    return _write(fd, data, static_cast<unsigned>(length));
+}
+void syncFd(int fd) {
+    _commit(fd);
+}
+int openAppend(const char* path) {
+    return _open(path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+}
+void closeFd(int fd) {
+    _close(fd);
+}
+#else
+long writeFd(int fd, const char* data, size_t length) {
+    return static_cast<long>(::write(fd, data, length));
+}
+void syncFd(int fd) {
+#if defined(__APPLE__)
+    ::fsync(fd);
+#else
+    ::fdatasync(fd);
+#endif
+}
+int openAppend(const char* path) {
+    return ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+void closeFd(int fd) {
+    ::close(fd);
+}
+#endif
+
+} // namespace
+
+bool preallocateFile(int fd, uint64_t bytes) {
+#if defined(__linux__)
+    if (fd < 0 || bytes == 0) {
+        return false;
+    }
+    // FALLOC_FL_KEEP_SIZE：只分配块，文件长度不变，O_APPEND 仍从真实末尾追加
+    return ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes)) == 0;
+#else
+    (void)fd;
+    (void)bytes;
+    return false;
+#endif
+}
+
+FileWriter::~FileWriter() {
+    close();
+}
+
+bool FileWriter::open(const std::string& path) {
+    close();
+    fd_ = openAppend(path.c_str());
+    owned_ = fd_ >= 0;
+    return fd_ >= 0;
+}
+
+void FileWriter::attach(int fd, bool owned) {
+    close();
+    fd_ = fd;
+    owned_ = owned && fd >= 0;
+}
+
+void FileWriter::close() {
+    if (fd_ < 0) {
+        return;
+    }
+    flush();
+    if (owned_) {
+        closeFd(fd_);
+    }
+    fd_ = -1;
+    owned_ = false;
+}
+
+void FileWriter::reserve(size_t capacity) {
+    buffer_.reserve(capacity);
+}
+
+void FileWriter::append(std::string_view data) {
+    if (fd_ < 0) {
+        return;
+    }
+    if (buffer_.size() + data.size() > buffer_.capacity()) {
+        flush();
+        if (data.size() > buffer_.capacity()) {
+            writeAll(data.data(), data.size());
+            return;
+        }
+    }
+    buffer_.append(data);
+}
+
+void FileWriter::flush(bool sync) {
+    if (fd_ < 0) {
+        return;
+    }
+    if (!buffer_.empty()) {
+        writeAll(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+    if (sync) {
+        syncFd(fd_);
+        syncCalls_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void FileWriter::writeAll(const char* data, size_t length) {
+    while (length > 0) {
+        long written = writeFd(fd_, data, length);
+        writeCalls_.fetch_add(1, std::memory_order_relaxed);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 写入失败（磁盘已满、管道关闭等）时丢弃数据，不阻塞日志调用方
+            return;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        bytesWritten_.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+    }
+}
+
+} // namespace m3log
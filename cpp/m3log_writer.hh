@@ -0,0 +1,94 @@
+#ifndef M3LOG_WRITER_HH
+#define M3LOG_WRITER_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace m3log {
+
+// 输出刷新策略：日志行先写入用户态缓冲区，满足任一条件时合并为一次 write(2)
+struct FlushPolicy {
+    size_t bufferBytes = 64 * 1024;           // 缓冲达到该字节数时刷新；0 表示每行立即刷新
+    std::chrono::milliseconds interval{100};  // 周期刷新间隔；0 表示不做周期刷新
+    bool flushOnError = true;                 // ERROR/FATAL 日志写入后立即刷新
+    bool sync = false;                        // 每次刷新日志文件后调用 fdatasync
+
+    // 每行立即写出（旧版行为）
+    static FlushPolicy immediate() {
+        FlushPolicy policy;
+        policy.bufferBytes = 0;
+        policy.interval = std::chrono::milliseconds(0);
+        return policy;
+    }
+
+    // 按时间或字节数批量写出
+    static FlushPolicy buffered(std::chrono::milliseconds interval, size_t bytes = 64 * 1024) {
+        FlushPolicy policy;
+        policy.bufferBytes = bytes;
+        policy.interval = interval;
+        return policy;
+    }
+};
+
+// 为文件预留 bytes 字节的磁盘空间但不改变文件长度，之后的追加写不再触发块分配。
+// 平台或文件系统不支持时返回 false
+bool preallocateFile(int fd, uint64_t bytes);
+
+// 基于文件描述符的缓冲写出器
+// 数据先追加到用户态缓冲区，flush 时一次 write(2) 写出，可选 fdatasync。
+// 本身不加锁，由调用方负责同步；统计计数可以在其他线程读取
+class FileWriter {
+public:
+    FileWriter() = default;
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    // 以追加方式打开文件，失败返回 false
+    bool open(const std::string& path);
+
+    // 使用已有的描述符（例如标准输出）；owned 为 false 时 close 不关闭它
+    void attach(int fd, bool owned = false);
+
+    // 写出缓冲区并关闭
+    void close();
+
+    bool isOpen() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+
+    // 追加数据；缓冲区放不下时先写出，超过容量的数据直接写出
+    void append(std::string_view data);
+
+    // 写出缓冲区中的全部数据，sync 为 true 时随后调用 fdatasync
+    void flush(bool sync = false);
+
+    // 设置缓冲区容量（不会缩小已分配的内存）
+    void reserve(size_t capacity);
+
+    // 尚未写出的字节数
+    size_t pending() const { return buffer_.size(); }
+
+    // 累计的 write(2) 与 fdatasync 调用次数、写出字节数
+    uint64_t writeCalls() const { return writeCalls_.load(std::memory_order_relaxed); }
+    uint64_t syncCalls() const { return syncCalls_.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+
+private:
+    void writeAll(const char* data, size_t length);
+
+    int fd_ = -1;
+    bool owned_ = false;
+    std::string buffer_;
+    std::atomic<uint64_t> writeCalls_{0};
+    std::atomic<uint64_t> syncCalls_{0};
+    std::atomic<uint64_t> bytesWritten_{0};
+};
+
+} // namespace m3log
+
+#endif // M3LOG_WRITER_HH
@@ -0,0 +1,193 @@
+// 将 Logger::setBinaryOutput 写出的二进制日志还原为标准 m3log 文本
+//
+// 用法：m3log_decode <输入文件> [输出文件]
+// 未指定输出文件时写到标准输出。每条记录使用 Logger::formatTo 按记录中的原始时间格式化，
+// 结果与程序以文本模式运行时 Logger::format 的输出逐字节相同。
+
+#include "../m3log.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace m3log;
+
+struct Descriptor {
+    bool valid = false;
+    LogLevel level = LogLevel::INFO;
+    TagSet tags;
+    std::string format;
+};
+
+class Decoder {
+public:
+    Decoder(std::string_view data, std::ostream& out) : p_(data.data()), end_(p_ + data.size()), out_(out) {}
+
+    // 返回 false 表示文件损坏或被截断，已解码的部分仍会输出
+    bool run() {
+        while (p_ < end_) {
+            char kind = *p_;
+            bool ok = false;
+            switch (kind) {
+                case binary::kMagic[0]:          ok = readHeader(); break;
+                case binary::kDescriptorRecord:  ++p_; ok = readDescriptor(); break;
+                case binary::kPrecisionRecord:   ++p_; ok = readPrecision(); break;
+                case binary::kEventRecord:       ++p_; ok = readEvent(); break;
+                default: break;
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t records() const { return records_; }
+
+private:
+    bool readHeader() {
+        if (end_ - p_ < 6 || std::string_view(p_, 4) != std::string_view(binary::kMagic, 4) ||
+            static_cast<uint8_t>(p_[4]) != binary::kVersion) {
+            return false;
+        }
+        Logger::instance().setTimestampPrecision(static_cast<TimestampPrecision>(p_[5]));
+        p_ += 6;
+
+        // 新的文件头（追加写入）开始一段独立的记录：描述符与时间基准都重置
+        descriptors_.clear();
+        lastTime_ = 0;
+        return true;
+    }
+
+    bool readDescriptor() {
+        uint64_t id = 0;
+        uint64_t tagCount = 0;
+        if (!binary::getVarint(p_, end_, id) || p_ == end_ || id > UINT32_MAX) {
+            return false;
+        }
+        Descriptor descriptor;
+        descriptor.level = static_cast<LogLevel>(*p_++);
+        if (!binary::getVarint(p_, end_, tagCount)) {
+            return false;
+        }
+
+        std::vector<std::string_view> tags;
+        for (uint64_t i = 0; i < tagCount; ++i) {
+            std::string_view tag;
+            if (!readString(tag)) {
+                return false;
+            }
+            tags.push_back(tag);
+        }
+        std::string_view format;
+        if (!readString(format)) {
+            return false;
+        }
+
+        descriptor.valid = true;
+        descriptor.tags = Logger::instance().internTags(std::span<const std::string_view>(tags));
+        descriptor.format.assign(format);
+        if (descriptors_.size() <= id) {
+            descriptors_.resize(id + 1);
+        }
+        descriptors_[id] = std::move(descriptor);
+        return true;
+    }
+
+    bool readPrecision() {
+        if (p_ == end_) {
+            return false;
+        }
+        Logger::instance().setTimestampPrecision(static_cast<TimestampPrecision>(*p_++));
+        return true;
+    }
+
+    bool readEvent() {
+        uint64_t id = 0;
+        uint64_t delta = 0;
+        std::string_view args;
+        if (!binary::getVarint(p_, end_, id) || !binary::getVarint(p_, end_, delta) || !readString(args)) {
+            return false;
+        }
+        if (id >= descriptors_.size() || !descriptors_[id].valid) {
+            return false;
+        }
+        const Descriptor& descriptor = descriptors_[id];
+        lastTime_ += binary::unzigzag(delta);
+
+        binary::ArgValue values[binary::kMaxArgs];
+        size_t count = 0;
+        if (!binary::decodeArgs(args, values, count) && count < binary::kMaxArgs) {
+            return false;
+        }
+
+        message_.clear();
+        binary::renderFormat(message_, descriptor.format, std::span<const binary::ArgValue>(values, count));
+        Logger::instance().formatTo(line_, descriptor.level, descriptor.tags, message_, lastTime_);
+        line_.push_back('\n');
+        out_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+        ++records_;
+        return true;
+    }
+
+    bool readString(std::string_view& value) {
+        uint64_t length = 0;
+        if (!binary::getVarint(p_, end_, length) || length > static_cast<uint64_t>(end_ - p_)) {
+            return false;
+        }
+        value = std::string_view(p_, length);
+        p_ += length;
+        return true;
+    }
+
+    const char* p_;
+    const char* end_;
+    std::ostream& out_;
+    std::vector<Descriptor> descriptors_;
+    int64_t lastTime_ = 0;
+    uint64_t records_ = 0;
+    std::string message_;
+    std::string line_;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: %s <input> [output]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input) {
+        std::fprintf(stderr, "m3log_decode: cannot open %s\n", argv[1]);
+        return 1;
+    }
+    std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    std::ofstream file;
+    if (argc == 3) {
+        file.open(argv[2], std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::fprintf(stderr, "m3log_decode: cannot open %s\n", argv[2]);
+            return 1;
+        }
+    }
+    std::ostream& out = argc == 3 ? static_cast<std::ostream&>(file) : std::cout;
+
+    Logger::instance().setConsoleOutput(false);
+    Decoder decoder(data, out);
+    bool ok = decoder.run();
+    out.flush();
+    if (!ok) {
+        std::fprintf(stderr, "m3log_decode: %s is truncated or corrupt after %llu records\n", argv[1],
+                     static_cast<unsigned long long>(decoder.records()));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// 将 Logger::setFlightRecorder 写出的环形记录文件按写入顺序还原为标准 m3log 文本
+//
+// 用法：m3log_recorder <记录文件> [输出文件]
+// 未指定输出文件时写到标准输出。进程崩溃后或仍在运行时都可以读取；未写完或已被覆盖的记录被跳过。
+// 每条记录使用 Logger::formatTo 按记录中的原始时间格式化，被截断的消息以 " [truncated]" 结尾。
+
+#include "../m3log.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace m3log;
+
+// 把 "[a b] " 前缀拆分为标签并驻留
+TagSet parseTags(std::string_view prefix) {
+    std::vector<std::string_view> tags;
+    if (prefix.size() >= 3 && prefix.front() == '[' && prefix.substr(prefix.size() - 2) == "] ") {
+        std::string_view inner = prefix.substr(1, prefix.size() - 3);
+        while (!inner.empty()) {
+            size_t space = inner.find(' ');
+            std::string_view tag = inner.substr(0, space);
+            if (!tag.empty()) {
+                tags.push_back(tag);
+            }
+            inner.remove_prefix(space == std::string_view::npos ? inner.size() : space + 1);
+        }
+    }
+    return Logger::instance().internTags(std::span<const std::string_view>(tags));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: %s <recorder-file> [output]\n", argv[0]);
+        return 2;
+    }
+
+    std::string storage;
+    std::vector<detail::FlightRecorder::Entry> entries;
+    TimestampPrecision precision = TimestampPrecision::Milliseconds;
+    if (!detail::FlightRecorder::extract(argv[1], storage, entries, precision)) {
+        std::fprintf(stderr, "m3log_recorder: %s is not a flight recorder file\n", argv[1]);
+        return 1;
+    }
+
+    std::ofstream file;
+    if (argc == 3) {
+        file.open(argv[2], std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::fprintf(stderr, "m3log_recorder: cannot open %s\n", argv[2]);
+            return 1;
+        }
+    }
+    std::ostream& out = argc == 3 ? static_cast<std::ostream&>(file) : std::cout;
+
+    Logger& logger = Logger::instance();
+    logger.setConsoleOutput(false);
+    logger.setTimestampPrecision(precision);
+
+    std::string message;
+    std::string line;
+    for (const auto& entry : entries) {
+        message.assign(entry.message);
+        if (entry.truncated) {
+            message.append(" [truncated]");
+        }
+        logger.formatTo(line, entry.level, parseTags(entry.tags), message, entry.time);
+        line.push_back('\n');
+        out.write(line.data(), static_cast<std::streamsize>(line.size()));
+    }
+    out.flush();
+    return 0;
+}